@@ -195,12 +195,11 @@ void setDistributionFunction(MeshLib::CFEMesh& msh,
                              LinearFunctionData& linear_f)
 {
 	const size_t nodes_vector_length = vec_node_ids.size();
+	if (nodes_vector_length == 0) return;
+	std::vector<const double*> coords(nodes_vector_length);
 	for (size_t i = 0; i < nodes_vector_length; i++)
-	{
-		long node_id = vec_node_ids[i];
-		double const* const coords(msh.nod_vector[node_id]->getData());
-		vec_node_values[i] = linear_f.getValue(coords[0], coords[1], coords[2]);
-	}
+		coords[i] = msh.nod_vector[vec_node_ids[i]]->getData();
+	linear_f.getValues(nodes_vector_length, &coords[0], &vec_node_values[0]);
 }
 
 // Interpolation of polygon values to nodes_on_sfc
@@ -9,6 +9,8 @@
 
 #include "ElementValue.h"
 
+#include <algorithm>
+
 #include "MSHEnums.h"
 #include "msh_elem.h"
 
@@ -18,11 +20,70 @@ using namespace MeshLib;
 using namespace Math_Group;
 
 std::vector<FiniteElement::ElementValue*> ele_gp_value;
+std::vector<FiniteElement::GaussPointValuePool*> ele_gp_value_pool;
 
 namespace FiniteElement
 {
 
-ElementValue::ElementValue(CRFProcess* m_pcs, CElem* ele) : pcs(m_pcs)
+void GaussPointMatrix::operator=(double a)
+{
+	for (std::size_t i = 0; i < _rows; i++)
+		std::fill(_data + i * _stride, _data + i * _stride + _cols,
+		          static_cast<GaussPointReal>(a));
+}
+
+void GaussPointMatrix::operator=(const GaussPointMatrix& m)
+{
+	for (std::size_t i = 0; i < _rows; i++)
+		std::copy(m._data + i * m._stride, m._data + i * m._stride + _cols,
+		          _data + i * _stride);
+}
+
+void GaussPointMatrix::Write(std::ostream& os) const
+{
+	os.setf(std::ios::scientific, std::ios::floatfield);
+	os.precision(12);
+
+	for (std::size_t i = 0; i < _rows; i++)
+	{
+		for (std::size_t j = 0; j < _cols; j++)
+			os << (*this)(i, j) << " ";
+		os << "\n";
+	}
+	os << "\n";
+}
+
+GaussPointValuePool::GaussPointValuePool(
+    CRFProcess* m_pcs, std::vector<MeshLib::CElem*> const& elements)
+    : _offsets(elements.size() + 1, 0), _data(NULL)
+{
+	for (std::size_t i = 0; i < elements.size(); i++)
+		_offsets[i + 1] =
+		    _offsets[i] +
+		    ElementValue::getNumberOfGaussPoints(m_pcs, elements[i]);
+
+	// 15.3.2007 Multi-phase flow WW
+	_has_gas_velocity =
+	    (m_pcs->getProcessType() == FiniteElement::MULTI_PHASE_FLOW ||
+	     m_pcs->getProcessType() == FiniteElement::PS_GLOBAL ||
+	     m_pcs->type == 42);
+
+	// Velocity, Velocity0 and Velocity_g with three components each
+	const std::size_t n_vectors = _has_gas_velocity ? 3 : 2;
+	_data = new GaussPointReal[3 * n_vectors * getStride()]();
+}
+
+GaussPointValuePool::~GaussPointValuePool()
+{
+	delete[] _data;
+}
+
+void GaussPointValuePool::copyVelocityToPreviousLevel()
+{
+	std::copy(getVelocity(), getVelocity() + 3 * getStride(), getVelocity0());
+}
+
+int ElementValue::getNumberOfGaussPoints(CRFProcess* m_pcs, CElem* ele)
 {
 	int NGPoints = 0, NGP = 0;
 	int ele_dim;
@@ -40,18 +101,23 @@ ElementValue::ElementValue(CRFProcess* m_pcs, CElem* ele) : pcs(m_pcs)
 		NGPoints = 5;  // 15;
 	else
 		NGPoints = (int)MathLib::fastpow(NGP, ele_dim);
+	return NGPoints;
+}
+
+ElementValue::ElementValue(CRFProcess* m_pcs, GaussPointValuePool& pool,
+                           std::size_t ele_pos)
+    : pcs(m_pcs)
+{
+	const std::size_t offset = pool.getOffset(ele_pos);
+	const std::size_t NGPoints = pool.getNumberOfGaussPoints(ele_pos);
+	const std::size_t stride = pool.getStride();
 
 	// WW Velocity.resize(m_pcs->m_msh->GetCoordinateFlag()/10, NGPoints);
-	Velocity.resize(3, NGPoints);
-	Velocity = 0.0;
-	Velocity0.resize(3, NGPoints);
-	Velocity0 = 0.0;
-	// 15.3.2007 Multi-phase flow WW
-	if (pcs->getProcessType() == FiniteElement::MULTI_PHASE_FLOW || pcs->getProcessType() == FiniteElement::PS_GLOBAL || m_pcs->type == 42)
-	{
-		Velocity_g.resize(3, NGPoints);
-		Velocity_g = 0.0;
-	}
+	Velocity.setView(pool.getVelocity() + offset, stride, 3, NGPoints);
+	Velocity0.setView(pool.getVelocity0() + offset, stride, 3, NGPoints);
+	if (pool.hasGasVelocity())
+		Velocity_g.setView(pool.getVelocityGas() + offset, stride, 3,
+		                   NGPoints);
 }
 // WW 08/2007
 void ElementValue::getIPvalue_vec(const int IP, double* vec)
@@ -89,12 +155,7 @@ void ElementValue::GetEleVelocity(double* vec)
 	}
 }
 
-ElementValue::~ElementValue()
-{
-	Velocity.resize(0, 0);
-	Velocity0.resize(0, 0);
-	Velocity_g.resize(0, 0);
-}
+ElementValue::~ElementValue() {}
 
 }  // end namespace
 
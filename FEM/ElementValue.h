@@ -10,6 +10,8 @@
 #ifndef element_value_INC
 #define element_value_INC
 
+#include <cstddef>
+#include <iostream>
 #include <vector>
 
 #include "matrix_class.h"
@@ -26,16 +28,113 @@ namespace FiniteElement
 {
 class CFiniteElementStd;
 
+// Velocities are only used for advection and output. Single precision
+// halves the memory of the Gauss point values.
+#ifdef OGS_GP_VELOCITY_FLOAT
+typedef float GaussPointReal;
+#else
+typedef double GaussPointReal;
+#endif
+
+/**
+ * Matrix-like view of the Gauss point values of one element inside a
+ * GaussPointValuePool. Rows are the vector components, columns the Gauss
+ * points. Assignment copies values, not the view.
+ */
+class GaussPointMatrix
+{
+public:
+	GaussPointMatrix() : _data(NULL), _stride(0), _rows(0), _cols(0) {}
+
+	void setView(GaussPointReal* data, std::size_t stride, std::size_t rows,
+	             std::size_t cols)
+	{
+		_data = data;
+		_stride = stride;
+		_rows = rows;
+		_cols = cols;
+	}
+
+	GaussPointReal& operator()(std::size_t i, std::size_t gp)
+	{
+		return _data[i * _stride + gp];
+	}
+	GaussPointReal operator()(std::size_t i, std::size_t gp) const
+	{
+		return _data[i * _stride + gp];
+	}
+
+	void operator=(double a);
+	void operator=(const GaussPointMatrix& m);
+
+	std::size_t Rows() const { return _rows; }
+	std::size_t Cols() const { return _cols; }
+	std::size_t Size() const { return _rows * _cols; }
+
+	void Write(std::ostream& os = std::cout) const;
+
+private:
+	GaussPointMatrix(const GaussPointMatrix&);
+
+	GaussPointReal* _data;
+	std::size_t _stride;
+	std::size_t _rows;
+	std::size_t _cols;
+};
+
+/**
+ * Gauss point velocities of all elements of a process in a single
+ * allocation. Each component is stored contiguously over the Gauss points
+ * of all elements (structure of arrays).
+ */
+class GaussPointValuePool
+{
+public:
+	GaussPointValuePool(CRFProcess* m_pcs,
+	                    std::vector<MeshLib::CElem*> const& elements);
+	~GaussPointValuePool();
+
+	std::size_t getOffset(std::size_t ele_pos) const
+	{
+		return _offsets[ele_pos];
+	}
+	std::size_t getNumberOfGaussPoints(std::size_t ele_pos) const
+	{
+		return _offsets[ele_pos + 1] - _offsets[ele_pos];
+	}
+	/// Distance between two components of the same Gauss point
+	std::size_t getStride() const { return _offsets.back(); }
+	bool hasGasVelocity() const { return _has_gas_velocity; }
+
+	GaussPointReal* getVelocity() { return _data; }
+	GaussPointReal* getVelocity0() { return _data + 3 * getStride(); }
+	GaussPointReal* getVelocityGas()
+	{
+		return _has_gas_velocity ? _data + 6 * getStride() : NULL;
+	}
+
+	/// Velocity0 = Velocity for all elements
+	void copyVelocityToPreviousLevel();
+
+private:
+	std::vector<std::size_t> _offsets;
+	bool _has_gas_velocity;
+	GaussPointReal* _data;
+};
+
 class ElementValue
 {
 public:
-	ElementValue(CRFProcess* m_pcs, MeshLib::CElem* ele);
+	ElementValue(CRFProcess* m_pcs, GaussPointValuePool& pool,
+	             std::size_t ele_pos);
 	~ElementValue();
 	void getIPvalue_vec(const int IP, double* vec);
 	void getIPvalue_vec_phase(const int IP, int phase, double* vec);
 	void GetEleVelocity(double* vec);
-	Math_Group::Matrix Velocity;
-	Math_Group::Matrix Velocity0;
+	GaussPointMatrix Velocity;
+	GaussPointMatrix Velocity0;
+
+	static int getNumberOfGaussPoints(CRFProcess* m_pcs, MeshLib::CElem* ele);
 
 private:
 	// Friend class
@@ -44,11 +143,12 @@ private:
 	friend class ::COutput;
 
 	CRFProcess* pcs;
-	Math_Group::Matrix Velocity_g;
+	GaussPointMatrix Velocity_g;
 };
 
 }  // end namespace
 
 extern std::vector<FiniteElement::ElementValue*> ele_gp_value;
+extern std::vector<FiniteElement::GaussPointValuePool*> ele_gp_value_pool;
 
 #endif
@@ -0,0 +1,277 @@
+/**
+ * \copyright
+ * Copyright (c) 2015, OpenGeoSys Community (http://www.opengeosys.org)
+ *            Distributed under a Modified BSD License.
+ *              See accompanying file LICENSE.txt or
+ *              http://www.opengeosys.org/project/license
+ *
+ */
+
+#include "HeterogeneousField.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace
+{
+const char binary_signature[8] = {'O', 'G', 'S', 'H', 'E', 'T', 'B', '1'};
+const std::size_t max_cells_per_axis = 1 << 20;
+
+void readFixedString(std::ifstream& in, std::size_t length, std::string& str)
+{
+	std::vector<char> buffer(length + 1, '\0');
+	in.read(&buffer[0], length);
+	str = &buffer[0];
+}
+
+void writeFixedString(std::ofstream& out, std::size_t length,
+                      const std::string& str)
+{
+	std::vector<char> buffer(length, '\0');
+	std::copy(str.begin(),
+	          str.begin() + std::min(str.size(), length - 1), buffer.begin());
+	out.write(&buffer[0], length);
+}
+}
+
+HeterogeneousField::HeterogeneousField(const std::vector<double>& x,
+                                       const std::vector<double>& y,
+                                       const std::vector<double>& z,
+                                       const std::vector<double>& values)
+    : _x(x), _y(y), _z(z), _values(values)
+{
+	const std::size_t n = _x.size();
+	double const* const coords[3] = {n ? &_x[0] : NULL, n ? &_y[0] : NULL,
+	                                 n ? &_z[0] : NULL};
+
+	// Bounding box
+	double extent[3];
+	std::size_t active_dim = 0;
+	double active_volume = 1.0;
+	for (int k = 0; k < 3; k++)
+	{
+		_min[k] = 0.0;
+		extent[k] = 0.0;
+		if (n == 0) continue;
+		const double c_min = *std::min_element(coords[k], coords[k] + n);
+		const double c_max = *std::max_element(coords[k], coords[k] + n);
+		_min[k] = c_min;
+		extent[k] = c_max - c_min;
+		if (extent[k] > 0.0)
+		{
+			active_dim++;
+			active_volume *= extent[k];
+		}
+	}
+
+	// About two points per cell
+	const double n_target = std::max(1.0, 0.5 * n);
+	const double h =
+	    active_dim ? std::pow(active_volume / n_target, 1.0 / active_dim) : 1.0;
+	for (int k = 0; k < 3; k++)
+	{
+		_n_cells[k] = 1;
+		_cell_size[k] = 1.0;
+		if (!(extent[k] > 0.0)) continue;
+		const double n_k = std::ceil(extent[k] / h);
+		_n_cells[k] = static_cast<std::size_t>(
+		    std::min(std::max(n_k, 1.0), (double)max_cells_per_axis));
+		_cell_size[k] = extent[k] / _n_cells[k];
+	}
+
+	// Counting sort of the points into the cells, ascending ids per cell
+	const std::size_t n_cells = _n_cells[0] * _n_cells[1] * _n_cells[2];
+	std::vector<std::size_t> point_cell(n);
+	_cell_begin.assign(n_cells + 1, 0);
+	for (std::size_t i = 0; i < n; i++)
+	{
+		const double pnt[3] = {_x[i], _y[i], _z[i]};
+		std::size_t cell[3];
+		getCell(pnt, cell);
+		point_cell[i] =
+		    cell[0] + _n_cells[0] * (cell[1] + _n_cells[1] * cell[2]);
+		_cell_begin[point_cell[i] + 1]++;
+	}
+	for (std::size_t c = 0; c < n_cells; c++)
+		_cell_begin[c + 1] += _cell_begin[c];
+	_cell_ids.resize(n);
+	std::vector<std::size_t> next(_cell_begin.begin(), _cell_begin.end() - 1);
+	for (std::size_t i = 0; i < n; i++)
+		_cell_ids[next[point_cell[i]]++] = static_cast<long>(i);
+}
+
+void HeterogeneousField::getCell(double const* pnt, std::size_t* cell) const
+{
+	for (int k = 0; k < 3; k++)
+	{
+		const double c = std::floor((pnt[k] - _min[k]) / _cell_size[k]);
+		if (!(c > 0.0))
+			cell[k] = 0;
+		else if (c >= (double)(_n_cells[k] - 1))
+			cell[k] = _n_cells[k] - 1;
+		else
+			cell[k] = static_cast<std::size_t>(c);
+	}
+}
+
+long HeterogeneousField::getNearest(double const* pnt) const
+{
+	if (_x.empty()) return -1;
+
+	std::size_t center[3];
+	getCell(pnt, center);
+	const double slack =
+	    1.e-9 * std::max(_cell_size[0], std::max(_cell_size[1], _cell_size[2]));
+
+	long nearest = -1;
+	double min_dist = std::numeric_limits<double>::max();
+	for (std::size_t r = 0;; r++)
+	{
+		// Cells with the Chebyshev distance r to the center cell
+		long lo[3], hi[3];
+		for (int k = 0; k < 3; k++)
+		{
+			lo[k] = std::max(0L, (long)center[k] - (long)r);
+			hi[k] = std::min((long)_n_cells[k] - 1, (long)center[k] + (long)r);
+		}
+		for (long i = lo[0]; i <= hi[0]; i++)
+			for (long j = lo[1]; j <= hi[1]; j++)
+			{
+				const bool inner =
+				    std::labs(i - (long)center[0]) < (long)r &&
+				    std::labs(j - (long)center[1]) < (long)r;
+				const long k_step = (inner && r > 0) ? 2 * (long)r : 1;
+				for (long k = (long)center[2] - (long)r; k <= hi[2];
+				     k += k_step)
+				{
+					if (k < lo[2]) continue;
+					const std::size_t c =
+					    i + _n_cells[0] * (j + _n_cells[1] * k);
+					for (std::size_t l = _cell_begin[c]; l < _cell_begin[c + 1];
+					     l++)
+					{
+						const long id = _cell_ids[l];
+						const double dist =
+						    (_x[id] - pnt[0]) * (_x[id] - pnt[0]) +
+						    (_y[id] - pnt[1]) * (_y[id] - pnt[1]) +
+						    (_z[id] - pnt[2]) * (_z[id] - pnt[2]);
+						if (dist < min_dist || (dist == min_dist && id < nearest))
+						{
+							min_dist = dist;
+							nearest = id;
+						}
+					}
+				}
+			}
+
+		// Lower bound of the distance to all cells outside of the ring
+		double bound = std::numeric_limits<double>::max();
+		for (int k = 0; k < 3; k++)
+		{
+			if (lo[k] > 0)
+				bound = std::min(bound, pnt[k] - (_min[k] + lo[k] * _cell_size[k]));
+			if (hi[k] < (long)_n_cells[k] - 1)
+				bound = std::min(
+				    bound, _min[k] + (hi[k] + 1) * _cell_size[k] - pnt[k]);
+		}
+		if (bound == std::numeric_limits<double>::max()) break;
+		bound -= slack;
+		if (nearest >= 0 && bound > 0.0 && min_dist < bound * bound) break;
+	}
+	return nearest;
+}
+
+void HeterogeneousField::getPointsInXYBox(double x_min, double x_max,
+                                          double y_min, double y_max,
+                                          std::vector<long>& ids) const
+{
+	ids.clear();
+	if (_x.empty()) return;
+	const double pnt_min[3] = {x_min, y_min, _min[2]};
+	const double pnt_max[3] = {x_max, y_max, _min[2]};
+	std::size_t cell_min[3], cell_max[3];
+	getCell(pnt_min, cell_min);
+	getCell(pnt_max, cell_max);
+	for (std::size_t k = 0; k < _n_cells[2]; k++)
+		for (std::size_t j = cell_min[1]; j <= cell_max[1]; j++)
+			for (std::size_t i = cell_min[0]; i <= cell_max[0]; i++)
+			{
+				const std::size_t c = i + _n_cells[0] * (j + _n_cells[1] * k);
+				for (std::size_t l = _cell_begin[c]; l < _cell_begin[c + 1];
+				     l++)
+				{
+					const long id = _cell_ids[l];
+					if (_x[id] >= x_min && _x[id] <= x_max &&
+					    _y[id] >= y_min && _y[id] <= y_max)
+						ids.push_back(id);
+				}
+			}
+	std::sort(ids.begin(), ids.end());
+}
+
+bool HeterogeneousFieldFile::isBinary(const std::string& file_name)
+{
+	std::ifstream in(file_name.c_str(), std::ios::binary);
+	char signature[8];
+	if (!in.read(signature, 8)) return false;
+	return std::memcmp(signature, binary_signature, 8) == 0;
+}
+
+bool HeterogeneousFieldFile::read(const std::string& file_name)
+{
+	std::ifstream in(file_name.c_str(), std::ios::binary);
+	char signature[8];
+	if (!in.read(signature, 8) ||
+	    std::memcmp(signature, binary_signature, 8) != 0)
+		return false;
+	readFixedString(in, 32, msh_type);
+	readFixedString(in, 32, mmp_type);
+	readFixedString(in, 8, dis_type);
+	unsigned long long n = 0;
+	in.read(reinterpret_cast<char*>(&conversion_factor), sizeof(double));
+	in.read(reinterpret_cast<char*>(&n), sizeof(n));
+	if (!in || dis_type.empty()) return false;
+
+	std::vector<double>* columns[4] = {&x, &y, &z, &values};
+	const int first = (dis_type[0] == 'E') ? 3 : 0;
+	for (int c = 0; c < 4; c++)
+		columns[c]->clear();
+	for (int c = first; c < 4; c++)
+	{
+		columns[c]->resize(static_cast<std::size_t>(n));
+		if (n > 0 &&
+		    !in.read(reinterpret_cast<char*>(&(*columns[c])[0]),
+		             static_cast<std::streamsize>(n * sizeof(double))))
+			return false;
+	}
+	return true;
+}
+
+bool HeterogeneousFieldFile::write(const std::string& file_name) const
+{
+	std::ofstream out(file_name.c_str(), std::ios::binary | std::ios::trunc);
+	if (!out.good() || dis_type.empty()) return false;
+	out.write(binary_signature, 8);
+	writeFixedString(out, 32, msh_type);
+	writeFixedString(out, 32, mmp_type);
+	writeFixedString(out, 8, dis_type);
+	const unsigned long long n = values.size();
+	out.write(reinterpret_cast<const char*>(&conversion_factor),
+	          sizeof(double));
+	out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+
+	const std::vector<double>* columns[4] = {&x, &y, &z, &values};
+	const int first = (dis_type[0] == 'E') ? 3 : 0;
+	for (int c = first; c < 4; c++)
+	{
+		if (columns[c]->size() != values.size()) return false;
+		if (n > 0)
+			out.write(reinterpret_cast<const char*>(&(*columns[c])[0]),
+			          static_cast<std::streamsize>(n * sizeof(double)));
+	}
+	return out.good();
+}
@@ -0,0 +1,87 @@
+/**
+ * \copyright
+ * Copyright (c) 2015, OpenGeoSys Community (http://www.opengeosys.org)
+ *            Distributed under a Modified BSD License.
+ *              See accompanying file LICENSE.txt or
+ *              http://www.opengeosys.org/project/license
+ *
+ */
+
+#ifndef heterogeneous_field_INC
+#define heterogeneous_field_INC
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * Scattered data (x, y, z, value) of a distributed medium property with a
+ * uniform grid of buckets for the spatial queries used to map the data onto
+ * mesh elements (see CMediumProperties::SetDistributedELEProperties).
+ */
+class HeterogeneousField
+{
+public:
+	HeterogeneousField(const std::vector<double>& x,
+	                   const std::vector<double>& y,
+	                   const std::vector<double>& z,
+	                   const std::vector<double>& values);
+
+	std::size_t size() const { return _x.size(); }
+	const std::vector<double>& getX() const { return _x; }
+	const std::vector<double>& getY() const { return _y; }
+	const std::vector<double>& getZ() const { return _z; }
+	const std::vector<double>& getValues() const { return _values; }
+
+	/// Index of the data point nearest to pnt. Of equally near points the
+	/// one with the lowest index is taken. -1 if there are no data.
+	long getNearest(double const* pnt) const;
+
+	/// Indices (ascending) of the data points whose x and y are in the box
+	void getPointsInXYBox(double x_min, double x_max, double y_min,
+	                      double y_max, std::vector<long>& ids) const;
+
+private:
+	void getCell(double const* pnt, std::size_t* cell) const;
+
+	std::vector<double> _x, _y, _z, _values;
+
+	double _min[3];
+	double _cell_size[3];
+	std::size_t _n_cells[3];
+	// Data point ids of cell c are _cell_ids[_cell_begin[c], _cell_begin[c+1])
+	std::vector<std::size_t> _cell_begin;
+	std::vector<long> _cell_ids;
+};
+
+/**
+ * Binary file of a distributed medium property, the binary counterpart of a
+ * #MEDIUM_PROPERTIES_DISTRIBUTED file. All numbers are in the byte order of
+ * the machine:
+ *
+ *  char[8]   "OGSHETB1"
+ *  char[32]  mesh type ($MSH_TYPE), zero padded
+ *  char[32]  property name ($MMP_TYPE), zero padded
+ *  char[8]   distribution type ($DIS_TYPE), e.g. "NEAREST", "ELEMENT"
+ *  double    conversion factor ($CONVERSION_FACTOR)
+ *  uint64    number of values n
+ *  double[n] x, double[n] y, double[n] z, double[n] value
+ *            (for the element type "E" only double[n] value)
+ */
+struct HeterogeneousFieldFile
+{
+	std::string msh_type;
+	std::string mmp_type;
+	std::string dis_type;
+	double conversion_factor;
+	std::vector<double> x, y, z, values;
+
+	HeterogeneousFieldFile() : conversion_factor(1.0) {}
+
+	/// True if the file starts with the binary signature
+	static bool isBinary(const std::string& file_name);
+	bool read(const std::string& file_name);
+	bool write(const std::string& file_name) const;
+};
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * \copyright
+ * Copyright (c) 2015, OpenGeoSys Community (http://www.opengeosys.org)
+ *            Distributed under a Modified BSD License.
+ *              See accompanying file LICENSE.txt or
+ *              http://www.opengeosys.org/project/license
+ *
+ */
+
+#include "MaterialParameterCache.h"
+
+#include <algorithm>
+
+MaterialParameterCache::MaterialParameterCache(std::size_t n_elements)
+    : _n_elements(n_elements)
+{
+	for (int i = 0; i < NUMBER_OF_PARAMETERS; i++)
+	{
+		_entries[i].dependency = STATE_DEPENDENT;
+		_entries[i].n_values = 0;
+	}
+}
+
+void MaterialParameterCache::declare(Parameter parameter,
+                                     Dependency dependency,
+                                     std::size_t n_values)
+{
+	Entry& entry = _entries[parameter];
+	entry.dependency = dependency;
+	entry.n_values = n_values;
+	// Memory is allocated with the first value
+	std::vector<double>().swap(entry.values);
+	std::vector<const void*>().swap(entry.owner);
+}
+
+void MaterialParameterCache::setValues(Parameter parameter, std::size_t e,
+                                       const void* owner,
+                                       const double* values)
+{
+	Entry& entry = _entries[parameter];
+	if (entry.dependency == STATE_DEPENDENT || e >= _n_elements) return;
+	if (entry.owner.empty())
+	{
+		entry.values.resize(_n_elements * entry.n_values);
+		entry.owner.assign(_n_elements, static_cast<const void*>(NULL));
+	}
+	std::copy(values, values + entry.n_values,
+	          entry.values.begin() + e * entry.n_values);
+	entry.owner[e] = owner;
+}
+
+void MaterialParameterCache::refresh()
+{
+	for (int i = 0; i < NUMBER_OF_PARAMETERS; i++)
+		if (_entries[i].dependency == TIME_DEPENDENT)
+			std::fill(_entries[i].owner.begin(), _entries[i].owner.end(),
+			          static_cast<const void*>(NULL));
+}
+
+void MaterialParameterCache::clear()
+{
+	for (int i = 0; i < NUMBER_OF_PARAMETERS; i++)
+		std::fill(_entries[i].owner.begin(), _entries[i].owner.end(),
+		          static_cast<const void*>(NULL));
+}
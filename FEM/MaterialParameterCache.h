@@ -0,0 +1,90 @@
+/**
+ * \copyright
+ * Copyright (c) 2015, OpenGeoSys Community (http://www.opengeosys.org)
+ *            Distributed under a Modified BSD License.
+ *              See accompanying file LICENSE.txt or
+ *              http://www.opengeosys.org/project/license
+ *
+ */
+
+#ifndef material_parameter_cache_INC
+#define material_parameter_cache_INC
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Element-wise values of material parameters of one process.
+ *
+ * Each parameter is declared by the process as
+ * - STATE_INDEPENDENT: depends on static fields only. Computed once.
+ * - TIME_DEPENDENT: does not depend on the primary variables of the process.
+ *   Computed once per solution of the process (refresh()).
+ * - STATE_DEPENDENT: recomputed on every call, nothing is stored.
+ *
+ * Values are stored together with the material object which computed them,
+ * so that two media sharing an element (dual continua) do not mix.
+ */
+class MaterialParameterCache
+{
+public:
+	enum Parameter
+	{
+		PERMEABILITY = 0,
+		POROSITY,
+		HEAT_CONDUCTIVITY,
+		NUMBER_OF_PARAMETERS
+	};
+
+	enum Dependency
+	{
+		STATE_INDEPENDENT = 0,
+		TIME_DEPENDENT,
+		STATE_DEPENDENT
+	};
+
+	explicit MaterialParameterCache(std::size_t n_elements);
+
+	/// Declare the dependency and the number of values per element
+	void declare(Parameter parameter, Dependency dependency,
+	             std::size_t n_values);
+	Dependency getDependency(Parameter parameter) const
+	{
+		return _entries[parameter].dependency;
+	}
+
+	/// Stored values of element e computed by owner, NULL if not available
+	const double* getValues(Parameter parameter, std::size_t e,
+	                        const void* owner) const
+	{
+		const Entry& entry = _entries[parameter];
+		if (entry.dependency == STATE_DEPENDENT || e >= entry.owner.size() ||
+		    entry.owner[e] != owner)
+			return NULL;
+		return &entry.values[e * entry.n_values];
+	}
+
+	void setValues(Parameter parameter, std::size_t e, const void* owner,
+	               const double* values);
+
+	/// Discard the time dependent values
+	void refresh();
+
+	/// Discard all values
+	void clear();
+
+private:
+	struct Entry
+	{
+		Dependency dependency;
+		std::size_t n_values;
+		std::vector<double> values;
+		// Material object of the stored values, NULL if not valid
+		std::vector<const void*> owner;
+	};
+
+	const std::size_t _n_elements;
+	Entry _entries[NUMBER_OF_PARAMETERS];
+};
+
+#endif
@@ -12,8 +12,11 @@
 
 #include "Output.h"
 
+#include <algorithm>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <string>
 
 #include "Configure.h"
@@ -70,6 +73,9 @@ COutput::COutput()
 	tecplot_zone_share = false;  // 10.2012. WW
 	VARIABLESHARING = false;     // BG
 	_time = 0;
+	_pnt_resolved = false;
+	_pnt_interpolation = false;
+	_pnt_node = -1;
 #if defined(USE_PETSC) || \
     defined(USE_MPI)  //|| defined(other parallel libs)//03.3012. WW
 	mrank = 0;
@@ -93,6 +99,9 @@ COutput::COutput(size_t id)
 	tecplot_zone_share = false;  // 10.2012. WW
 	VARIABLESHARING = false;     // BG
 	_time = 0;
+	_pnt_resolved = false;
+	_pnt_interpolation = false;
+	_pnt_node = -1;
 #if defined(USE_PETSC) || \
     defined(USE_MPI)  //|| defined(other parallel libs)//03.3012. WW
 	mrank = 0;
@@ -476,6 +485,25 @@ ios::pos_type COutput::Read(std::ifstream& in_str,
 
 			continue;
 		}
+		// Observation points: values at the node or interpolated
+		if (line_string.find("$PNT_INTERPOLATION") != string::npos)
+		{
+			std::string interpolation_name;
+			in_str >> interpolation_name;
+			_pnt_interpolation = (interpolation_name.compare("ELEMENT") == 0);
+			in_str.ignore(MAX_ZEILE, '\n');
+			continue;
+		}
+		// Number of time series records buffered before writing,
+		// 0: at restart checkpoints and at the end only
+		if (line_string.find("$FLUSH_INTERVAL") != string::npos)
+		{
+			int n_records;
+			in_str >> n_records;
+			_pnt_buffer.setFlushInterval(n_records > 0 ? n_records : 0);
+			in_str.ignore(MAX_ZEILE, '\n');
+			continue;
+		}
 		// For teplot zone share. 10.2012. WW
 		if (line_string.find("$TECPLOT_ZONE_SHARE") != string::npos)
 		{
@@ -572,6 +600,16 @@ void COutput::Write(fstream* out_file)
 	*out_file << "  ";
 	*out_file << dat_type_name << "\n";
 	//--------------------------------------------------------------------
+	// Observation points
+	if (_pnt_interpolation)
+		*out_file << " $PNT_INTERPOLATION"
+		          << "\n"
+		          << "  ELEMENT"
+		          << "\n";
+	if (_pnt_buffer.getFlushInterval() != 1)
+		*out_file << " $FLUSH_INTERVAL"
+		          << "\n"
+		          << "  " << _pnt_buffer.getFlushInterval() << "\n";
 }
 
 /**************************************************************************
@@ -780,6 +818,24 @@ void COutput::WriteTECNodeData(fstream& tec_file)
 		else
 			nidx_dm[2] = -1;
 	}
+	// MFP values of all nodes, evaluated per quantity
+	std::vector<std::vector<double> > mfp_nod_values(mfp_value_vector.size());
+	if (getProcessType() != FiniteElement::MASS_TRANSPORT &&
+	    !mfp_value_vector.empty())
+	{
+		std::vector<long> nod_ids(m_msh->GetNodesNumber(false));
+		for (size_t j = 0; j < nod_ids.size(); j++)
+			nod_ids[j] = m_msh->nod_vector[j]->GetIndex();
+		for (size_t k = 0; k < mfp_value_vector.size(); k++)
+		{
+			mfp_nod_values[k].resize(nod_ids.size());
+			if (nod_ids.empty()) continue;
+			MFPGetNodeValues(
+			    nod_ids.size(), &nod_ids[0], mfp_value_vector[k],
+			    atoi(&mfp_value_vector[k][mfp_value_vector[k].size() - 1]) - 1,
+			    &mfp_nod_values[k][0]);
+		}
+	}
 	// 08.2012. WW
 	bool out_coord = true;
 	if (tecplot_zone_share && _new_file_opened) out_coord = false;
@@ -901,16 +957,8 @@ void COutput::WriteTECNodeData(fstream& tec_file)
 			}
 			// OK4704
 			for (size_t k = 0; k < mfp_value_vector.size(); k++)
-				// tec_file <<
-				// MFPGetNodeValue(m_msh->nod_vector[j]->GetIndex(),mfp_value_vector[k])
-				// << " "; //NB
-				tec_file
-				    << MFPGetNodeValue(
-				           n_id, mfp_value_vector[k],
-				           atoi(
-				               &mfp_value_vector[k][mfp_value_vector[k].size() -
-				                                    1]) -
-				               1) << " ";  // NB: MFP output for all phases
+				tec_file << mfp_nod_values[k][j]
+				         << " ";  // NB: MFP output for all phases
 		}
 		tec_file << "\n";
 	}
@@ -1351,6 +1399,17 @@ double COutput::NODWritePLYDataTEC(int number)
 	//   of old_nodes_vector: " << old_nodes_vector.size() << "\n";
 	// bool b_specified_pcs = (m_pcs != NULL); //NW m_pcs =
 	// PCSGet(pcs_type_name);
+	// MFP values along the polyline, evaluated per quantity
+	std::vector<std::vector<double> > mfp_nod_values(mfp_value_vector.size());
+	for (size_t k = 0; k < mfp_value_vector.size(); k++)
+	{
+		mfp_nod_values[k].resize(nodes_vector.size());
+		if (nodes_vector.empty()) continue;
+		MFPGetNodeValues(
+		    nodes_vector.size(), &nodes_vector[0], mfp_value_vector[k],
+		    atoi(&mfp_value_vector[k][mfp_value_vector[k].size() - 1]) - 1,
+		    &mfp_nod_values[k][0]);
+	}
 	for (size_t j(0); j < nodes_vector.size(); j++)
 	{
 		//		tec_file << m_ply->getSBuffer()[j] << " ";
@@ -1419,14 +1478,8 @@ double COutput::NODWritePLYDataTEC(int number)
 		// MFP //OK4704
 		// OK4704
 		for (size_t k = 0; k < mfp_value_vector.size(); k++)
-			//     tec_file << MFPGetNodeValue(gnode,mfp_value_vector[k],0) << "
-			//     "; //NB
-			tec_file
-			    << MFPGetNodeValue(
-			           gnode, mfp_value_vector[k],
-			           atoi(&mfp_value_vector[k][mfp_value_vector[k].size() -
-			                                     1]) -
-			               1) << " ";  // NB: MFP output for all phases
+			tec_file << mfp_nod_values[k][j]
+			         << " ";  // NB: MFP output for all phases
 
 		tec_file << "\n";
 	}
@@ -1434,6 +1487,122 @@ double COutput::NODWritePLYDataTEC(int number)
 	return flux_sum;
 }
 
+namespace
+{
+/// Elements of the highest dimension of the mesh
+bool isInterpolationElement(CFEMesh const& msh, CElem const& elem)
+{
+	if (elem.GetDimension() != msh.GetMaxElementDim()) return false;
+	// A transformation is needed for elements of lower dimension than space
+	return elem.GetDimension() == abs(msh.GetCoordinateFlag()) / 10 ||
+	       elem.getTransformTensor() != NULL;
+}
+
+/// Values N of the linear shape functions at the unit coordinates u and the
+/// real coordinates x there
+void evaluateShapeFunctions(FiniteElement::CElement& fem, CElem* elem,
+                            double* u, std::vector<double>& N, double* x)
+{
+	std::vector<double> e(N.size(), 0.0);
+	fem.setUnitCoordinates(u);
+	fem.ComputeShapefct(1);
+	x[0] = x[1] = x[2] = 0.0;
+	for (size_t i = 0; i < N.size(); i++)
+	{
+		e[i] = 1.0;
+		N[i] = fem.interpolate(&e[0]);
+		e[i] = 0.0;
+		double const* const x_i(elem->GetNode(i)->getData());
+		for (int k = 0; k < 3; k++)
+			x[k] += N[i] * x_i[k];
+	}
+}
+
+/// Values N of the linear shape functions of elem at the point pnt. Newton
+/// iteration for the unit coordinates, in the sense of least squares for
+/// elements of lower dimension than space. False if pnt is not in elem.
+bool getShapeFunctionsAtPoint(FiniteElement::CElement& fem, CElem* elem,
+                              double const* pnt, std::vector<double>& N)
+{
+	fem.ConfigElement(elem);
+	const int dim = fem.Dim();
+	N.resize(elem->GetNodesNumber(false));
+
+	double h2 = 0.0;
+	for (size_t i = 1; i < N.size(); i++)
+		h2 = max(h2, MathLib::sqrDist(elem->GetNode(0)->getData(),
+		                              elem->GetNode(i)->getData()));
+	const double tol2 = 1.e-20 * h2;
+	const double du = 1.e-6;
+
+	double u[4] = {0.0, 0.0, 0.0, 0.0};
+	double x[3], x_j[3], r[3], J[3][3];
+	bool converged = false;
+	for (int it = 0; it < 25; it++)
+	{
+		evaluateShapeFunctions(fem, elem, u, N, x);
+		for (int k = 0; k < 3; k++)
+			r[k] = pnt[k] - x[k];
+		if (r[0] * r[0] + r[1] * r[1] + r[2] * r[2] <= tol2)
+		{
+			converged = true;
+			break;
+		}
+		// dx/du by differences, exact for elements with linear mapping
+		for (int j = 0; j < dim; j++)
+		{
+			u[j] += du;
+			evaluateShapeFunctions(fem, elem, u, N, x_j);
+			u[j] -= du;
+			for (int k = 0; k < 3; k++)
+				J[k][j] = (x_j[k] - x[k]) / du;
+		}
+		// Normal equations (J^T J) delta_u = J^T r
+		double A[3][4];
+		for (int i = 0; i < dim; i++)
+		{
+			A[i][dim] = 0.0;
+			for (int k = 0; k < 3; k++)
+				A[i][dim] += J[k][i] * r[k];
+			for (int j = 0; j < dim; j++)
+			{
+				A[i][j] = 0.0;
+				for (int k = 0; k < 3; k++)
+					A[i][j] += J[k][i] * J[k][j];
+			}
+		}
+		for (int i = 0; i < dim; i++)
+		{
+			int p = i;
+			for (int l = i + 1; l < dim; l++)
+				if (fabs(A[l][i]) > fabs(A[p][i])) p = l;
+			if (!(fabs(A[p][i]) > 0.0)) return false;
+			for (int j = 0; j <= dim; j++)
+				swap(A[i][j], A[p][j]);
+			for (int l = i + 1; l < dim; l++)
+			{
+				const double f = A[l][i] / A[i][i];
+				for (int j = i; j <= dim; j++)
+					A[l][j] -= f * A[i][j];
+			}
+		}
+		for (int i = dim - 1; i >= 0; i--)
+		{
+			double delta = A[i][dim];
+			for (int j = i + 1; j < dim; j++)
+				delta -= A[i][j] * A[j][dim];
+			A[i][dim] = delta / A[i][i];
+			u[i] += A[i][dim];
+		}
+	}
+	if (!converged) return false;
+	// Inside if all shape functions are non negative
+	for (size_t i = 0; i < N.size(); i++)
+		if (N[i] < -1.e-8) return false;
+	return true;
+}
+}
+
 /**************************************************************************
    FEMLib-Method:
    Task:
@@ -1446,11 +1615,15 @@ double COutput::NODWritePLYDataTEC(int number)
 **************************************************************************/
 void COutput::NODWritePNTDataTEC(double time_current, int time_step_number)
 {
-	const long msh_node_number(
-	    m_msh->GetNODOnPNT(static_cast<const GEOLIB::Point*>(getGeoObj())));
-	if (msh_node_number < 0)  // 11.06.2012. WW
+	if (!m_msh)
+	{
+		cout << "Warning in COutput::NODWritePNTDataTEC - no MSH data: "
+		     << endl;
 		return;
-	ScreenMessage2("Node %d found for %s\n", msh_node_number, geo_name.data());
+	}
+	if (!resolveObservationPoint())  // 11.06.2012. WW
+		return;
+	const long msh_node_number(_pnt_node);
 
 #ifdef USE_PETSC
 	if (!m_msh->isNodeLocal(msh_node_number)) return;
@@ -1467,37 +1640,13 @@ void COutput::NODWritePNTDataTEC(double time_current, int time_step_number)
 		}
 
 	// File handling
-	std::string tec_file_name(file_base_name + "_time_");
-	addInfoToFileName(tec_file_name, true, true, true);
-
-	if (!_new_file_opened) remove(tec_file_name.c_str());  // WW
-	//......................................................................
-	fstream tec_file(tec_file_name.data(), ios::app | ios::out);
-
-	tec_file.setf(ios::scientific, ios::floatfield);
-	tec_file.precision(12);
-	if (!tec_file.good()) return;
-	tec_file.seekg(0L, ios::beg);
-#ifdef SUPERCOMPUTER
-	// kg44 buffer the output
-	char mybuffer[MY_IO_BUFSIZE * MY_IO_BUFSIZE];
-	tec_file.rdbuf()->pubsetbuf(mybuffer, MY_IO_BUFSIZE * MY_IO_BUFSIZE);
-//
-#endif
-	//--------------------------------------------------------------------
-	// Tests
-	//......................................................................
-	//	CFEMesh* m_msh = GetMSH();
-	//	m_msh = GetMSH();
-	if (!m_msh)
+	if (!_pnt_buffer.isOpen())
 	{
-		cout << "Warning in COutput::NODWritePNTDataTEC - no MSH data: "
-		     << endl;
-		tec_file << "Warning in COutput::NODWritePNTDataTEC - no MSH data: "
-		         << "\n";
-		tec_file.close();
-		return;
+		std::string tec_file_name(file_base_name + "_time_");
+		addInfoToFileName(tec_file_name, true, true, true);
+		_pnt_buffer.open(tec_file_name, !_new_file_opened);  // WW
 	}
+	std::ostream& tec_file(_pnt_buffer.record());
 
 	//----------------------------------------------------------------------
 	// NIDX for output variables
@@ -1608,11 +1757,11 @@ void COutput::NODWritePNTDataTEC(double time_current, int time_step_number)
 	CRFProcess* m_pcs_out = NULL;
 
 	// fetch geometric entities, especial the associated GEOLIB::Point vector
-	if (pcs_vector[0] == NULL) return;
-
-	// 11.06.2012. WW// long msh_node_number(m_msh->GetNODOnPNT(
-	//                             static_cast<const GEOLIB::Point*>
-	//                             (getGeoObj())));
+	if (pcs_vector[0] == NULL)
+	{
+		_pnt_buffer.endRecord();
+		return;
+	}
 
 	// Mass transport
 	if (getProcessType() == FiniteElement::MASS_TRANSPORT)
@@ -1644,8 +1793,7 @@ void COutput::NODWritePNTDataTEC(double time_current, int time_step_number)
 								               nod_value_name) +
 								           timelevel;
 								tec_file << sep
-								         << m_pcs_out->GetNodeValue(
-								                msh_node_number, nidx);
+								         << getPNTNodeValue(m_pcs_out, nidx);
 							}
 							timelevel++;
 						}
@@ -1669,6 +1817,7 @@ void COutput::NODWritePNTDataTEC(double time_current, int time_step_number)
 				tec_file
 				    << "Warning in COutput::NODWritePLYDataTEC - no PCS data"
 				    << "\n";
+				_pnt_buffer.endRecord();
 				return;
 			}
 			//..................................................................
@@ -1676,8 +1825,7 @@ void COutput::NODWritePNTDataTEC(double time_current, int time_step_number)
 			if (!(_nod_value_vector[i].compare("FLUX") == 0))
 			{
 				//-----------------------------------------WW
-				double val_n =
-				    m_pcs->GetNodeValue(msh_node_number, NodeIndex[i]);
+				double val_n = getPNTNodeValue(m_pcs, NodeIndex[i]);
 				tec_file << sep << val_n;
 				m_pcs = GetPCS(_nod_value_vector[i]);
 				if (m_pcs->type == 1212 &&
@@ -1699,14 +1847,14 @@ void COutput::NODWritePNTDataTEC(double time_current, int time_step_number)
 		if (dm_pcs && !isCSV)  // WW
 		{
 			for (size_t i = 0; i < ns; i++)
-				ss[i] = dm_pcs->GetNodeValue(msh_node_number, stress_i[i]);
+				ss[i] = getPNTNodeValue(dm_pcs, stress_i[i]);
 			tec_file << -DeviatoricStress(ss) / 3.0 << " ";
 			tec_file << sqrt(3.0 *
 			                 TensorMutiplication2(
 			                     ss, ss, m_msh->GetCoordinateFlag() / 10) /
 			                 2.0) << "  ";
 			for (size_t i = 0; i < ns; i++)
-				ss[i] = dm_pcs->GetNodeValue(msh_node_number, strain_i[i]);
+				ss[i] = getPNTNodeValue(dm_pcs, strain_i[i]);
 			DeviatoricStress(ss);
 			tec_file << sqrt(
 			    3.0 *
@@ -1715,16 +1863,114 @@ void COutput::NODWritePNTDataTEC(double time_current, int time_step_number)
 		}
 		// OK411
 		for (size_t k = 0; k < mfp_value_vector.size(); k++)
-			tec_file
-			    << MFPGetNodeValue(
-			           msh_node_number, mfp_value_vector[k],
-			           atoi(&mfp_value_vector[k][mfp_value_vector[k].size() -
-			                                     1]) -
-			               1) << " ";  // NB
+			tec_file << getPNTMFPValue(
+			                mfp_value_vector[k],
+			                atoi(&mfp_value_vector[k]
+			                         [mfp_value_vector[k].size() - 1]) -
+			                    1) << " ";  // NB
 	}
 	tec_file << "\n";
-	//----------------------------------------------------------------------
-	tec_file.close();  // kg44 close file
+	_pnt_buffer.endRecord();
+}
+
+/**************************************************************************
+   FEMLib-Method:
+   Task: Find the mesh entities of an observation point once: the node at
+         the point and, for $PNT_INTERPOLATION ELEMENT, the element
+         containing the point with the values of its shape functions there.
+         Returns false if the point has no node.
+**************************************************************************/
+bool COutput::resolveObservationPoint()
+{
+	if (_pnt_resolved) return _pnt_node >= 0;
+	_pnt_resolved = true;
+
+	const GEOLIB::Point* pnt(static_cast<const GEOLIB::Point*>(getGeoObj()));
+	_pnt_node = m_msh->GetNODOnPNT(pnt);
+	_pnt_nodes.clear();
+	_pnt_weights.clear();
+
+	if (_pnt_interpolation)
+	{
+		// Nearest node, the elements around it are searched first
+		long nearest = _pnt_node;
+		if (nearest < 0)
+		{
+			double min_dist = std::numeric_limits<double>::max();
+			for (size_t i = 0; i < m_msh->NodesInUsage(); i++)
+			{
+				if (!m_msh->isNodeLocal(i)) continue;
+				const double dist = MathLib::sqrDist(
+				    m_msh->nod_vector[i]->getData(), pnt->getData());
+				if (dist < min_dist)
+				{
+					min_dist = dist;
+					nearest = i;
+				}
+			}
+		}
+
+		FiniteElement::CElement fem(m_msh->GetCoordinateFlag());
+		std::vector<double> N;
+		CElem* found = NULL;
+		if (nearest >= 0)
+		{
+			MeshLib::IndexRange const connected(
+			    m_msh->nod_vector[nearest]->getConnectedElementIDs());
+			for (size_t i = 0; i < connected.size() && !found; i++)
+			{
+				CElem* elem = m_msh->ele_vector[connected[i]];
+				if (isInterpolationElement(*m_msh, *elem) &&
+				    getShapeFunctionsAtPoint(fem, elem, pnt->getData(), N))
+					found = elem;
+			}
+		}
+		for (size_t i = 0; i < m_msh->ele_vector.size() && !found; i++)
+		{
+			CElem* elem = m_msh->ele_vector[i];
+			if (isInterpolationElement(*m_msh, *elem) &&
+			    getShapeFunctionsAtPoint(fem, elem, pnt->getData(), N))
+				found = elem;
+		}
+
+		if (found)
+		{
+			for (size_t i = 0; i < N.size(); i++)
+			{
+				_pnt_nodes.push_back(found->GetNodeIndex(i));
+				_pnt_weights.push_back(N[i]);
+			}
+			if (_pnt_node < 0) _pnt_node = nearest;
+			ScreenMessage2("Element %d found for %s\n", found->GetIndex(),
+			               geo_name.data());
+		}
+		else
+			ScreenMessage2(
+			    "Warning: no element contains %s, node values are written\n",
+			    geo_name.data());
+	}
+
+	if (_pnt_node >= 0)
+		ScreenMessage2("Node %d found for %s\n", _pnt_node, geo_name.data());
+	return _pnt_node >= 0;
+}
+
+double COutput::getPNTNodeValue(CRFProcess* pcs, int idx) const
+{
+	if (_pnt_nodes.empty()) return pcs->GetNodeValue(_pnt_node, idx);
+	double val = 0.0;
+	for (size_t i = 0; i < _pnt_nodes.size(); i++)
+		val += _pnt_weights[i] * pcs->GetNodeValue(_pnt_nodes[i], idx);
+	return val;
+}
+
+double COutput::getPNTMFPValue(const std::string& name, int phase) const
+{
+	if (_pnt_nodes.empty()) return MFPGetNodeValue(_pnt_node, name, phase);
+	double val = 0.0;
+	for (size_t i = 0; i < _pnt_nodes.size(); i++)
+		val += _pnt_weights[i] * MFPGetNodeValue(_pnt_nodes[i], name, phase);
+	return val;
 }
 
 void COutput::WriteRFOHeader(fstream& rfo_file)
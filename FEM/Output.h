@@ -14,6 +14,7 @@
 #include "DistributionInfo.h"
 #include "GeoInfo.h"
 #include "ProcessInfo.h"
+#include "TimeSeriesBuffer.h"
 
 #include <iostream>
 #include <vector>
@@ -129,6 +130,7 @@ public:
 	void WriteTECElementData(std::fstream&, int);
 	double NODWritePLYDataTEC(int);
 	void NODWritePNTDataTEC(double, int);
+	void flushTimeSeries() { _pnt_buffer.flush(); }
 	void ELEWriteDOMDataTEC();
 	void WriteELEValuesTECHeader(std::fstream&);
 	void WriteELEValuesTECData(std::fstream&);
@@ -256,6 +258,19 @@ private:
 	/// Tecplot share zone
 	bool tecplot_zone_share;  // 10.2012. WW
 
+	// Observation point (GEO_TYPE POINT), resolved once
+	bool resolveObservationPoint();
+	double getPNTNodeValue(CRFProcess* pcs, int idx) const;
+	double getPNTMFPValue(const std::string& name, int phase) const;
+	bool _pnt_resolved;
+	/// $PNT_INTERPOLATION ELEMENT: interpolate in the element containing the
+	/// point instead of taking the values of the node at the point
+	bool _pnt_interpolation;
+	long _pnt_node;
+	std::vector<long> _pnt_nodes;
+	std::vector<double> _pnt_weights;
+	TimeSeriesBuffer _pnt_buffer;
+
 #if defined(USE_PETSC) || \
     defined(USE_MPI)  //|| defined(other parallel libs)//03.3012. WW
 	int mrank;
@@ -0,0 +1,219 @@
+/**
+ * \copyright
+ * Copyright (c) 2015, OpenGeoSys Community (http://www.opengeosys.org)
+ *            Distributed under a Modified BSD License.
+ *              See accompanying file LICENSE.txt or
+ *              http://www.opengeosys.org/project/license
+ *
+ */
+
+#include "ProcessScheduler.h"
+
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "display.h"
+
+#include "equation_class.h"
+#include "rf_mfp_new.h"
+#include "rf_mmp_new.h"
+#include "rf_msp_new.h"
+#include "rf_pcs.h"
+#include "rf_st_new.h"
+#include "rf_tim_new.h"
+
+namespace
+{
+bool intersects(const std::set<std::string>& a, const std::set<std::string>& b)
+{
+	for (std::set<std::string>::const_iterator it = a.begin(); it != a.end();
+	     ++it)
+		if (b.count(*it)) return true;
+	return false;
+}
+}
+
+ProcessScheduler::ProcessScheduler(const std::vector<CRFProcess*>& processes,
+                                   int max_concurrent)
+    : _max_concurrent(std::max(1, max_concurrent))
+{
+	// Variables read and written by the processes of the current wave
+	std::set<std::string> wave_reads, wave_writes;
+	bool wave_is_concurrent = false;
+	for (std::size_t i = 0; i < processes.size(); i++)
+	{
+		CRFProcess* pcs = processes[i];
+		std::set<std::string> reads, writes;
+		getReadVariables(*pcs, reads);
+		getWrittenVariables(*pcs, writes);
+		const bool concurrent = canRunConcurrently(*pcs);
+		if (!(concurrent && wave_is_concurrent) ||
+		    intersects(writes, wave_reads) || intersects(writes, wave_writes) ||
+		    intersects(reads, wave_writes))
+		{
+			_waves.push_back(std::vector<CRFProcess*>());
+			wave_reads.clear();
+			wave_writes.clear();
+		}
+		_waves.back().push_back(pcs);
+		wave_reads.insert(reads.begin(), reads.end());
+		wave_writes.insert(writes.begin(), writes.end());
+		wave_is_concurrent = concurrent;
+	}
+
+	std::size_t n_concurrent = 0;
+	for (std::size_t i = 0; i < _waves.size(); i++)
+		if (_waves[i].size() > 1) n_concurrent += _waves[i].size();
+	ScreenMessage("-> %d of %d processes run concurrently, %d waves\n",
+	              static_cast<int>(n_concurrent),
+	              static_cast<int>(processes.size()),
+	              static_cast<int>(_waves.size()));
+}
+
+ProcessScheduler::~ProcessScheduler()
+{
+	for (std::size_t i = 0; i < _eqs.size(); i++)
+		delete _eqs[i];
+}
+
+bool ProcessScheduler::canRunConcurrently(const CRFProcess& pcs)
+{
+#if defined(USE_PETSC) || defined(USE_MPI) || !defined(NEW_EQS)
+	(void)pcs;
+	return false;
+#else
+	if (pcs.getProcessType() != FiniteElement::MASS_TRANSPORT) return false;
+	if (pcs.pcs_is_cpl_overlord || pcs.pcs_is_cpl_underling) return false;
+	if (hasAnyProcessDeactivatedSubdomains || pcs.mobile_nodes_flag == 1)
+		return false;
+	// The time step control is shared by all components
+	const CTimeDiscretization* tim = pcs.GetTimeStepping();
+	if (!tim || tim->time_control_type != TimeControlType::INVALID ||
+	    tim->GetPITimeStepCrtlType() > 0 || tim->isPIDControl())
+		return false;
+	return true;
+#endif
+}
+
+/**************************************************************************
+   FEMLib-Method:
+   Task: Variables which the assembly of a process reads besides its own
+         primary variables and the flow field
+**************************************************************************/
+void ProcessScheduler::getReadVariables(const CRFProcess& pcs,
+                                        std::set<std::string>& variables)
+{
+	for (std::size_t i = 0; i < mfp_vector.size(); i++)
+	{
+		const CFluidProperties* mfp = mfp_vector[i];
+		variables.insert(mfp->density_pcs_name_vector.begin(),
+		                 mfp->density_pcs_name_vector.end());
+		variables.insert(mfp->viscosity_pcs_name_vector.begin(),
+		                 mfp->viscosity_pcs_name_vector.end());
+		variables.insert(mfp->specific_heat_capacity_pcs_name_vector.begin(),
+		                 mfp->specific_heat_capacity_pcs_name_vector.end());
+		variables.insert(mfp->heat_conductivity_pcs_name_vector.begin(),
+		                 mfp->heat_conductivity_pcs_name_vector.end());
+		variables.insert(mfp->enthalpy_pcs_name_vector.begin(),
+		                 mfp->enthalpy_pcs_name_vector.end());
+	}
+	for (std::size_t i = 0; i < mmp_vector.size(); i++)
+	{
+		const CMediumProperties* mmp = mmp_vector[i];
+		variables.insert(mmp->pcs_name_vector.begin(),
+		                 mmp->pcs_name_vector.end());
+		variables.insert(mmp->getPorosityPCSNames().begin(),
+		                 mmp->getPorosityPCSNames().end());
+	}
+	for (std::size_t i = 0; i < msp_vector.size(); i++)
+	{
+		const SolidProp::CSolidProperties* msp = msp_vector[i];
+		variables.insert(msp->capacity_pcs_name_vector.begin(),
+		                 msp->capacity_pcs_name_vector.end());
+		variables.insert(msp->conductivity_pcs_name_vector.begin(),
+		                 msp->conductivity_pcs_name_vector.end());
+	}
+	for (std::size_t i = 0; i < st_vector.size(); i++)
+	{
+		const CSourceTerm* st = st_vector[i];
+		if (st->getProcessType() != pcs.getProcessType()) continue;
+		if (!st->pcs_pv_name_cond.empty())
+			variables.insert(st->pcs_pv_name_cond);
+		if (st->has_constrain) variables.insert(st->constrain_var_name);
+	}
+}
+
+void ProcessScheduler::getWrittenVariables(const CRFProcess& pcs,
+                                           std::set<std::string>& variables)
+{
+	for (std::size_t k = 0; k < pcs.GetPrimaryVNumber(); k++)
+		variables.insert(pcs.GetPrimaryVName(static_cast<int>(k)));
+}
+
+/**************************************************************************
+   FEMLib-Method:
+   Task: Execute the processes of a wave on disjoint groups of threads
+**************************************************************************/
+double ProcessScheduler::executeWave(std::size_t i, int loop_process_number)
+{
+	const std::vector<CRFProcess*>& wave = _waves[i];
+	const int n = static_cast<int>(wave.size());
+	std::vector<double> errors(n, 1.0e+8);
+#ifdef _OPENMP
+	const int n_groups =
+	    std::min(std::min(n, _max_concurrent), omp_get_max_threads());
+#else
+	const int n_groups = 1;
+#endif
+	if (n_groups < 2)
+	{
+		for (int k = 0; k < n; k++)
+			errors[k] = wave[k]->ExecuteNonLinear(loop_process_number);
+		return errors.back();
+	}
+
+#ifdef _OPENMP
+	// All but the first process get an equation system of their own
+	std::vector<Math_Group::Linear_EQS*> shared_eqs(n);
+	for (int k = 0; k < n; k++)
+	{
+		CRFProcess* pcs = wave[k];
+		shared_eqs[k] = pcs->eqs_new;
+		if (k == 0) continue;
+		const std::size_t j =
+		    std::find(_eqs_owners.begin(), _eqs_owners.end(), pcs) -
+		    _eqs_owners.begin();
+		if (j == _eqs_owners.size())
+		{
+			_eqs_owners.push_back(pcs);
+			_eqs.push_back(new Math_Group::Linear_EQS(
+			    pcs->eqs_new->getSparseTable(), pcs->GetPrimaryVNumber()));
+		}
+		pcs->eqs_new = _eqs[j];
+	}
+	// The mesh state set by the assembly is the same for all processes
+	wave[0]->m_msh->SwitchOnQuadraticNodes(false);
+
+	// Only the linear solvers, which run concurrently, share the threads.
+	// The serialized assembly keeps the full team.
+	const int group_size = std::max(1, omp_get_max_threads() / n_groups);
+	for (int k = 0; k < n; k++)
+		wave[k]->eqs_new->SetNumThreads(group_size);
+	const int max_active_levels = omp_get_max_active_levels();
+	if (max_active_levels < 2) omp_set_max_active_levels(2);
+#pragma omp parallel for num_threads(n_groups) schedule(dynamic, 1)
+	for (int k = 0; k < n; k++)
+		errors[k] = wave[k]->ExecuteNonLinear(loop_process_number);
+	omp_set_max_active_levels(max_active_levels);
+
+	for (int k = 0; k < n; k++)
+	{
+		wave[k]->eqs_new->SetNumThreads(0);
+		wave[k]->eqs_new = shared_eqs[k];
+	}
+#endif
+	return errors.back();
+}
@@ -0,0 +1,77 @@
+/**
+ * \copyright
+ * Copyright (c) 2015, OpenGeoSys Community (http://www.opengeosys.org)
+ *            Distributed under a Modified BSD License.
+ *              See accompanying file LICENSE.txt or
+ *              http://www.opengeosys.org/project/license
+ *
+ */
+
+#ifndef process_scheduler_INC
+#define process_scheduler_INC
+
+#include <cstddef>
+#include <set>
+#include <string>
+#include <vector>
+
+class CRFProcess;
+namespace Math_Group
+{
+class Linear_EQS;
+}
+
+/**
+ * Concurrent execution of the processes of a time step which do not depend
+ * on each other ($PARALLEL_PROCESSES in the NUM file).
+ *
+ * A process writes its primary variables and reads the variables declared
+ * by the fluid, medium and solid properties and by the conditions of the
+ * source terms. Two processes are independent if neither of them writes a
+ * variable the other one reads or writes. A process runs alone if it
+ * - is a partner of an inner coupling ($COUPLING_CONTROL),
+ * - has deactivated subdomains or moving nodes,
+ * - has an adaptive time step control, or
+ * - is not a mass transport component, whose assembly does not read
+ *   further variables.
+ *
+ * The processes are grouped into consecutive waves of independent processes,
+ * so that the order of dependent processes is kept. The processes of a wave
+ * run concurrently, each with its own linear equation system. The element
+ * assembly, which shares the material objects, is serialized and uses all
+ * threads; the linear solves run concurrently on disjoint groups of threads.
+ */
+class ProcessScheduler
+{
+public:
+	/// \param max_concurrent Maximum number of processes running at once
+	ProcessScheduler(const std::vector<CRFProcess*>& processes,
+	                 int max_concurrent);
+	~ProcessScheduler();
+
+	std::size_t getNumberOfWaves() const { return _waves.size(); }
+	const std::vector<CRFProcess*>& getWave(std::size_t i) const
+	{
+		return _waves[i];
+	}
+
+	/// Nonlinear solution of the processes of wave i.
+	/// Returns the error of the last process of the wave.
+	double executeWave(std::size_t i, int loop_process_number);
+
+private:
+	static bool canRunConcurrently(const CRFProcess& pcs);
+	static void getReadVariables(const CRFProcess& pcs,
+	                             std::set<std::string>& variables);
+	static void getWrittenVariables(const CRFProcess& pcs,
+	                                std::set<std::string>& variables);
+
+	const int _max_concurrent;
+	std::vector<std::vector<CRFProcess*> > _waves;
+	// Linear equation systems of the processes which do not use the one
+	// shared with other processes of the same mesh
+	std::vector<CRFProcess*> _eqs_owners;
+	std::vector<Math_Group::Linear_EQS*> _eqs;
+};
+
+#endif
@@ -0,0 +1,90 @@
+/**
+ * \copyright
+ * Copyright (c) 2015, OpenGeoSys Community (http://www.opengeosys.org)
+ *            Distributed under a Modified BSD License.
+ *              See accompanying file LICENSE.txt or
+ *              http://www.opengeosys.org/project/license
+ *
+ */
+
+#include "ProcessSnapshot.h"
+
+#include <algorithm>
+#include <ctime>
+
+#include "ElementValueDM.h"
+#include "rf_pcs.h"
+
+ProcessSnapshot::ProcessSnapshot()
+    : _valid(false), _n_restores(0), _take_time(0.0), _restore_time(0.0)
+{
+}
+
+/**************************************************************************
+   FEMLib-Method:
+   Task: Copy the state of pcs to (STORE) or from (LOAD) the buffer, or
+         only count its size (COUNT). Returns the number of values.
+**************************************************************************/
+std::size_t ProcessSnapshot::transfer(CRFProcess& pcs, Mode mode)
+{
+	std::size_t pos = 0;
+
+	// Node values, one array per variable and time level
+	const std::size_t n_nodes = pcs.m_msh->GetNodesNumber(true);
+	for (std::size_t i = 0; i < pcs.nod_val_vector.size(); i++)
+		pos += transferBlock(pcs.nod_val_vector[i], n_nodes, pos, mode);
+
+	// Element values, one array per element
+	const std::size_t n_evals = pcs.getElementValueNameVector().size();
+	if (n_evals > 0)
+		for (std::size_t e = 0; e < pcs.ele_val_vector.size(); e++)
+			pos += transferBlock(pcs.ele_val_vector[e], n_evals, pos, mode);
+
+	// Gauss point values of the deformation
+	if (isDeformationProcess(pcs.getProcessType()))
+		for (std::size_t e = 0; e < ele_value_dm.size(); e++)
+		{
+			FiniteElement::ElementValue_DM* ev = ele_value_dm[e];
+			if (!ev) continue;
+			Matrix* const matrices[] = {
+			    ev->Stress_last_ts, ev->Stress_current_ts, ev->dTotalStress,
+			    ev->Strain,         ev->Strain_last_ts,    ev->pStrain,
+			    ev->y_surface,      ev->prep0,             ev->e_i,
+			    ev->xi,             ev->MatP};
+			for (std::size_t k = 0; k < sizeof(matrices) / sizeof(Matrix*);
+			     k++)
+				if (matrices[k])
+					pos += transferBlock(matrices[k]->getEntryArray(),
+					                     matrices[k]->Size(), pos, mode);
+		}
+	return pos;
+}
+
+std::size_t ProcessSnapshot::transferBlock(double* values, std::size_t n,
+                                           std::size_t pos, Mode mode)
+{
+	if (mode == STORE)
+		std::copy(values, values + n, _buffer.begin() + pos);
+	else if (mode == LOAD)
+		std::copy(_buffer.begin() + pos, _buffer.begin() + pos + n, values);
+	return n;
+}
+
+void ProcessSnapshot::take(CRFProcess& pcs)
+{
+	const clock_t start = clock();
+	// The layout is fixed after the processes are created
+	if (_buffer.empty()) _buffer.resize(transfer(pcs, COUNT));
+	transfer(pcs, STORE);
+	_valid = true;
+	_take_time += (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+void ProcessSnapshot::restore(CRFProcess& pcs)
+{
+	if (!_valid) return;
+	const clock_t start = clock();
+	transfer(pcs, LOAD);
+	_n_restores++;
+	_restore_time += (double)(clock() - start) / CLOCKS_PER_SEC;
+}
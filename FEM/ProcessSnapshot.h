@@ -0,0 +1,63 @@
+/**
+ * \copyright
+ * Copyright (c) 2015, OpenGeoSys Community (http://www.opengeosys.org)
+ *            Distributed under a Modified BSD License.
+ *              See accompanying file LICENSE.txt or
+ *              http://www.opengeosys.org/project/license
+ *
+ */
+
+#ifndef process_snapshot_INC
+#define process_snapshot_INC
+
+#include <cstddef>
+#include <vector>
+
+class CRFProcess;
+
+/**
+ * State of a process at the beginning of a time step: all node values,
+ * the element values and, for deformation processes, the Gauss point
+ * values (stress, strain, ...). The state is stored in one buffer, which is
+ * allocated by the first take(), and is restored if the time step is
+ * rejected.
+ */
+class ProcessSnapshot
+{
+public:
+	ProcessSnapshot();
+
+	void take(CRFProcess& pcs);
+	void restore(CRFProcess& pcs);
+
+	/// True from take() until invalidate(), i.e. until the step is accepted
+	bool isValid() const { return _valid; }
+	void invalidate() { _valid = false; }
+
+	// Statistics
+	std::size_t getNumberOfRestores() const { return _n_restores; }
+	/// Bytes of one snapshot
+	std::size_t getBytes() const { return _buffer.size() * sizeof(double); }
+	/// CPU time [s] spent in take() and in restore()
+	double getTakeTime() const { return _take_time; }
+	double getRestoreTime() const { return _restore_time; }
+
+private:
+	enum Mode
+	{
+		COUNT,
+		STORE,
+		LOAD
+	};
+	std::size_t transfer(CRFProcess& pcs, Mode mode);
+	std::size_t transferBlock(double* values, std::size_t n, std::size_t pos,
+	                          Mode mode);
+
+	std::vector<double> _buffer;
+	bool _valid;
+	std::size_t _n_restores;
+	double _take_time;
+	double _restore_time;
+};
+
+#endif
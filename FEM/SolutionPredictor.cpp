@@ -0,0 +1,144 @@
+/**
+ * \copyright
+ * Copyright (c) 2015, OpenGeoSys Community (http://www.opengeosys.org)
+ *            Distributed under a Modified BSD License.
+ *              See accompanying file LICENSE.txt or
+ *              http://www.opengeosys.org/project/license
+ *
+ */
+
+#include "SolutionPredictor.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "rf_bc_new.h"
+#include "rf_pcs.h"
+
+SolutionPredictor::SolutionPredictor(int order)
+    : _order(std::max(0, std::min(order, static_cast<int>(QUADRATIC)))),
+      _n_nodes(0),
+      _initial_time(0.0),
+      _n_predictions(0),
+      _n_kept_nodes(0)
+{
+}
+
+/**************************************************************************
+   FEMLib-Method:
+   Task: Mark the Dirichlet nodes of each primary variable and the nodes
+         connected to them
+**************************************************************************/
+void SolutionPredictor::setFixedNodes(CRFProcess& pcs)
+{
+	const std::size_t n_pv = pcs.GetPrimaryVNumber();
+	_fixed.assign(n_pv, std::vector<bool>(_n_nodes, false));
+	for (std::size_t i = 0; i < pcs.bc_node_value.size(); i++)
+	{
+		const CBoundaryConditionNode* bc_node = pcs.bc_node_value[i];
+		for (std::size_t k = 0; k < n_pv; k++)
+		{
+			if (bc_node->pcs_pv_name != pcs.GetPrimaryVName(k)) continue;
+			const long node = bc_node->msh_node_number;
+			if (node < 0 || static_cast<std::size_t>(node) >= _n_nodes)
+				continue;
+			_fixed[k][node] = true;
+			MeshLib::IndexRange const connected(
+			    pcs.m_msh->nod_vector[node]->getConnectedNodes());
+			for (std::size_t j = 0; j < connected.size(); j++)
+				if (connected[j] < _n_nodes) _fixed[k][connected[j]] = true;
+		}
+	}
+}
+
+void SolutionPredictor::record(CRFProcess& pcs, double t, double tolerance)
+{
+	// A repeated step starts from a solution which is already recorded. Its
+	// start time is computed from the new step size and may differ from the
+	// recorded one by round-off.
+	while (!_times.empty() && !(_times.front() < t - tolerance))
+	{
+		_times.erase(_times.begin());
+		_solutions.erase(_solutions.begin());
+	}
+	// Three solutions are kept for the monotony check also by LINEAR
+	if (_times.size() == 3)
+	{
+		_times.pop_back();
+		_solutions.pop_back();
+	}
+
+	const std::size_t n_pv = pcs.GetPrimaryVNumber();
+	_times.insert(_times.begin(), t);
+	_solutions.insert(_solutions.begin(), std::vector<double>(n_pv * _n_nodes));
+	std::vector<double>& u = _solutions.front();
+	for (std::size_t k = 0; k < n_pv; k++)
+	{
+		const double* old_values = pcs.nod_val_vector[pcs.GetNodeValueIndex(
+		    pcs.GetPrimaryVName(k))];
+		std::copy(old_values, old_values + _n_nodes, u.begin() + k * _n_nodes);
+	}
+}
+
+/**************************************************************************
+   FEMLib-Method:
+   Task: Record the old time level and extrapolate the new one with the
+         Lagrange polynomial through the recorded solutions
+**************************************************************************/
+void SolutionPredictor::predict(CRFProcess& pcs, double t, double t_new)
+{
+	if (_order == PREVIOUS) return;
+	if (_fixed.empty())
+	{
+		_n_nodes = pcs.m_msh->GetNodesNumber(false);
+		setFixedNodes(pcs);
+		_initial_time = t;
+	}
+	// Times closer than this are the same step start
+	const double tolerance = 1.0e-6 * std::fabs(t_new - t);
+	// The initial conditions are in general not consistent with the
+	// boundary conditions, the change of the first step is not extrapolated
+	if (t > _initial_time + tolerance) record(pcs, t, tolerance);
+	if (_times.size() < 2 || !(t_new > t)) return;
+
+	// Lagrange weights of the linear and, if requested, quadratic polynomial
+	double w_lin[2], w_quad[3];
+	w_lin[0] = 1.0 + (t_new - _times[0]) / (_times[0] - _times[1]);
+	w_lin[1] = 1.0 - w_lin[0];
+	const bool quadratic = _order == QUADRATIC && _times.size() == 3;
+	for (int i = 0; quadratic && i < 3; i++)
+	{
+		w_quad[i] = 1.0;
+		for (int j = 0; j < 3; j++)
+			if (j != i)
+				w_quad[i] *= (t_new - _times[j]) / (_times[i] - _times[j]);
+	}
+
+	const std::size_t n_pv = pcs.GetPrimaryVNumber();
+	for (std::size_t k = 0; k < n_pv; k++)
+	{
+		const double* u0 = &_solutions[0][k * _n_nodes];
+		const double* u1 = &_solutions[1][k * _n_nodes];
+		const double* u2 =
+		    (_times.size() == 3) ? &_solutions[2][k * _n_nodes] : NULL;
+		double* new_values = pcs.nod_val_vector[pcs.GetNodeValueIndex(
+		                                            pcs.GetPrimaryVName(k)) +
+		                                        1];
+		const std::vector<bool>& fixed = _fixed[k];
+		for (std::size_t i = 0; i < _n_nodes; i++)
+		{
+			if (fixed[i]) continue;
+			if (u2 && (u0[i] - u1[i]) * (u1[i] - u2[i]) < 0.0)
+			{
+				_n_kept_nodes++;
+				continue;
+			}
+			if (quadratic)
+				new_values[i] =
+				    w_quad[0] * u0[i] + w_quad[1] * u1[i] + w_quad[2] * u2[i];
+			else
+				new_values[i] = w_lin[0] * u0[i] + w_lin[1] * u1[i];
+		}
+	}
+	_n_predictions++;
+}
@@ -0,0 +1,73 @@
+/**
+ * \copyright
+ * Copyright (c) 2015, OpenGeoSys Community (http://www.opengeosys.org)
+ *            Distributed under a Modified BSD License.
+ *              See accompanying file LICENSE.txt or
+ *              http://www.opengeosys.org/project/license
+ *
+ */
+
+#ifndef solution_predictor_INC
+#define solution_predictor_INC
+
+#include <cstddef>
+#include <vector>
+
+class CRFProcess;
+
+/**
+ * Initial guess of the primary variables for the nonlinear solution of a
+ * time step, extrapolated from the solutions at the beginning of the last
+ * accepted steps ($INITIAL_GUESS in the NUM file):
+ * - PREVIOUS: the solution of the last step (no prediction)
+ * - LINEAR: from the last two solutions
+ * - QUADRATIC: from the last three solutions
+ *
+ * The initial conditions are not used. The previous solution is kept at
+ * - Dirichlet nodes of the variable and their neighbours, where the
+ *   extrapolated profile would not match the boundary values,
+ * - nodes whose last two increments have opposite signs, e.g. at a moving
+ *   front or a phase change, where an extrapolation overshoots.
+ */
+class SolutionPredictor
+{
+public:
+	enum Order
+	{
+		PREVIOUS = 0,
+		LINEAR,
+		QUADRATIC
+	};
+
+	explicit SolutionPredictor(int order);
+
+	/// Record the solution at t, the old time level of the primary
+	/// variables, and set their new time level to the prediction at t_new.
+	/// A repeated step (t not newer than the last record) replaces the
+	/// newer records.
+	void predict(CRFProcess& pcs, double t, double t_new);
+
+	// Statistics
+	std::size_t getNumberOfPredictions() const { return _n_predictions; }
+	/// Nodes kept at the previous solution by the non-monotony safeguard
+	std::size_t getNumberOfKeptNodes() const { return _n_kept_nodes; }
+
+private:
+	void record(CRFProcess& pcs, double t, double tolerance);
+	void setFixedNodes(CRFProcess& pcs);
+
+	const int _order;
+	std::size_t _n_nodes;
+	double _initial_time;
+	// Recorded times and solutions, newest first. A solution holds all
+	// primary variables one after another.
+	std::vector<double> _times;
+	std::vector<std::vector<double> > _solutions;
+	// Nodes of each primary variable which are not extrapolated
+	std::vector<std::vector<bool> > _fixed;
+
+	std::size_t _n_predictions;
+	std::size_t _n_kept_nodes;
+};
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * \copyright
+ * Copyright (c) 2015, OpenGeoSys Community (http://www.opengeosys.org)
+ *            Distributed under a Modified BSD License.
+ *              See accompanying file LICENSE.txt or
+ *              http://www.opengeosys.org/project/license
+ *
+ */
+
+#include "TimeSeriesBuffer.h"
+
+#include <cstdio>
+#include <fstream>
+
+#include "display.h"
+
+TimeSeriesBuffer::TimeSeriesBuffer() : _flush_interval(1), _n_records(0)
+{
+	_buffer.setf(std::ios::scientific, std::ios::floatfield);
+	_buffer.precision(12);
+}
+
+TimeSeriesBuffer::~TimeSeriesBuffer()
+{
+	flush();
+}
+
+void TimeSeriesBuffer::open(const std::string& file_name, bool truncate)
+{
+	if (file_name != _file_name) flush();
+	_file_name = file_name;
+	if (truncate)
+	{
+		remove(_file_name.c_str());
+		_buffer.str("");
+		_n_records = 0;
+	}
+}
+
+void TimeSeriesBuffer::endRecord()
+{
+	_n_records++;
+	if (_flush_interval > 0 && _n_records >= _flush_interval) flush();
+}
+
+void TimeSeriesBuffer::flush()
+{
+	const std::string data(_buffer.str());
+	if (data.empty() || _file_name.empty()) return;
+	std::ofstream os(_file_name.c_str(), std::ios::app | std::ios::out);
+	if (!os.good())
+	{
+		ScreenMessage2("Failure to open file: %s\n", _file_name.c_str());
+		return;
+	}
+	os << data;
+	os.close();
+	_buffer.str("");
+	_n_records = 0;
+}
@@ -0,0 +1,55 @@
+/**
+ * \copyright
+ * Copyright (c) 2015, OpenGeoSys Community (http://www.opengeosys.org)
+ *            Distributed under a Modified BSD License.
+ *              See accompanying file LICENSE.txt or
+ *              http://www.opengeosys.org/project/license
+ *
+ */
+
+#ifndef time_series_buffer_INC
+#define time_series_buffer_INC
+
+#include <cstddef>
+#include <sstream>
+#include <string>
+
+/**
+ * Text file of a time series (e.g. the values at an observation point) which
+ * is written in records, one per output time. The records are kept in memory
+ * and appended to the file after every flush_interval records, by flush()
+ * (checkpoints) and on destruction. A flush interval of 0 means that the
+ * file is only written by flush() and on destruction.
+ */
+class TimeSeriesBuffer
+{
+public:
+	TimeSeriesBuffer();
+	~TimeSeriesBuffer();
+
+	/// Set the file. With truncate, an existing file is removed.
+	void open(const std::string& file_name, bool truncate);
+	bool isOpen() const { return !_file_name.empty(); }
+
+	void setFlushInterval(std::size_t n_records) { _flush_interval = n_records; }
+	std::size_t getFlushInterval() const { return _flush_interval; }
+
+	/// Stream of the current record
+	std::ostream& record() { return _buffer; }
+	/// Complete the current record
+	void endRecord();
+
+	/// Append the buffered records to the file
+	void flush();
+
+private:
+	TimeSeriesBuffer(const TimeSeriesBuffer&);
+	TimeSeriesBuffer& operator=(const TimeSeriesBuffer&);
+
+	std::string _file_name;
+	std::ostringstream _buffer;
+	std::size_t _flush_interval;
+	std::size_t _n_records;
+};
+
+#endif
@@ -2932,10 +2932,10 @@ void CFiniteElementStd::Cal_Velocity()
 		for (int i = 0; i < nnodes; i++)
 			NodalVal1[i] = pcs->GetNodeValue(nodes[i], idx_pn);
 	}
-	Matrix tmp_gp_velocity(gp_ele->Velocity);
-	tmp_gp_velocity = 0.0;
-	// gp_ele->Velocity = 0.0;                     // CB inserted here and
-	// commented above due to conflict with transport calculation, needs
+	// Velocities are written in place. No other element reads them during
+	// this loop, so a temporary copy is not needed.
+	GaussPointMatrix& gp_velocity(gp_ele->Velocity);
+	gp_velocity = 0.0;
 	for (gp = 0; gp < nGaussPoints; gp++)
 	{
 		//---------------------------------------------------------
@@ -3040,7 +3040,7 @@ void CFiniteElementStd::Cal_Velocity()
 			for (size_t i = 0; i < dim; i++)  // 02.2010. WW
 			{
 				for (size_t j = 0; j < dim; j++)
-					tmp_gp_velocity(i, gp) +=
+					gp_velocity(i, gp) +=
 					    mat[dim * i + j] * vel[j] / time_unit_factor;
 				// gp_ele->Velocity(i, gp) +=
 				// mat[dim*i+j]*vel[j]/time_unit_factor;
@@ -3063,7 +3063,7 @@ void CFiniteElementStd::Cal_Velocity()
 					//              mat[dim*i+j]*vel[j];  // unit as that given
 					//              in input file
 					// SI Unit
-					tmp_gp_velocity(i, gp) -=
+					gp_velocity(i, gp) -=
 					    mat[dim * i + j] * vel[j] / time_unit_factor;
 				// gp_ele->Velocity(i, gp) -=
 				// mat[dim*i+j]*vel[j]/time_unit_factor;
@@ -3080,7 +3080,6 @@ void CFiniteElementStd::Cal_Velocity()
 		}
 		//
 	}
-	gp_ele->Velocity = tmp_gp_velocity;
 //
 #if 0
 	if(pcs->Write_Matrix)
@@ -3941,24 +3940,32 @@ void CFiniteElementStd::CalcFEM_FCT()
 	Math_Group::Vector* ML = this->pcs->Gl_ML;
 	for (int i = 0; i < nnodes; i++)
 	{
-#ifdef USE_PETSC
 		long node_i_id = MeshElement->GetNode(i)->GetEquationIndex();
-#else
-		long node_i_id = this->MeshElement->GetNodeIndex(i);
-#endif
 		(*ML)(node_i_id) += (*FCT_MassL)(i);
 	}
 	//----------------------------------------------------------------------
 	// Initialize FCT flux with consistent mass matrix: f_ij = m_ij
 	//----------------------------------------------------------------------
+#ifdef USE_PETSC
 	Math_Group::SparseMatrixDOK* FCT_Flux = this->pcs->FCT_AFlux;
+#else
+	Math_Group::CSparseMatrix* FCT_Flux = this->pcs->FCT_AFlux;
+#endif
 	for (int i = 0; i < nnodes; i++)
 	{
+#ifdef USE_PETSC
 		long node_i_id = this->MeshElement->GetNodeIndex(i);
+#else
+		long node_i_id = MeshElement->GetNode(i)->GetEquationIndex();
+#endif
 		//    for (j=i; j<nnodes; j++) {
 		for (int j = i + 1; j < nnodes; j++)  // symmetric
 		{
+#ifdef USE_PETSC
 			long node_j_id = this->MeshElement->GetNodeIndex(j);
+#else
+			long node_j_id = MeshElement->GetNode(j)->GetEquationIndex();
+#endif
 			double v = (*this->Mass)(i, j);
 #ifdef USE_PETSC
 			if (v == .0) v = (*this->Mass)(j, i);  // look for inner nodes
@@ -4931,11 +4938,7 @@ void CFiniteElementStd::Assembly(bool updateA, bool updateRHS,
 			add2GlobalMatrixII();
 			break;
 		case TH:
-			//AssembleTHEquation(updateA, updateRHS);
-			if (updateA)
-				AssembleTHJacobian();
-			if (updateRHS)
-				AssembleTHResidual();
+			AssembleTHEquation(updateA, updateRHS);
 #ifdef USE_PETSC
 			add2GlobalMatrixII(updateA, updateRHS);
 #else
@@ -5262,6 +5265,10 @@ void CFiniteElementStd::CalcSatution()
 	//
 	gp_r = gp_s = gp_t = gp = 0;
 	//
+	// Pressure at the Gauss points, saturation in one batch
+	double gp_pressure[64], gp_saturation[64];
+	int gp_node[64];
+	int n_gp = 0;
 	for (gp = 0; gp < nGaussPoints; gp++)
 	{
 		SetGaussPoint(gp, gp_r, gp_s, gp_t);
@@ -5276,12 +5283,16 @@ void CFiniteElementStd::CalcSatution()
 		//
 		if (i > nnodes) continue;
 		ComputeShapefct(1);
-		//
-		// CB_merge_0513 in case of het K, store local K
-		MediaProp->local_permeability = tens[0];
-		PG = interpolate(NodalVal0);
-		NodalVal_Sat[i] = MediaProp->SaturationCapillaryPressureFunction(PG);
-	}
+		gp_node[n_gp] = i;
+		gp_pressure[n_gp++] = interpolate(NodalVal0);
+	}
+	// CB_merge_0513 in case of het K, store local K
+	MediaProp->local_permeability = tens[0];
+	MediaProp->SaturationCapillaryPressureFunction(n_gp, gp_pressure,
+	                                               gp_saturation);
+	for (int k = 0; k < n_gp; k++)
+		NodalVal_Sat[gp_node[k]] = gp_saturation[k];
+	if (n_gp > 0) PG = gp_pressure[n_gp - 1];
 
 	if (ElementType == MshElemType::QUAD ||
 	    ElementType == MshElemType::HEXAHEDRON)
@@ -324,8 +324,9 @@ private:
 	void AssembleRHSVector();        // OK
 	void AssembleCapillaryEffect();  // PCH
 	                                 // PCH for debugging
-	void AssembleTHResidual();
-	void AssembleTHJacobian();
+	void AssembleTHEquation(bool updateA, bool updateRHS);
+	template <int NNodes, int Dim>
+	void AssembleTHEquationKernel(bool updateA, bool updateRHS);
 
 #if defined(USE_PETSC)  // || defined(other parallel libs)//03~04.3012. WW
 	void add2GlobalMatrixII(bool updateA = true, bool updateRHS = true);
@@ -78,15 +78,6 @@ CFiniteElementVec::CFiniteElementVec(process::CRFProcessDeformation* dm_pcs,
 	Idx_Stress[2] = pcs->GetNodeValueIndex("STRESS_ZZ");
 	Idx_Stress[3] = pcs->GetNodeValueIndex("STRESS_XY");
 
-	// For cache
-	vec_B_matrix.resize(20);
-	vec_B_matrix_T.resize(20);
-	for (int i = 0; i < (int)vec_B_matrix.size(); i++)
-	{
-		vec_B_matrix[i] = new Matrix(ns, dim);
-		vec_B_matrix_T[i] = new Matrix(dim, ns);
-	}
-
 	//
 	switch (dim)
 	{
@@ -130,8 +121,6 @@ CFiniteElementVec::CFiniteElementVec(process::CRFProcessDeformation* dm_pcs,
 	B_matrix_T = new Matrix(dim, ns);
 	De = new Matrix(ns, ns);
 	ConsistDep = new Matrix(ns, ns);
-	AuxMatrix = new Matrix(dim, dim);
-	AuxMatrix2 = new Matrix(dim, ns);
 
 	*B_matrix = 0.0;
 	*B_matrix_T = 0.0;
@@ -213,8 +202,6 @@ CFiniteElementVec::~CFiniteElementVec()
 	delete B_matrix_T;
 	delete De;
 	delete ConsistDep;
-	delete AuxMatrix;
-	delete AuxMatrix2;
 	delete[] Disp;
 	delete[] dT;
 	delete[] T1;
@@ -235,12 +222,6 @@ CFiniteElementVec::~CFiniteElementVec()
 	}
 
 	delete PressureC;
-
-	for (int i = 0; i < (int)vec_B_matrix.size(); i++)
-	{
-		delete vec_B_matrix[i];
-		delete vec_B_matrix_T[i];
-	}
 }
 
 /***************************************************************************
@@ -335,106 +316,19 @@ double CFiniteElementVec::CalDensity()
  **************************************************************************/
 void CFiniteElementVec::ComputeMatrix_RHS(const double fkt, const Matrix* p_D)
 {
-	int i, j, k, l;
-	double rho, fac, fac1, fac2, dN_dx, f_buff;
-	fac = fac1 = fac2 = f_buff = 0.0;
-	dN_dx = 0.0;
-	rho = CalDensity();
+	int i, k;
+	const double rho = CalDensity();
 	const int nnodesHQ = this->nnodesHQ;
-	const int nnodes = this->nnodes;
 	const int ele_dim = this->ele_dim;
-	const int ns = this->ns;
-
-	// NW cache B, B^T
-	for (i = 0; i < nnodesHQ; i++)
-	{
-		setTransB_Matrix(i);
-		(*this->vec_B_matrix[i]) = *B_matrix;
-		(*this->vec_B_matrix_T[i]) = *B_matrix_T;
-	}
-	Matrix* old_B_matrix = B_matrix;
-	Matrix* old_B_matrix_T = B_matrix_T;
-
-	Matrix* tmp_B_matrix = NULL;
-	Matrix* tmp_B_matrix_T = NULL;
-	Matrix* tmp_AuxMatrix = AuxMatrix;
-	Matrix* tmp_AuxMatrix2 = AuxMatrix2;
-	Matrix* tmp_Stiffness = Stiffness;
-
-	for (i = 0; i < nnodesHQ; i++)
-	{
-		tmp_B_matrix_T = this->vec_B_matrix_T[i];
-
-		// Local assembly of A*u=int(B^t*sigma) for Newton-Raphson method
-		for (j = 0; j < ele_dim; j++) {
-			for (k = 0; k < ns; k++) {
-				(*RHS)(j* nnodesHQ + i) += (*tmp_B_matrix_T)(j, k) * (dstress[k] - stress0[k]) * fkt;
-			}
-		}
-
-		(*tmp_AuxMatrix2) = 0.0;
-		tmp_B_matrix_T->multi(*p_D, *tmp_AuxMatrix2);
-		for (j = 0; j < nnodesHQ; j++)
-		{
-			tmp_B_matrix = this->vec_B_matrix[j];
-			// Compute stiffness matrix
-			(*tmp_AuxMatrix) = 0.0;
-			tmp_AuxMatrix2->multi(*tmp_B_matrix, *tmp_AuxMatrix);
-
-			// Local assembly of stiffness matrix
-			for (k = 0; k < ele_dim; k++) {
-				for (l = 0; l < ele_dim; l++) {
-					(*tmp_Stiffness)(i + k * nnodesHQ, j + l * nnodesHQ) += (*tmp_AuxMatrix)(k, l) * fkt;
-				}
-			}
-		}  // loop j
-	}      // loop i
-
-	// should restore pointer NW
-	B_matrix = old_B_matrix;
-	B_matrix_T = old_B_matrix_T;
 
 	//---------------------------------------------------------
-	// Assemble coupling matrix
+	// Stiffness, RHS = B^T*(dstress-stress0) and coupling matrix
 	//---------------------------------------------------------
 	// LoadFactor: factor of incremental loading, prescibed in rf_pcs.cpp
-
-	if (PressureC)
-	{
-		fac = fkt;
-
-		if (axisymmetry)
-		{
-			for (k = 0; k < nnodesHQ; k++)
-			{
-				for (l = 0; l < nnodes; l++)
-				{
-					for (j = 0; j < ele_dim; j++)
-					{
-						dN_dx = dshapefctHQ[nnodesHQ * j + k];
-						if (j == 0) dN_dx += shapefctHQ[k] / Radius;
-
-						f_buff = fac * dN_dx * shapefct[l];
-						(*PressureC)(nnodesHQ* j + k, l) += f_buff;
-					}
-				}
-			}
-		}
-		else
-		{
-			for (k = 0; k < nnodesHQ; k++)
-			{
-				for (l = 0; l < nnodes; l++)
-				{
-					for (j = 0; j < ele_dim; j++)
-					{
-						f_buff = fac * dshapefctHQ[nnodesHQ * j + k] * shapefct[l];
-						(*PressureC)(nnodesHQ* j + k, l) += f_buff;
-					}
-				}
-			}
-		}
-	}
+	double diff_stress[6];
+	for (k = 0; k < ns; k++)
+		diff_stress[k] = dstress[k] - stress0[k];
+	assembleBTerms(fkt, p_D, diff_stress, PressureC);
 
 	//---------------------------------------------------------
 	// Assemble gravity force vector
@@ -604,34 +498,15 @@ void CFiniteElementVec::AssembleResidual()
 				stress0[i] = (*eleV_DM->Stress0)(i, gp);
 		}
 
-		//---------------------------------------------------------
-		// cache B
-		//---------------------------------------------------------
-		for (int i = 0; i < nnodesHQ; i++)
-		{
-			setTransB_Matrix(i);
-			(*this->vec_B_matrix[i]) = *B_matrix;
-			(*this->vec_B_matrix_T[i]) = *B_matrix_T;
-		}
-		Matrix* old_B_matrix = B_matrix;
-		Matrix* old_B_matrix_T = B_matrix_T;
-
 		//---------------------------------------------------------
 		// r = B^T * (Stress - Stress0) + (b-b0) + (t-t0)
 		//   = B^T * (Stress' - alpa*p - Stress0) + (b-b0) + (t-t0)
 		//---------------------------------------------------------
-		// r = B^T * (Stress' - Stress'0)
-		for (int i = 0; i < nnodesHQ; i++)
-		{
-			Matrix* tmp_B_matrix_T = this->vec_B_matrix_T[i];
-
-			for (unsigned j = 0; j < ele_dim; j++) {
-				for (int k = 0; k < ns; k++) {
-					double diff_stress = stress1[k] - stress0[k];
-					r(j* nnodesHQ + i) += (*tmp_B_matrix_T)(j, k) * diff_stress * fkt;
-				}
-			}
-		}
+		// r = B^T * (Stress' - Stress'0), PC = B^T * Np
+		double diff_stress[6];
+		for (int k = 0; k < ns; k++)
+			diff_stress[k] = stress1[k] - stress0[k];
+		assembleBTerms(fkt, NULL, diff_stress, H_Process ? PressureC : NULL);
 
 		// r += rho*g
 		double rho = CalDensity();
@@ -644,32 +519,6 @@ void CFiniteElementVec::AssembleResidual()
 			for (int k = 0; k < nnodesHQ; k++)
 				r(i + k) += coeff * shapefctHQ[k];
 		}
-
-		// PC = B^T * Np
-		if (H_Process)
-		{
-			for (int k = 0; k < nnodesHQ; k++)
-			{
-				for (int l = 0; l < nnodes; l++)
-				{
-					for (unsigned j = 0; j < ele_dim; j++)
-					{
-						double dN_dx = dshapefctHQ[nnodesHQ * j + k];
-						if (axisymmetry && j == 0)
-							dN_dx += shapefctHQ[k] / Radius;
-						double f_buff = fkt * dN_dx * shapefct[l];
-						(*PressureC)(nnodesHQ* j + k, l) += f_buff;
-					}
-				}
-			}
-
-		}
-
-		//---------------------------------------------------------
-		// restore B
-		//---------------------------------------------------------
-		B_matrix = old_B_matrix;
-		B_matrix_T = old_B_matrix_T;
 	}
 
 	// r+= B^T * (-alpha*p - (-alpha0*p0))
@@ -771,71 +620,16 @@ void CFiniteElementVec::AssembleJacobian()
 		//---------------------------------------------------------
 		Matrix* p_D = De;
 
-		//---------------------------------------------------------
-		// cache B
-		//---------------------------------------------------------
-		for (int i = 0; i < nnodesHQ; i++)
-		{
-			setTransB_Matrix(i);
-			(*this->vec_B_matrix[i]) = *B_matrix;
-			(*this->vec_B_matrix_T[i]) = *B_matrix_T;
-		}
-		Matrix* old_B_matrix = B_matrix;
-		Matrix* old_B_matrix_T = B_matrix_T;
-
 		//---------------------------------------------------------
 		// J = B^T * (D * B - alpha*p)
 		//   = A + PC
 		//---------------------------------------------------------
-		// A = B^T * D * B
-		Matrix* tmp_AuxMatrix = AuxMatrix;
-		Matrix* tmp_AuxMatrix2 = AuxMatrix2;
-		for (int i = 0; i < nnodesHQ; i++)
-		{
-			Matrix* tmp_B_matrix_T = this->vec_B_matrix_T[i];
-
-			(*tmp_AuxMatrix2) = 0.0;
-			tmp_B_matrix_T->multi(*p_D, *tmp_AuxMatrix2);
-			for (int j = 0; j < nnodesHQ; j++)
-			{
-				Matrix* tmp_B_matrix = this->vec_B_matrix[j];
-				// Compute stiffness matrix
-				(*tmp_AuxMatrix) = 0.0;
-				tmp_AuxMatrix2->multi(*tmp_B_matrix, *tmp_AuxMatrix);
-
-				// Local assembly of stiffness matrix
-				for (unsigned k = 0; k < ele_dim; k++) {
-					for (unsigned l = 0; l < ele_dim; l++) {
-						(*Stiffness)(i + k * nnodesHQ, j + l * nnodesHQ) += (*tmp_AuxMatrix)(k, l) * fkt;
-					}
-				}
-			}  // loop j
-		}      // loop i
-
-		// PC = B^T * (-alpha*p)
-		if (pcs->getProcessType() == FiniteElement::DEFORMATION_FLOW)
-		{
-			for (int k = 0; k < nnodesHQ; k++)
-			{
-				for (int l = 0; l < nnodes; l++)
-				{
-					for (unsigned j = 0; j < ele_dim; j++)
-					{
-						double dN_dx = dshapefctHQ[nnodesHQ * j + k];
-						if (axisymmetry && j == 0)
-							dN_dx += shapefctHQ[k] / Radius;
-						double f_buff = fkt * dN_dx * shapefct[l];
-						(*PressureC)(nnodesHQ* j + k, l) += f_buff;
-					}
-				}
-			}
-		}
-
-		//---------------------------------------------------------
-		// restore B
-		//---------------------------------------------------------
-		B_matrix = old_B_matrix;
-		B_matrix_T = old_B_matrix_T;
+		// A = B^T * D * B, PC = B^T * (-alpha*p)
+		assembleBTerms(
+		    fkt, p_D, NULL,
+		    (pcs->getProcessType() == FiniteElement::DEFORMATION_FLOW)
+		        ? PressureC
+		        : NULL);
 	}
 
 
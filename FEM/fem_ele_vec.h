@@ -74,6 +74,9 @@ private:
 	void setB_Matrix(const int LocalIndex);
 	// Form the tanspose of B matric
 	void setTransB_Matrix(const int LocalIndex);
+	// Stiffness, B^T*stress and pressure coupling terms of a Gauss point
+	void assembleBTerms(const double fkt, const Matrix* D,
+	                    const double* stress, Matrix* coupling);
 	//
 	void ComputeMatrix_RHS(const double fkt, const Matrix* p_D);
 	/// Extropolation
@@ -118,8 +121,6 @@ private:
 	// B matrix
 	Matrix* B_matrix = nullptr;
 	Matrix* B_matrix_T = nullptr;
-	std::vector<Matrix*> vec_B_matrix;
-	std::vector<Matrix*> vec_B_matrix_T;
 
 	//------ Material -------
 	CSolidProperties* m_msp = nullptr;
@@ -133,8 +134,6 @@ private:
 	Matrix* ConsistDep = nullptr;
 
 	// Local matricies and vectors
-	Matrix* AuxMatrix = nullptr;
-	Matrix* AuxMatrix2 = nullptr;
 	Matrix* Stiffness = nullptr;
 	Matrix* PressureC = nullptr;
 	Vector* RHS = nullptr;
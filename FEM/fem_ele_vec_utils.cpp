@@ -119,6 +119,144 @@ void CFiniteElementVec::setTransB_Matrix(const int LocalIndex)
 	B_matrix->GetTranspose(*B_matrix_T);
 }
 
+namespace
+{
+// Non-zero entries of one column of the nodal B matrix: the strain component
+// (row) and the gradient slot it is taken from, 0: dN/dx, 1: dN/dy, 2: dN/dz,
+// 3: N/r (axisymmetry). Must match setB_Matrix.
+struct BEntry
+{
+	int row;
+	int grad;
+};
+struct BColumn
+{
+	int n;
+	BEntry e[3];
+};
+
+const BColumn B_columns_plane[2] = {{2, {{0, 0}, {3, 1}}},
+                                    {2, {{1, 1}, {3, 0}}}};
+const BColumn B_columns_axisym[2] = {{3, {{0, 0}, {1, 3}, {3, 1}}},
+                                     {2, {{2, 1}, {3, 0}}}};
+const BColumn B_columns_3D[3] = {{3, {{0, 0}, {3, 1}, {4, 2}}},
+                                 {3, {{1, 1}, {3, 0}, {5, 2}}},
+                                 {3, {{2, 2}, {4, 0}, {5, 1}}}};
+}
+
+/***************************************************************************
+   GeoSys - Funktion:
+           CFiniteElementVec::assembleBTerms()
+
+   Aufgabe:
+          Add the B matrix terms of the current Gauss point in one node loop:
+            Stiffness += fkt * B^T * D * B     if D is given
+            RHS       += fkt * B^T * stress    if stress is given
+            coupling  += fkt * B^T * m * N_p   if coupling is given
+          Only the non-zero entries of the nodal B matrices are visited and
+          the 3x3 (2x2) node blocks are formed directly. For a symmetric D
+          only the upper node blocks are computed and mirrored.
+ **************************************************************************/
+void CFiniteElementVec::assembleBTerms(const double fkt, const Matrix* D,
+                                       const double* stress, Matrix* coupling)
+{
+	const int n = nnodesHQ;
+	const int nd = ele_dim;
+	const BColumn* cols = (nd == 3)
+	                          ? B_columns_3D
+	                          : (axisymmetry ? B_columns_axisym : B_columns_plane);
+
+	double grad[20][4];
+	for (int i = 0; i < n; i++)
+	{
+		grad[i][0] = dshapefctHQ[i];
+		grad[i][1] = dshapefctHQ[n + i];
+		grad[i][2] = (nd == 3) ? dshapefctHQ[2 * n + i] : 0.0;
+		grad[i][3] = axisymmetry ? shapefctHQ[i] / Radius : 0.0;
+	}
+
+	// RHS = B^T * stress, PC = B^T * m * N_p
+	if (stress || coupling)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			for (int k = 0; k < nd; k++)
+			{
+				const BColumn& c = cols[k];
+				double b_sigma = 0.0;
+				double b_m = 0.0;
+				for (int e = 0; e < c.n; e++)
+				{
+					const double b = grad[i][c.e[e].grad];
+					if (stress)
+						b_sigma += b * stress[c.e[e].row];
+					if (c.e[e].row < 3)
+						b_m += b;
+				}
+				if (stress)
+					(*RHS)(k * n + i) += b_sigma * fkt;
+				if (coupling)
+				{
+					b_m *= fkt;
+					for (int l = 0; l < nnodes; l++)
+						(*coupling)(n * k + i, l) += b_m * shapefct[l];
+				}
+			}
+		}
+	}
+
+	if (!D)
+		return;
+
+	// D * B_j for every node, column by column
+	double DB[20][3][6];
+	for (int j = 0; j < n; j++)
+	{
+		for (int l = 0; l < nd; l++)
+		{
+			const BColumn& c = cols[l];
+			for (int r = 0; r < ns; r++)
+			{
+				double val = 0.0;
+				for (int e = 0; e < c.n; e++)
+					val += (*D)(r, c.e[e].row) * grad[j][c.e[e].grad];
+				DB[j][l][r] = val;
+			}
+		}
+	}
+
+	bool symmetric = true;
+	for (int r = 0; r < ns && symmetric; r++)
+		for (int s = r + 1; s < ns; s++)
+			if ((*D)(r, s) != (*D)(s, r))
+			{
+				symmetric = false;
+				break;
+			}
+
+	// K_ij = B_i^T * (D * B_j)
+	for (int i = 0; i < n; i++)
+	{
+		for (int j = symmetric ? i : 0; j < n; j++)
+		{
+			for (int k = 0; k < nd; k++)
+			{
+				const BColumn& c = cols[k];
+				for (int l = 0; l < nd; l++)
+				{
+					double val = 0.0;
+					for (int e = 0; e < c.n; e++)
+						val += grad[i][c.e[e].grad] * DB[j][l][c.e[e].row];
+					val *= fkt;
+					(*Stiffness)(i + k * n, j + l * n) += val;
+					if (symmetric && j != i)
+						(*Stiffness)(j + l * n, i + k * n) += val;
+				}
+			}
+		}
+	}
+}
+
 /***************************************************************************
    GeoSys - Funktion:
            CFiniteElementVec::ComputeStrain()
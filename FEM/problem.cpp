@@ -34,6 +34,9 @@
 #include "fem_ele_std.h"
 #include "files0.h"
 #include "Output.h"
+#include "ProcessScheduler.h"
+#include "ProcessSnapshot.h"
+#include "SolutionPredictor.h"
 #include "rfmat_cp.h"
 #include "rf_bc_new.h"
 #include "rf_fluid_momentum.h"
@@ -277,6 +280,8 @@ Problem::Problem(char* filename)
 	// Controls for coupling. WW
 	cpl_overall_max_iterations = 1;
 	cpl_overall_min_iterations = 1;  // JT2012
+	parallel_processes = 1;
+	transport_scheduler = NULL;
 	//========================================================================
 	// WW
 	char line[MAX_ZEILE];
@@ -289,20 +294,33 @@ Problem::Problem(char* filename)
 	if (num_file.good())
 	{
 		num_file.seekg(0L, std::ios::beg);
+		// The first occurrence of each keyword applies
+		bool found_coupling = false, found_parallel = false;
 		while (!num_file.eof())
 		{
 			num_file.getline(line, MAX_ZEILE);
 			line_string = line;
 			if (line_string.find("#STOP") != std::string::npos) break;
-			if (line_string.find("$OVERALL_COUPLING") != std::string::npos)
+			if (!found_coupling &&
+			    line_string.find("$OVERALL_COUPLING") != std::string::npos)
 			{
+				found_coupling = true;
 				in_num.str(GetLineFromFile1(&num_file));
 				// JT// in_num >> max_coupling_iterations >> coupling_tolerance;
 				// JT: coupling_tolerance is process dependent, cannot be here.
 				// See m_num->cpl_tolerance (with $COUPLING_CONTROL)
 				in_num >> cpl_overall_min_iterations >>
 				    cpl_overall_max_iterations;
-				break;
+				in_num.clear();
+			}
+			// Independent processes running at once
+			if (!found_parallel &&
+			    line_string.find("$PARALLEL_PROCESSES") != std::string::npos)
+			{
+				found_parallel = true;
+				in_num.str(GetLineFromFile1(&num_file));
+				in_num >> parallel_processes;
+				in_num.clear();
 			}
 		}
 		num_file.close();
@@ -390,6 +408,7 @@ Problem::~Problem()
 	active_processes = NULL;
 	exe_flag = NULL;
 	//
+	delete transport_scheduler;
 	PCSDestroyAllProcesses();
 	for (size_t i = 0; i < out_vector.size(); i++)
 		delete out_vector[i];
@@ -688,6 +707,9 @@ void Problem::PCSCreate()
 	for (size_t i = 0; i < no_processes; i++)
 		MMP2PCSRelation(pcs_vector[i]);
 
+	for (size_t i = 0; i < mmp_vector.size(); i++)
+		mmp_vector[i]->CreateCurveSurrogates();
+
 	for (size_t i = 0; i < no_processes; i++)
 		pcs_vector[i]->ConfigureCouplingForLocalAssemblier();
 
@@ -920,6 +942,9 @@ bool Problem::Euler_TimeDiscretize()
 			// ---------------------------------
 			last_dt_accepted = true;
 			ScreenMessage("This step is accepted.\n");
+			for (i = 0; i < (int)pcs_vector.size(); i++)
+				if (pcs_vector[i]->step_snapshot)
+					pcs_vector[i]->step_snapshot->invalidate();
 			PostCouplingLoop();
 #ifndef WIN32
 			ScreenMessage("\tcurrent mem: %d MB\n",
@@ -987,17 +1012,10 @@ bool Problem::Euler_TimeDiscretize()
 				m_tim->last_rejected_timestep = aktueller_zeitschritt + 1;
 				m_tim->step_current--;
 				m_tim->repeat = true;
-				//
-				// Copy nodal values in reverse
-				if (isDeformationProcess(
-				        total_processes[active_process_index[i]]
-				            ->getProcessType()))
-					continue;
-				total_processes[active_process_index[i]]->CopyTimestepNODValues(
-				    false);
-				// JT: This wasn't done before. Is it needed? //
-				// total_processes[active_process_index[i]]->CopyTimestepELEValues(false);
 			}
+			// Node, element and Gauss point values at the beginning of the
+			// step
+			RestoreStepSnapshots();
 			for (i = 0; i < (int)total_processes.size(); i++)
 			{
 				if (!active_processes[i] && total_processes[i] &&
@@ -1041,6 +1059,28 @@ bool Problem::Euler_TimeDiscretize()
 				std::cout << "Rejected time steps:                "
 				          << m_tim->rejected_step_count << "\n";
 			}
+			const ProcessSnapshot* snapshot =
+			    total_processes[active_process_index[i]]->step_snapshot;
+			if (snapshot && snapshot->getNumberOfRestores() > 0)
+			{
+				std::cout << "Restored step states:               "
+				          << snapshot->getNumberOfRestores() << " ("
+				          << snapshot->getBytes() / (1024 * 1024)
+				          << " MB each, CPU time " << snapshot->getTakeTime()
+				          << " s to store, " << snapshot->getRestoreTime()
+				          << " s to restore)"
+				          << "\n";
+			}
+			const SolutionPredictor* predictor =
+			    total_processes[active_process_index[i]]->solution_predictor;
+			if (predictor && predictor->getNumberOfPredictions() > 0)
+			{
+				std::cout << "Predicted initial guesses:          "
+				          << predictor->getNumberOfPredictions() << " ("
+				          << predictor->getNumberOfKeptNodes()
+				          << " non-monotonic nodes kept)"
+				          << "\n";
+			}
 			if (total_processes[active_process_index[i]]
 			        ->m_num->nls_max_iterations > 1)
 			{
@@ -1330,10 +1370,8 @@ bool Problem::CouplingLoop()
 -------------------------------------------------------------------------*/
 void Problem::PreCouplingLoop(CRFProcess* m_pcs)
 {
-	if (!last_dt_accepted || force_post_node_copy)  // if last time step not
-		                                            // accepted or values were
-		                                            // already copied.
-		return;
+	// Not if last time step not accepted or values were already copied.
+	const bool copy_values = last_dt_accepted && !force_post_node_copy;
 	//
 	/*For mass transport this routine is only called once (for the overall
 	  transport process)
@@ -1346,18 +1384,73 @@ void Problem::PreCouplingLoop(CRFProcess* m_pcs)
 			c_pcs = pcs_vector[i];
 			if (c_pcs->getProcessType() == FiniteElement::MASS_TRANSPORT)
 			{
-				c_pcs->CopyTimestepNODValues();
-				c_pcs->CopyTimestepELEValues();
+				if (copy_values)
+				{
+					c_pcs->CopyTimestepNODValues();
+					c_pcs->CopyTimestepELEValues();
+				}
+				TakeStepSnapshot(c_pcs);
+				PredictInitialGuess(c_pcs);
 			}
 		}
 	}
 	else
 	{  // Otherwise, just copy this process
-		m_pcs->CopyTimestepNODValues();
-		m_pcs->CopyTimestepELEValues();
+		if (copy_values)
+		{
+			m_pcs->CopyTimestepNODValues();
+			m_pcs->CopyTimestepELEValues();
+		}
+		TakeStepSnapshot(m_pcs);
+		PredictInitialGuess(m_pcs);
 	}
 }
 
+/*-----------------------------------------------------------------------
+   GeoSys - Function: TakeStepSnapshot
+   Task: Record the state of a process at the beginning of the time step,
+         once per step. A rejected step restores it (RestoreStepSnapshots).
+-------------------------------------------------------------------------*/
+void Problem::TakeStepSnapshot(CRFProcess* m_pcs)
+{
+	if (!m_pcs->step_snapshot) m_pcs->step_snapshot = new ProcessSnapshot();
+	if (!m_pcs->step_snapshot->isValid()) m_pcs->step_snapshot->take(*m_pcs);
+}
+
+/*-----------------------------------------------------------------------
+   GeoSys - Function: RestoreStepSnapshots
+   Task: Reset all processes which ran in a rejected time step to the state
+         at its beginning
+-------------------------------------------------------------------------*/
+void Problem::RestoreStepSnapshots()
+{
+	for (size_t i = 0; i < pcs_vector.size(); i++)
+		if (pcs_vector[i]->step_snapshot)
+			pcs_vector[i]->step_snapshot->restore(*pcs_vector[i]);
+}
+
+/*-----------------------------------------------------------------------
+   GeoSys - Function: PredictInitialGuess
+   Task: Set the initial guess of the nonlinear solution of the time step
+         ($INITIAL_GUESS). Called after the snapshot, so that a repeated
+         step is predicted again from the same solution with its new
+         step size. Not for deformation processes, whose new time level is
+         the reference of the displacement increments.
+-------------------------------------------------------------------------*/
+void Problem::PredictInitialGuess(CRFProcess* m_pcs)
+{
+	if (m_pcs->m_num->nls_initial_guess == SolutionPredictor::PREVIOUS ||
+	    !m_pcs->Tim || m_pcs->tim_type == FiniteElement::TIM_STEADY ||
+	    isDeformationProcess(m_pcs->getProcessType()))
+		return;
+	if (!m_pcs->solution_predictor)
+		m_pcs->solution_predictor =
+		    new SolutionPredictor(m_pcs->m_num->nls_initial_guess);
+	const double t_new = m_pcs->Tim->last_active_time;
+	m_pcs->solution_predictor->predict(
+	    *m_pcs, t_new - m_pcs->Tim->time_step_length, t_new);
+}
+
 /*-----------------------------------------------------------------------
    GeoSys - Function: post Coupling loop
    Task:
@@ -1397,12 +1490,14 @@ void Problem::PostCouplingLoop()
 	 */
 
 	//  Update the results
+	bool checkpoint = false;
 	for (int i = 0; i < (int)pcs_vector.size(); i++)
 	{
 		m_pcs = pcs_vector[i];
 		if (hasAnyProcessDeactivatedSubdomains)  // NW
 			m_pcs->CheckMarkedElement();
-		m_pcs->WriteSolution();  // WW
+		if (m_pcs->WriteSolution())  // WW
+			checkpoint = true;
 #ifdef GEM_REACT
 		if (i == 0)  // for GEM_REACT we also need information on porosity
 					 // (node porosity internally stored in Gems
@@ -1427,13 +1522,12 @@ void Problem::PostCouplingLoop()
 			// will be copied here.
 			m_pcs->CopyTimestepNODValues();
 			m_pcs->CopyTimestepELEValues();
-			for (size_t ie = 0; ie < ele_gp_value.size(); ie++)
-			{
-				ElementValue* ev = ele_gp_value[ie];
-				ev->Velocity0 = ev->Velocity;
-			}
+			for (size_t ip = 0; ip < ele_gp_value_pool.size(); ip++)
+				ele_gp_value_pool[ip]->copyVelocityToPreviousLevel();
 		}
 	}
+	// Time series written up to the restart files
+	if (checkpoint) OUTFlush();
 	LOPCalcELEResultants();
 }
 
@@ -2166,11 +2260,30 @@ inline double Problem::MassTrasport()
 	//
 	if (!m_pcs->selected) return error;  // 12.12.2008 WW
 
+	// Independent mobile components run concurrently
+	if (parallel_processes > 1)
+	{
+		if (!transport_scheduler)
+		{
+			std::vector<CRFProcess*> mobile_processes;
+			for (size_t i = 0; i < transport_processes.size(); i++)
+				if (CPGetMobil(
+				        transport_processes[i]->GetProcessComponentNumber()) >
+				    0)
+					mobile_processes.push_back(transport_processes[i]);
+			transport_scheduler =
+			    new ProcessScheduler(mobile_processes, parallel_processes);
+		}
+		for (size_t i = 0; i < transport_scheduler->getNumberOfWaves(); i++)
+			error = transport_scheduler->executeWave(i, loop_process_number);
+	}
+
 	for (int i = 0; i < (int)transport_processes.size(); i++)
 	{
 		m_pcs = transport_processes[i];  // 18.08.2008 WW
 		// Component Mobile ?
-		if (CPGetMobil(m_pcs->GetProcessComponentNumber()) > 0)
+		if (!transport_scheduler &&
+		    CPGetMobil(m_pcs->GetProcessComponentNumber()) > 0)
 			error = m_pcs->ExecuteNonLinear(
 			    loop_process_number);  // NW. ExecuteNonLinear() is called to
 		                               // use the adaptive time step scheme
@@ -2476,7 +2589,10 @@ inline double Problem::TH_Monolithic()
 	if (!m_pcs->selected) return error;
 	CRFProcessTH* th_pcs = (CRFProcessTH*)m_pcs;
 	error = th_pcs->Execute(loop_process_number);
-	th_pcs->CalIntegrationPointValue();
+	if (th_pcs->hasConvergedGaussPointVelocity())
+		th_pcs->cal_integration_point_value = true;
+	else
+		th_pcs->CalIntegrationPointValue();
 
 	return error;
 }
@@ -13,6 +13,7 @@
 #include <vector>
 
 class CRFProcess;
+class ProcessScheduler;
 
 #include "GEOObjects.h"
 
@@ -39,6 +40,9 @@ public:
 	bool CouplingLoop();
 	void PostCouplingLoop();
 	void PreCouplingLoop(CRFProcess* m_pcs = NULL);
+	void TakeStepSnapshot(CRFProcess* m_pcs);
+	void RestoreStepSnapshots();
+	void PredictInitialGuess(CRFProcess* m_pcs);
 
 	// Copy u_n for auto time stepping
 	double* GetBufferArray(const bool is_x_k = false)
@@ -80,6 +84,8 @@ private:
 	int cpl_overall_max_iterations;
 	int cpl_overall_min_iterations;
 	int loop_process_number;
+	// Maximum number of independent processes running at once
+	int parallel_processes;
 	size_t max_time_steps;
 	//
 	int lop_coupling_iterations;
@@ -93,6 +99,8 @@ private:
 	std::vector<CRFProcess*> transport_processes;
 	std::vector<CRFProcess*> multiphase_processes;
 	std::vector<CRFProcess*> singlephaseflow_process;
+	// Waves of independent mass transport components
+	ProcessScheduler* transport_scheduler;
 	ProblemMemFn* active_processes;
 	std::vector<int> active_process_index;
 	std::vector<int> coupled_process_index;
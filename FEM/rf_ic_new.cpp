@@ -1045,21 +1045,16 @@ void CInitialCondition::SetDomain(int nidx)
 				ScreenMessage(
 				    "subdomain %d: %s\n", subdom_index[k],
 				    dis_linear_f->getExpression(subdom_index[k]).data());
+				if (nodes_vector.empty()) continue;
+				std::vector<const double*> pnts(nodes_vector.size());
+				std::vector<double> node_values(nodes_vector.size());
 				for (i = 0; i < nodes_vector.size(); i++)
-				{
-					//                MeshLib::CNode *thisNode =
-					//                m_msh->nod_vector[nodes_vector[i]];
-					//                getProcess()->SetNodeValue(nodes_vector[i],nidx,dis_linear_f->getValue(k,
-					//                thisNode->X(),thisNode->Y(),
-					//                thisNode->Z()));
-					double const* const pnt(
-					    m_msh->nod_vector[nodes_vector[i]]->getData());
-					getProcess()->SetNodeValue(
-					    nodes_vector[i],
-					    nidx,
-					    dis_linear_f->getValue(subdom_index[k], pnt[0], pnt[1],
-					                           pnt[2]));
-				}
+					pnts[i] = m_msh->nod_vector[nodes_vector[i]]->getData();
+				dis_linear_f->getValues(subdom_index[k], pnts.size(), &pnts[0],
+				                        &node_values[0]);
+				for (i = 0; i < nodes_vector.size(); i++)
+					getProcess()->SetNodeValue(nodes_vector[i], nidx,
+					                           node_values[i]);
 			}
 			else
 				for (i = 0; i < nodes_vector.size(); i++)
@@ -9,7 +9,9 @@
 
 #include "rf_mfp_new.h"
 
+#include <algorithm>
 #include <cfloat>
+#include <cmath>
 
 #include "display.h"
 #include "FileToolsRF.h"
@@ -2249,6 +2251,139 @@ double CFluidProperties::HeatConductivity(double* variables)
 	return heat_conductivity;
 }
 
+/**************************************************************************
+   FEMLib-Method:
+   Task: Fluid properties of n states at once, e.g. all Gauss points of an
+         element. The model switch is taken once, so that the loops of the
+         simple models (constant, linear, perfect gas, exponential) can be
+         vectorised. The other models call the single state functions.
+**************************************************************************/
+void CFluidProperties::Density(std::size_t n, const double* p,
+                               const double* T, const double* C,
+                               double* values)
+{
+	switch (density_model)
+	{
+		case 1:  // rho = const
+			std::fill(values, values + n, rho_0);
+			break;
+		case 2:  // rho(p) = rho_0*(1+beta_p*(p-p_0))
+			for (std::size_t i = 0; i < n; i++)
+				values[i] = rho_0 * (1. + drho_dp * (max(p[i], 0.0) - p_0));
+			break;
+		case 3:  // rho(C) = rho_0*(1+beta_C*(C-C_0))
+			for (std::size_t i = 0; i < n; i++)
+				values[i] =
+				    rho_0 * (1. + drho_dC * (max(C ? C[i] : 0.0, 0.0) - C_0));
+			break;
+		case 4:  // rho(T) = rho_0*(1+beta_T*(T-T_0))
+			for (std::size_t i = 0; i < n; i++)
+				values[i] = rho_0 * (1. + drho_dT * (max(T[i], 0.0) - T_0));
+			break;
+		case 5:  // rho(C,T) = rho_0*(1+beta_C*(C-C_0)+beta_T*(T-T_0))
+			for (std::size_t i = 0; i < n; i++)
+				values[i] =
+				    rho_0 * (1. + drho_dC * (max(C ? C[i] : 0.0, 0.0) - C_0) +
+				             drho_dT * (max(T[i], 0.0) - T_0));
+			break;
+		case 6:  // rho(p,T) = rho_0*(1+beta_p*(p-p_0)+beta_T*(T-T_0))
+			for (std::size_t i = 0; i < n; i++)
+				values[i] = rho_0 * (1. + drho_dp * (max(p[i], 0.0) - p_0) +
+				                     drho_dT * (max(T[i], 0.0) - T_0));
+			break;
+		case 7:  // Pefect gas
+			for (std::size_t i = 0; i < n; i++)
+				values[i] = p[i] * molar_mass / (GAS_CONSTANT * T[i]);
+			break;
+		case 20:  // rho(p,C,T) with C = C_1
+			for (std::size_t i = 0; i < n; i++)
+				values[i] =
+				    rho_0 * (1. + drho_dp * (max(p[i], 0.0) - rho_p0) +
+				             drho_dC * (C_1 - rho_C0) +
+				             drho_dT * (max(T[i], 0.0) - rho_T0));
+			break;
+		default:
+			for (std::size_t i = 0; i < n; i++)
+			{
+				double variables[3] = {p[i], T[i], C ? C[i] : 0.0};
+				values[i] = Density(variables);
+			}
+			break;
+	}
+}
+
+void CFluidProperties::Viscosity(std::size_t n, const double* p,
+                                 const double* T, const double* C,
+                                 double* values)
+{
+	if (n == 0) return;
+	switch (viscosity_model)
+	{
+		case 1:  // my = const
+			std::fill(values, values + n, my_0);
+			break;
+		case 2:  // my(p) = my_0*(1+gamma_p*(p-p_0))
+			for (std::size_t i = 0; i < n; i++)
+				values[i] = my_0 * (1. + dmy_dp * (max(p[i], 0.0) - p_0));
+			break;
+		case 30:  // Fabien
+			for (std::size_t i = 0; i < n; i++)
+				values[i] = my_0 * std::exp(-(T[i] - my_T0) / my_Tstar);
+			break;
+		default:
+			for (std::size_t i = 0; i < n; i++)
+			{
+				double variables[3] = {p[i], T[i], C ? C[i] : 0.0};
+				values[i] = Viscosity(variables);
+			}
+			return;
+	}
+	// As the single state version, keep the last state
+	primary_variable[0] = p[n - 1];
+	primary_variable[1] = T[n - 1];
+	primary_variable[2] = C ? C[n - 1] : 0.0;
+}
+
+void CFluidProperties::SpecificHeatCapacity(std::size_t n, const double* p,
+                                            const double* T, const double* C,
+                                            double* values)
+{
+	if (n == 0) return;
+	if (heat_capacity_model == 1)  // c = const
+	{
+		std::fill(values, values + n, specific_heat_capacity);
+		primary_variable[0] = p[n - 1];
+		primary_variable[1] = T[n - 1];
+		primary_variable[2] = C ? C[n - 1] : 0.0;
+		return;
+	}
+	for (std::size_t i = 0; i < n; i++)
+	{
+		double variables[3] = {p[i], T[i], C ? C[i] : 0.0};
+		values[i] = SpecificHeatCapacity(variables);
+	}
+}
+
+void CFluidProperties::HeatConductivity(std::size_t n, const double* p,
+                                        const double* T, const double* C,
+                                        double* values)
+{
+	if (n == 0) return;
+	if (heat_conductivity_model == 1)  // c = const
+	{
+		std::fill(values, values + n, heat_conductivity);
+		primary_variable[0] = p[n - 1];
+		primary_variable[1] = T[n - 1];
+		primary_variable[2] = C ? C[n - 1] : 0.0;
+		return;
+	}
+	for (std::size_t i = 0; i < n; i++)
+	{
+		double variables[3] = {p[i], T[i], C ? C[i] : 0.0};
+		values[i] = HeatConductivity(variables);
+	}
+}
+
 /**************************************************************************
    FEMLib-Method:
    Task: Master calc function
@@ -3460,74 +3595,86 @@ double CFluidProperties::CalcEnthalpy(double temperature)
 }
 
 /**************************************************************************
-   PCSLib-Method:
-   08/2008 OK
-   last change: 11/2008 NB
+   Task: Select the MFP quantity by the first letter of its name and the
+         names of the two node values it depends on
 **************************************************************************/
-double MFPGetNodeValue(long node, const string& mfp_name, int phase_number)
+static int MFPGetNodeArgumentNames(CFluidProperties* mfp,
+                                   const string& mfp_name, string& pcs_name1,
+                                   string& pcs_name2)
 {
-	double mfp_value = 0.0;  // OK411
-	//  char c;
-	double arguments[2];
-	string pcs_name1;
-	string pcs_name2;
-	CRFProcess* tp;
-	// NB
-	CFluidProperties* m_mfp = mfp_vector[max(phase_number, 0)];
-
 	int mfp_id = -1;
-	int val_idx = 0;  // for later use, NB case 'V': mfp_id = 0; //VISCOSITY
 	switch (mfp_name[0])
 	{
 		case 'V':
 			mfp_id = 0;  // VISCOSITY
-			if (m_mfp->viscosity_pcs_name_vector.size() < 1)
+			if (mfp->viscosity_pcs_name_vector.size() < 1)
 				pcs_name1 = "PRESSURE1";
 			else
-				pcs_name1 = m_mfp->viscosity_pcs_name_vector[0];
-			if (m_mfp->viscosity_pcs_name_vector.size() < 2)
+				pcs_name1 = mfp->viscosity_pcs_name_vector[0];
+			if (mfp->viscosity_pcs_name_vector.size() < 2)
 				pcs_name2 = "TEMPERATURE1";
 			else
-				pcs_name2 = m_mfp->viscosity_pcs_name_vector[1];
+				pcs_name2 = mfp->viscosity_pcs_name_vector[1];
 			break;
 		case 'D':
 			mfp_id = 1;  // DENSITY
-			if (m_mfp->density_pcs_name_vector.size() < 1)
+			if (mfp->density_pcs_name_vector.size() < 1)
 				pcs_name1 = "PRESSURE1";
 			else
-				pcs_name1 = m_mfp->density_pcs_name_vector[0];
-			if (m_mfp->density_pcs_name_vector.size() < 2)
+				pcs_name1 = mfp->density_pcs_name_vector[0];
+			if (mfp->density_pcs_name_vector.size() < 2)
 				pcs_name2 = "TEMPERATURE1";
 			else
-				pcs_name2 = m_mfp->density_pcs_name_vector[1];
+				pcs_name2 = mfp->density_pcs_name_vector[1];
 			break;
 		case 'H':
 			mfp_id = 2;  // HEAT_CONDUCTIVITY
-			if (m_mfp->heat_conductivity_pcs_name_vector.size() < 1)
+			if (mfp->heat_conductivity_pcs_name_vector.size() < 1)
 				pcs_name1 = "PRESSURE1";
 			else
-				pcs_name1 = m_mfp->heat_conductivity_pcs_name_vector[0];
-			if (m_mfp->heat_conductivity_pcs_name_vector.size() < 2)
+				pcs_name1 = mfp->heat_conductivity_pcs_name_vector[0];
+			if (mfp->heat_conductivity_pcs_name_vector.size() < 2)
 				pcs_name2 = "TEMPERATURE1";
 			else
-				pcs_name2 = m_mfp->heat_conductivity_pcs_name_vector[1];
+				pcs_name2 = mfp->heat_conductivity_pcs_name_vector[1];
 			break;
 		case 'S':
 			mfp_id = 3;  // SPECIFIC HEAT CAPACITY
-			if (m_mfp->specific_heat_capacity_pcs_name_vector.size() < 1)
+			if (mfp->specific_heat_capacity_pcs_name_vector.size() < 1)
 				pcs_name1 = "PRESSURE1";
 			else
-				pcs_name1 = m_mfp->specific_heat_capacity_pcs_name_vector[0];
-			if (m_mfp->specific_heat_capacity_pcs_name_vector.size() < 2)
+				pcs_name1 = mfp->specific_heat_capacity_pcs_name_vector[0];
+			if (mfp->specific_heat_capacity_pcs_name_vector.size() < 2)
 				pcs_name2 = "TEMPERATURE1";
 			else
-				pcs_name2 = m_mfp->specific_heat_capacity_pcs_name_vector[1];
+				pcs_name2 = mfp->specific_heat_capacity_pcs_name_vector[1];
 			break;
 		default:
 			mfp_id = -1;
 			pcs_name1 = "PRESSURE1";
 			pcs_name2 = "TEMPERATURE1";
 	}
+	return mfp_id;
+}
+
+/**************************************************************************
+   PCSLib-Method:
+   08/2008 OK
+   last change: 11/2008 NB
+**************************************************************************/
+double MFPGetNodeValue(long node, const string& mfp_name, int phase_number)
+{
+	double mfp_value = 0.0;  // OK411
+	double arguments[2];
+	string pcs_name1;
+	string pcs_name2;
+	CRFProcess* tp;
+	// NB
+	CFluidProperties* m_mfp = mfp_vector[max(phase_number, 0)];
+
+	int val_idx = 0;
+	const int mfp_id =
+	    MFPGetNodeArgumentNames(m_mfp, mfp_name, pcs_name1, pcs_name2);
 	//......................................................................
 
 	int restore_mode = m_mfp->mode;
@@ -3582,6 +3729,57 @@ double MFPGetNodeValue(long node, const string& mfp_name, int phase_number)
 	return mfp_value;
 }
 
+/**************************************************************************
+   Task: MFPGetNodeValue for n nodes at once. The node values are gathered
+         first and the fluid property is evaluated by its batch version.
+**************************************************************************/
+void MFPGetNodeValues(std::size_t n, const long* nodes, const string& mfp_name,
+                      int phase_number, double* values)
+{
+	if (n == 0) return;
+	string pcs_name1;
+	string pcs_name2;
+	CFluidProperties* m_mfp = mfp_vector[max(phase_number, 0)];
+	const int mfp_id =
+	    MFPGetNodeArgumentNames(m_mfp, mfp_name, pcs_name1, pcs_name2);
+	if (mfp_id < 0)
+	{
+		cout << "MFPGetNodeValue: no MFP data" << endl;
+		std::fill(values, values + n, 0.0);
+		return;
+	}
+
+	CRFProcess* tp1 = PCSGet(pcs_name1, true);
+	const int idx1 = tp1->GetNodeValueIndex(pcs_name1, true);
+	CRFProcess* tp2 = PCSGet(pcs_name2, true);
+	const int idx2 = tp2->GetNodeValueIndex(pcs_name2, true);
+	std::vector<double> arg1(n), arg2(n);
+	for (std::size_t i = 0; i < n; i++)
+	{
+		arg1[i] = tp1->GetNodeValue(nodes[i], idx1);
+		arg2[i] = tp2->GetNodeValue(nodes[i], idx2);
+	}
+
+	int restore_mode = m_mfp->mode;
+	m_mfp->mode = 0;
+	switch (mfp_id)
+	{
+		case 0:
+			m_mfp->Viscosity(n, &arg1[0], &arg2[0], NULL, values);
+			break;
+		case 1:
+			m_mfp->Density(n, &arg1[0], &arg2[0], NULL, values);
+			break;
+		case 2:
+			m_mfp->HeatConductivity(n, &arg1[0], &arg2[0], NULL, values);
+			break;
+		case 3:
+			m_mfp->SpecificHeatCapacity(n, &arg1[0], &arg2[0], NULL, values);
+			break;
+	}
+	m_mfp->mode = restore_mode;
+}
+
 /**************************************************************************
    Task: Derivative of density with respect to pressure at constant T and mass
 fraction
@@ -199,6 +199,16 @@ public:
 	void therm_prop(std::string caption);
 	double PhaseChange();
 	double HeatConductivity(double* variables = NULL);
+	// Batch versions for n states p[i], T[i], C[i] (C may be NULL).
+	// Simple models are evaluated in one loop, the others per state.
+	void Density(std::size_t n, const double* p, const double* T,
+	             const double* C, double* values);
+	void Viscosity(std::size_t n, const double* p, const double* T,
+	               const double* C, double* values);
+	void SpecificHeatCapacity(std::size_t n, const double* p, const double* T,
+	                          const double* C, double* values);
+	void HeatConductivity(std::size_t n, const double* p, const double* T,
+	                      const double* C, double* values);
 	double CalcEnthalpy(double temperature);
 	double vaporDensity(const double T);
 	double vaporDensity_derivative(const double T);
@@ -261,5 +271,8 @@ extern void MFPDelete();
 extern CFluidProperties* MFPGet(const std::string&);
 extern CFluidProperties* MFPGet(int);
 double MFPGetNodeValue(long, const std::string&, int);
+void MFPGetNodeValues(std::size_t n, const long* nodes,
+                      const std::string& mfp_name, int phase_number,
+                      double* values);
 
 #endif
@@ -14,11 +14,14 @@
 
 #include "display.h"
 #include "FileToolsRF.h"
+#include "StringTools.h"
 
 #include "Curve.h"
+#include "InterpolationAlgorithms/MonotoneCubicInterpolation.h"
 #include "mathlib.h"
 
 #include "ElementValue.h"
+#include "HeterogeneousField.h"
 #include "fem_ele_std.h"
 #include "fem_ele_vec.h"
 #include "files0.h"
@@ -89,8 +92,14 @@ CMediumProperties::CMediumProperties()
 	flowlinearity_model = 0;
 	capillary_pressure_model = -1;
 	capillary_pressure_values[4] = 1.0 / DBL_EPSILON;  // JT: max Pc
+	curve_surrogate_tolerance = -1.0;
+	capillary_pressure_surrogate = NULL;
+	saturation_surrogate = NULL;
+	for (int i = 0; i < MAX_FLUID_PHASES; i++)
+		rel_perm_surrogate[i] = NULL;
 	entry_pressure_conversion = false;
-	permeability_saturation_model[0] = -1;
+	for (int i = 0; i < MAX_FLUID_PHASES; i++)
+		permeability_saturation_model[i] = -1;
 	minimum_relative_permeability = 1.0e-9;  // JT: the default value
 	unconfined_flow_group = -1;
 	permeability_stress_mode = -1;  // WW
@@ -137,6 +146,10 @@ CMediumProperties::CMediumProperties()
 CMediumProperties::~CMediumProperties(void)
 {
 	if (c_coefficient) delete[] c_coefficient;  // WW
+	delete capillary_pressure_surrogate;
+	delete saturation_surrogate;
+	for (int i = 0; i < MAX_FLUID_PHASES; i++)
+		delete rel_perm_surrogate[i];
 	geo_name_vector.clear();
 }
 
@@ -1743,6 +1756,17 @@ std::ios::pos_type CMediumProperties::Read(std::ifstream* mmp_file)
 			continue;
 		}
 		//....................................................................
+		// Spline surrogates of the capillary pressure and relative
+		// permeability functions: relative tolerance
+		if (line_string.find("$CURVE_SURROGATE") != std::string::npos)
+		{
+			in.str(GetLineFromFile1(mmp_file));
+			curve_surrogate_tolerance = 1.0e-6;
+			in >> curve_surrogate_tolerance;
+			in.clear();
+			continue;
+		}
+		//....................................................................
 		// Dual Richards
 		if (line_string.find("$TRANSFER_COEFFICIENT") != std::string::npos)
 		{
@@ -2390,6 +2414,8 @@ double CMediumProperties::PermeabilitySaturationFunction(
 	double kr = .0, sl, se, slr, slm, m, b;
 	int model, gueltig;
 	bool phase_shift = false;
+	if (rel_perm_surrogate[phase])
+		return rel_perm_surrogate[phase]->getValue(wetting_saturation);
 	sl = wetting_saturation;
 	//
 	model = permeability_saturation_model[phase];
@@ -2779,6 +2805,18 @@ double* CMediumProperties::HeatConductivityTensor(int number, double* variables)
 	// long group = Fem_Ele_Std->GetMeshElement()->GetPatchIndex();
 	m_mfp = Fem_Ele_Std->FluidProp;  // WW
 
+	MaterialParameterCache* const cache = m_pcs ? m_pcs->material_cache : NULL;
+	if (cache)
+	{
+		const double* values = cache->getValues(
+		    MaterialParameterCache::HEAT_CONDUCTIVITY, number, this);
+		if (values)
+		{
+			std::copy(values, values + 9, heat_conductivity_tensor);
+			return heat_conductivity_tensor;
+		}
+	}
+
 	{
 		for (size_t ii = 0; ii < pcs_vector.size(); ii++)
 			//		if (pcs_vector[ii]->pcs_type_name.find("FLOW") !=
@@ -2921,6 +2959,9 @@ double* CMediumProperties::HeatConductivityTensor(int number, double* variables)
 		for (i = 0; i < dimen; i++)
 			heat_conductivity_tensor[i * dimen + i] = Kx[i];
 	}
+	if (cache)
+		cache->setValues(MaterialParameterCache::HEAT_CONDUCTIVITY, number,
+		                 this, heat_conductivity_tensor);
 	return heat_conductivity_tensor;
 }
 
@@ -3801,6 +3842,20 @@ double CMediumProperties::Porosity(long number, double theta)
 	//		    == 0)
 	//			break;
 
+	// Element values, not for node values (mode 1)
+	MaterialParameterCache* const cache =
+	    (m_pcs && mode != 1) ? m_pcs->material_cache : NULL;
+	if (cache)
+	{
+		const double* values =
+		    cache->getValues(MaterialParameterCache::POROSITY, number, this);
+		if (values)
+		{
+			porosity = values[0];
+			return porosity;
+		}
+	}
+
 	// Functional dependencies
 	CRFProcess* pcs_temp;
 
@@ -3956,6 +4011,9 @@ double CMediumProperties::Porosity(long number, double theta)
 			cout << "Unknown porosity model!" << endl;
 			break;
 	}
+	if (cache)
+		cache->setValues(MaterialParameterCache::POROSITY, number, this,
+		                 &porosity);
 	return porosity;
 }
 
@@ -4287,6 +4345,18 @@ double* CMediumProperties::PermeabilityTensor(long index)
 	int idx_k, idx_n;
 	double /*k_old, n_old,*/ k_new, n_new, k_rel, n_rel;
 
+	MaterialParameterCache* const cache = m_pcs ? m_pcs->material_cache : NULL;
+	if (cache)
+	{
+		const double* values = cache->getValues(
+		    MaterialParameterCache::PERMEABILITY, index, this);
+		if (values)
+		{
+			std::copy(values, values + 9, tensor);
+			return tensor;
+		}
+	}
+
 	// HS: move the following loop into the "if ( permeability_tensor_type == 0
 	// )" scope.----
 	// this is not necessary for in-isotropic case;
@@ -4658,9 +4728,90 @@ double* CMediumProperties::PermeabilityTensor(long index)
 	for (size_t i = 0; i < 9; i++)
 		tensor[i] *= k_rel;
 
+	if (cache)
+		cache->setValues(MaterialParameterCache::PERMEABILITY, index, this,
+		                 tensor);
 	return tensor;
 }
 
+/**************************************************************************
+   FEMLib-Method:
+   Task: Dependency of the element values of PermeabilityTensor() on the
+         state. The heterogeneous field (model 2) is static. The
+         porosity-permeability models 5 to 8 only read the element porosity,
+         which changes between but not during the solution of a process if
+         the porosity model does not depend on the state. Models 3 and 4
+         shift the stored old permeability on every call.
+**************************************************************************/
+MaterialParameterCache::Dependency CMediumProperties::PermeabilityDependency()
+    const
+{
+	if (permeability_pressure_model > 1)
+		return MaterialParameterCache::STATE_DEPENDENT;
+	if (permeability_model == 3 || permeability_model == 4)
+		return MaterialParameterCache::STATE_DEPENDENT;
+	if (permeability_model >= 5 && permeability_model <= 8)
+		return (PorosityDependency() == MaterialParameterCache::STATE_DEPENDENT)
+		           ? MaterialParameterCache::STATE_DEPENDENT
+		           : MaterialParameterCache::TIME_DEPENDENT;
+	return MaterialParameterCache::STATE_INDEPENDENT;
+}
+
+/**************************************************************************
+   FEMLib-Method:
+   Task: Dependency of the element values of Porosity(number, theta) on
+         the state. Constant and heterogeneous porosities are static, the
+         GEMS porosity (model 15) is updated between the processes only.
+**************************************************************************/
+MaterialParameterCache::Dependency CMediumProperties::PorosityDependency()
+    const
+{
+	switch (porosity_model)
+	{
+		case 1:
+		case 11:
+			return MaterialParameterCache::STATE_INDEPENDENT;
+#ifdef GEM_REACT
+		case 15:
+			return MaterialParameterCache::TIME_DEPENDENT;
+#endif
+		default:
+			return MaterialParameterCache::STATE_DEPENDENT;
+	}
+}
+
+/**************************************************************************
+   FEMLib-Method:
+   Task: Dependency of HeatConductivityTensor() on the state. It is static
+         if the solid and fluid conductivities are constant and no flow
+         process makes it depend on the saturation.
+**************************************************************************/
+MaterialParameterCache::Dependency
+CMediumProperties::HeatConductivityDependency() const
+{
+	if (evaporation == 647) return MaterialParameterCache::STATE_DEPENDENT;
+	for (size_t i = 0; i < msp_vector.size(); i++)
+		if (msp_vector[i]->GetConductModel() != 1)
+			return MaterialParameterCache::STATE_DEPENDENT;
+	bool flow = false;
+	for (size_t i = 0; i < pcs_vector.size(); i++)
+	{
+		const FiniteElement::ProcessType pcs_type =
+		    pcs_vector[i]->getProcessType();
+		if (!isFlowProcess(pcs_type)) continue;
+		if (pcs_type != FiniteElement::LIQUID_FLOW &&
+		    pcs_type != FiniteElement::GROUNDWATER_FLOW &&
+		    pcs_type != FiniteElement::TH_MONOLITHIC)
+			return MaterialParameterCache::STATE_DEPENDENT;
+		flow = true;
+	}
+	if (flow)
+		for (size_t i = 0; i < mfp_vector.size(); i++)
+			if (mfp_vector[i]->heat_conductivity_model != 1)
+				return MaterialParameterCache::STATE_DEPENDENT;
+	return MaterialParameterCache::STATE_INDEPENDENT;
+}
+
 //------------------------------------------------------------------------
 // 12.(i) PERMEABILITY_FUNCTION_DEFORMATION
 //------------------------------------------------------------------------
@@ -4901,6 +5052,8 @@ double CMediumProperties::CapillaryPressureFunction(
 {
 	double pc, pb, sl, slr, slm, se, m;
 	int gueltig;
+	if (capillary_pressure_surrogate)
+		return capillary_pressure_surrogate->getValue(wetting_saturation);
 	sl = wetting_saturation;
 	//
 	switch (capillary_pressure_model)
@@ -4979,6 +5132,9 @@ double CMediumProperties::SaturationCapillaryPressureFunction(
 {
 	double se, sl, slr, slm, m, pb, pc;
 	int gueltig;
+	if (saturation_surrogate &&
+	    capillary_pressure <= saturation_surrogate->getSupportMax())
+		return saturation_surrogate->getValue(capillary_pressure);
 	pc = capillary_pressure;
 	//
 	// Get Se
@@ -5300,6 +5456,199 @@ double CMediumProperties::Density(long element, double* gp, double theta)
 	return density;
 }
 
+/**************************************************************************
+   FEMLib-Method:
+   Task: Batch versions of CapillaryPressureFunction(),
+         SaturationCapillaryPressureFunction() and
+         PermeabilitySaturationFunction()
+**************************************************************************/
+void CMediumProperties::CapillaryPressureFunction(
+    std::size_t n, const double* wetting_saturation, double* capillary_pressure)
+{
+	if (capillary_pressure_surrogate)
+	{
+		capillary_pressure_surrogate->getValues(n, wetting_saturation,
+		                                        capillary_pressure);
+		return;
+	}
+	for (std::size_t i = 0; i < n; i++)
+		capillary_pressure[i] = CapillaryPressureFunction(wetting_saturation[i]);
+}
+
+void CMediumProperties::SaturationCapillaryPressureFunction(
+    std::size_t n, const double* capillary_pressure, double* wetting_saturation)
+{
+	for (std::size_t i = 0; i < n; i++)
+		wetting_saturation[i] =
+		    SaturationCapillaryPressureFunction(capillary_pressure[i]);
+}
+
+void CMediumProperties::PermeabilitySaturationFunction(
+    std::size_t n, const double* wetting_saturation, int phase, double* kr)
+{
+	if (rel_perm_surrogate[phase])
+	{
+		rel_perm_surrogate[phase]->getValues(n, wetting_saturation, kr);
+		return;
+	}
+	for (std::size_t i = 0; i < n; i++)
+		kr[i] = PermeabilitySaturationFunction(wetting_saturation[i], phase);
+}
+
+namespace
+{
+/// The exact curves as functions of one variable for
+/// MathLib::MonotoneCubicInterpolation::createAdaptive()
+struct CapillaryPressureCurve
+{
+	explicit CapillaryPressureCurve(CMediumProperties* mmp) : _mmp(mmp) {}
+	double operator()(double sl) { return _mmp->CapillaryPressureFunction(sl); }
+	CMediumProperties* _mmp;
+};
+
+struct SaturationCurve
+{
+	explicit SaturationCurve(CMediumProperties* mmp) : _mmp(mmp) {}
+	double operator()(double pc)
+	{
+		return _mmp->SaturationCapillaryPressureFunction(pc);
+	}
+	CMediumProperties* _mmp;
+};
+
+struct RelativePermeabilityCurve
+{
+	RelativePermeabilityCurve(CMediumProperties* mmp, int phase)
+	    : _mmp(mmp), _phase(phase)
+	{
+	}
+	double operator()(double sl)
+	{
+		return _mmp->PermeabilitySaturationFunction(sl, _phase);
+	}
+	CMediumProperties* _mmp;
+	int _phase;
+};
+
+const std::size_t max_surrogate_points = 1 << 16;
+
+void reportSurrogate(const std::string& mmp_name, const char* curve,
+                     MathLib::MonotoneCubicInterpolation* surrogate,
+                     double max_error)
+{
+	if (surrogate)
+		ScreenMessage(
+		    "-> MMP %s: %s spline with %d points, max. rel. error %g\n",
+		    mmp_name.c_str(), curve,
+		    (int)surrogate->getNumberOfSupportingPoints(), max_error);
+	else
+		ScreenMessage(
+		    "-> MMP %s: %s spline does not reach the tolerance, exact "
+		    "function is used\n",
+		    mmp_name.c_str(), curve);
+}
+}
+
+/**************************************************************************
+   FEMLib-Method:
+   Task: Replace the van Genuchten, Brooks & Corey and power law functions
+         of capillary pressure, saturation and relative permeability by
+         monotone cubic splines ($CURVE_SURROGATE). The splines are bisected
+         until the deviation from the exact function at 1/4, 1/2 and 3/4 of
+         every interval is below curve_surrogate_tolerance (relative).
+         Outside of the sampled range the functions are constant, as the
+         exact ones, except Sw(Pc) above the maximum Pc which is evaluated
+         exactly. Curves (model 0) are piecewise linear and kept.
+**************************************************************************/
+void CMediumProperties::CreateCurveSurrogates()
+{
+	if (curve_surrogate_tolerance <= 0.0) return;
+
+	double max_error = 0.;
+	// The entry pressure conversion has to be constant
+	const bool constant_pb =
+	    !entry_pressure_conversion || mfp_vector[0]->density_model == 1;
+	if ((capillary_pressure_model == 4 || capillary_pressure_model == 6) &&
+	    constant_pb)
+	{
+		double pb = capillary_pressure_values[0];
+		const double slr = capillary_pressure_values[1];
+		const double slm = capillary_pressure_values[2];
+		const double m = capillary_pressure_values[3];
+		const double pc_max = capillary_pressure_values[4];
+		if (entry_pressure_conversion && capillary_pressure_model == 4)
+			pb = (mfp_vector[0]->Density() * 9.81) / pb;
+
+		// Pc(Sw) is limited to pc_max below this saturation
+		double se_max_pc;
+		if (capillary_pressure_model == 4)
+			se_max_pc = pow(pow(pc_max / pb, 1.0 / (1.0 - m)) + 1.0, -m);
+		else
+			se_max_pc = pow(pc_max / pb, -m);
+		const double sl_max_pc = slr + MRange(0.0, se_max_pc, 1.0) * (slm - slr);
+
+		CapillaryPressureCurve pc_curve(this);
+		MathLib::MonotoneCubicInterpolation* pc_surrogate =
+		    (sl_max_pc < slm)
+		        ? MathLib::MonotoneCubicInterpolation::createAdaptive(
+		              pc_curve, sl_max_pc, slm, curve_surrogate_tolerance,
+		              max_surrogate_points, &max_error)
+		        : NULL;
+		reportSurrogate(name, "Pc(Sw)", pc_surrogate, max_error);
+
+		SaturationCurve sw_curve(this);
+		MathLib::MonotoneCubicInterpolation* sw_surrogate =
+		    MathLib::MonotoneCubicInterpolation::createAdaptive(
+		        sw_curve, 0.0, pc_max, curve_surrogate_tolerance,
+		        max_surrogate_points, &max_error);
+		reportSurrogate(name, "Sw(Pc)", sw_surrogate, max_error);
+
+		capillary_pressure_surrogate = pc_surrogate;
+		saturation_surrogate = sw_surrogate;
+	}
+
+	for (int phase = 0; phase < MAX_FLUID_PHASES; phase++)
+	{
+		int model = permeability_saturation_model[phase];
+		int model_phase = phase;
+		if (model == 2)
+		{  // krg = 1.0 - krl
+			model_phase = 0;
+			model = permeability_saturation_model[0];
+		}
+		double sl_min, sl_max;
+		switch (model)
+		{
+			case 3:
+			case 4:
+			case 6:
+			case 7:  // wetting
+				sl_min = residual_saturation[model_phase];
+				sl_max = maximum_saturation[model_phase];
+				break;
+			case 33:
+			case 44:
+			case 66:
+			case 77:  // non-wetting
+				sl_min = 1.0 - maximum_saturation[model_phase];
+				sl_max = 1.0 - residual_saturation[model_phase];
+				break;
+			default:
+				continue;
+		}
+		if (!(sl_min < sl_max)) continue;
+
+		RelativePermeabilityCurve kr_curve(this, phase);
+		MathLib::MonotoneCubicInterpolation* kr_surrogate =
+		    MathLib::MonotoneCubicInterpolation::createAdaptive(
+		        kr_curve, sl_min, sl_max, curve_surrogate_tolerance,
+		        max_surrogate_points, &max_error);
+		const std::string curve = "kr(Sw) of phase " + number2str(phase);
+		reportSurrogate(name, curve.c_str(), kr_surrogate, max_error);
+		rel_perm_surrogate[phase] = kr_surrogate;
+	}
+}
+
 /**************************************************************************
    FEMLib-Method:
    Task:
@@ -5455,6 +5804,56 @@ void CMediumProperties::SetConstantELEarea(double area, int group)
 		}
 }
 
+namespace
+{
+/// Index of the distributed material property in mat_vector of the elements
+int GetEleMatIndex(CFEMesh* mesh, const std::string& mmp_property_name)
+{
+	std::vector<std::string>::iterator itr =
+	    std::find(mesh->mat_names_vector.begin(),
+	              mesh->mat_names_vector.end(), mmp_property_name);
+	if (mesh->mat_names_vector.end() != itr)
+		return itr - mesh->mat_names_vector.begin();
+	mesh->mat_names_vector.push_back(mmp_property_name);
+	return mesh->mat_names_vector.size() - 1;
+}
+
+void AppendEleMatValue(MeshLib::CElem* ele, double value)
+{
+	const int mat_vector_size = ele->mat_vector.Size();
+	// Store old values as they are set to zero after resizing
+	std::vector<double> garage(mat_vector_size);
+	for (int j = 0; j < mat_vector_size; j++)
+		garage[j] = ele->mat_vector(j);
+	ele->mat_vector.resize(mat_vector_size + 1);
+	for (int j = 0; j < mat_vector_size; j++)
+		ele->mat_vector(j) = garage[j];
+	ele->mat_vector(mat_vector_size) = value;
+}
+
+/// Nearest ('N') or averaged ('G') values of field for the elements of the
+/// material group mmp_id
+void MapHeterogeneousField(CFEMesh* mesh, size_t mmp_id, char dis_type,
+                           const HeterogeneousField& field)
+{
+	const long n_elements = (long)mesh->ele_vector.size();
+	std::vector<double> ele_values(n_elements);
+#pragma omp parallel for schedule(dynamic, 256)
+	for (long i = 0; i < n_elements; i++)
+	{
+		if (mesh->ele_vector[i]->GetPatchIndex() != mmp_id) continue;
+		if (dis_type == 'N')
+			ele_values[i] =
+			    field.getValues()[GetNearestHetVal2(i, mesh, field)];
+		else
+			ele_values[i] = GetAverageHetVal2(i, mesh, field);
+	}
+	for (long i = 0; i < n_elements; i++)
+		if (mesh->ele_vector[i]->GetPatchIndex() == mmp_id)
+			AppendEleMatValue(mesh->ele_vector[i], ele_values[i]);
+}
+}
+
 /**************************************************************************
    PCSLib-Method:
    Programing:
@@ -5469,7 +5868,7 @@ int CMediumProperties::SetDistributedELEProperties(const string& file_name,
 	string mmp_property_mesh;
 	MeshLib::CElem* m_ele_geo = NULL;
 	bool element_area = false;
-	long i, j, ihet;
+	long i;
 	double mmp_property_value;
 	int mat_vector_size = 0;                 // Init WW
 	double ddummy, conversion_factor = 1.0;  // init WW
@@ -5478,15 +5877,12 @@ int CMediumProperties::SetDistributedELEProperties(const string& file_name,
 	int c_vals;
 	double x, y, z, mmpv;
 	std::stringstream in;
-	// CB
-	vector<double> garage;
-	int mat_vec_size = 0;
-	int por_index = 0;
-	int vol_bio_index = 0;
 	string outfile;
 	// int k;
 
 	cout << " SetDistributedELEProperties: ";
+	if (HeterogeneousFieldFile::isBinary(file_name))
+		return SetDistributedELEPropertiesBinary(file_name, mmp_id);
 	//----------------------------------------------------------------------
 	// File handling
 	ifstream mmp_property_file(file_name.data(), ios::in);
@@ -5537,18 +5933,7 @@ int CMediumProperties::SetDistributedELEProperties(const string& file_name,
 			element_area = false;
 			mmp_property_file >> mmp_property_name;
 			cout << mmp_property_name << endl;
-			std::vector<std::string>::iterator itr =
-			    std::find(_mesh->mat_names_vector.begin(),
-			              _mesh->mat_names_vector.end(), mmp_property_name);
-			if (_mesh->mat_names_vector.end() == itr)
-			{
-				_mesh->mat_names_vector.push_back(mmp_property_name);
-				ele_mat_id = _mesh->mat_names_vector.size() - 1;
-			}
-			else
-			{
-				ele_mat_id = itr - _mesh->mat_names_vector.begin();
-			}
+			ele_mat_id = GetEleMatIndex(_mesh, mmp_property_name);
 			if (mmp_property_name == "GEOMETRY_AREA") element_area = true;
 			continue;
 		}
@@ -5587,43 +5972,19 @@ int CMediumProperties::SetDistributedELEProperties(const string& file_name,
 						zvals.push_back(z);
 						mmpvals.push_back(mmpv);
 					}
-					// sort values to mesh
-					for (i = 0; i < (long)_mesh->ele_vector.size(); i++)
+					if (xvals.empty())
 					{
-						m_ele_geo = _mesh->ele_vector[i];
-						// check mat id
-						if (m_ele_geo->GetPatchIndex() != mmp_id)
-							continue;  // NW
-
-						mat_vector_size = m_ele_geo->mat_vector.Size();
-						// CB Store old values as they are set to zero after
-						// resizing
-						for (j = 0; j < mat_vector_size; j++)
-							garage.push_back(m_ele_geo->mat_vector(j));
-						m_ele_geo->mat_vector.resize(mat_vector_size + 1);
-						// CB Refill old values as they were set to zero after
-						// resizing
-						for (j = 0; j < mat_vector_size; j++)
-							m_ele_geo->mat_vector(j) = garage[j];
-						garage.clear();
-						if (mmp_property_dis_type[0] == 'N')
-						{
-							// Search for all elements of the mesh, which is the
-							// nearest given value in the input file
-							// Return value ihet is the index of the het. val in
-							// the mmpval-vector
-							ihet = GetNearestHetVal2(i, _mesh, xvals, yvals,
-							                         zvals, mmpvals);
-							m_ele_geo->mat_vector(mat_vector_size) =
-							    mmpvals[ihet];
-						}
-						if (mmp_property_dis_type[0] == 'G')
-						{
-							mmpv = GetAverageHetVal2(i, _mesh, xvals, yvals,
-							                         zvals, mmpvals);
-							m_ele_geo->mat_vector(mat_vector_size) = mmpv;
-						}
+						cout << "Error in "
+						        "CMediumProperties::"
+						        "SetDistributedELEProperties - no data"
+						     << endl;
+						return -1;
 					}
+					// sort values to mesh, nearest values are found with a
+					// grid of buckets of the data points
+					MapHeterogeneousField(
+					    _mesh, mmp_id, mmp_property_dis_type[0],
+					    HeterogeneousField(xvals, yvals, zvals, mmpvals));
 					break;
 				case 'E':  // Element data
 					for (i = 0; i < (long)_mesh->ele_vector.size(); i++)
@@ -5677,8 +6038,131 @@ int CMediumProperties::SetDistributedELEProperties(const string& file_name,
 		}
 		//....................................................................
 	}
-	// CB now set VOL_MAT & VOL_BIO as heterogeneous values, if defined as model
-	// 2 and het Porosity
+	SetDistributedVolumeFractions(mmp_property_name);
+//----------------------------------------------------------------------
+// Write sorted output file
+//----------------------------------------------------------------------
+// File handling
+
+#if 0  // commented out by NW
+	// CB
+	for(k = 0; k < (int)_mesh->mat_names_vector.size(); k++)
+	{
+		//file_name +="_sorted";
+		outfile = _mesh->mat_names_vector[k] + "_sorted";
+		ofstream mmp_property_file_out(outfile.data());
+		if(!mmp_property_file_out.good())
+		{
+			cout <<
+			"Warning in CMediumProperties::WriteDistributedELEProperties: no MMP property data file to write to"
+			     << endl;
+			return;
+		}
+		mmp_property_file_out << "#MEDIUM_PROPERTIES_DISTRIBUTED" << endl;
+		mmp_property_file_out << "$MSH_TYPE" << endl << "  " << mmp_property_mesh << endl;
+		//mmp_property_file_out << "$MSH_TYPE" << endl << "  " << mmp_property_mesh << endl;
+		//mmp_property_file_out << "$MMP_TYPE" << endl << "  " << "PERMEABILITY" << endl;
+		mmp_property_file_out << "$MMP_TYPE" << endl << "  " <<
+		_mesh->mat_names_vector[k] << endl;
+		mmp_property_file_out << "$DIS_TYPE" << endl << "  " << "ELEMENT" << endl;
+		mmp_property_file_out << "$DATA" << endl;
+		for(i = 0; i < (long)_mesh->ele_vector.size(); i++)
+		{
+			m_ele_geo = _mesh->ele_vector[i];
+			mmp_property_file_out << i << "  " << m_ele_geo->mat_vector(k) << endl;
+		}
+		mmp_property_file_out << "#STOP" << endl;
+		mmp_property_file_out.close();
+		//----------------------------------------------------------------------
+	}
+#endif
+
+	return ele_mat_id;
+}
+
+/**************************************************************************
+   FEMLib-Method:
+   Task: SetDistributedELEProperties for a file in the binary format of
+         HeterogeneousFieldFile
+**************************************************************************/
+int CMediumProperties::SetDistributedELEPropertiesBinary(
+    const string& file_name, size_t mmp_id)
+{
+	HeterogeneousFieldFile data;
+	if (!data.read(file_name))
+	{
+		cout << "Error in CMediumProperties::SetDistributedELEProperties: "
+		        "cannot read binary MMP property data" << endl;
+		return -1;
+	}
+	_mesh = FEMGet(data.msh_type);
+	if (!_mesh)
+	{
+		cout << "CMediumProperties::SetDistributedELEProperties: no MSH data"
+		     << endl;
+		return -1;
+	}
+	cout << data.mmp_type << endl;
+	const int ele_mat_id = GetEleMatIndex(_mesh, data.mmp_type);
+
+	const long n_elements = (long)_mesh->ele_vector.size();
+	switch (data.dis_type[0])
+	{
+		case 'N':  // Next neighbour
+		case 'G':  // Geometric mean
+			if (data.values.empty())
+			{
+				cout << "Error in CMediumProperties::"
+				        "SetDistributedELEProperties - no data" << endl;
+				return -1;
+			}
+			for (size_t i = 0; i < data.values.size(); i++)
+				data.values[i] *= data.conversion_factor;
+			MapHeterogeneousField(
+			    _mesh, mmp_id, data.dis_type[0],
+			    HeterogeneousField(data.x, data.y, data.z, data.values));
+			break;
+		case 'E':  // Element data
+			if ((long)data.values.size() < n_elements)
+			{
+				cout << "Error in CMediumProperties::"
+				        "SetDistributedELEProperties - not enough data sets"
+				     << endl;
+				return -1;
+			}
+			for (long i = 0; i < n_elements; i++)
+			{
+				MeshLib::CElem* ele = _mesh->ele_vector[i];
+				if (ele->GetPatchIndex() != mmp_id) continue;
+				AppendEleMatValue(ele, data.values[i]);
+				if (data.mmp_type == "GEOMETRY_AREA")
+					ele->SetFluxArea(data.values[i]);
+			}
+			break;
+		default:
+			cout << " Unknown interpolation option for the values!" << endl;
+			break;
+	}
+	SetDistributedVolumeFractions(data.mmp_type);
+	return ele_mat_id;
+}
+
+/**************************************************************************
+   FEMLib-Method:
+   Task: Heterogeneous VOL_BIO and VOL_MAT for a heterogeneous porosity,
+         if defined as model 2
+**************************************************************************/
+void CMediumProperties::SetDistributedVolumeFractions(
+    const string& mmp_property_name)
+{
+	MeshLib::CElem* m_ele_geo = NULL;
+	int mat_vec_size = 0;
+	int por_index = 0;
+	int vol_bio_index = 0;
+	long i;
+	vector<double> garage;
+	int j;
+
 	if ((mmp_property_name == "POROSITY") && (this->vol_bio_model == 2))
 	{
 		_mesh->mat_names_vector.push_back("VOL_BIO");
@@ -5730,45 +6214,6 @@ int CMediumProperties::SetDistributedELEProperties(const string& file_name,
 			    m_ele_geo->mat_vector(vol_bio_index);
 		}
 	}
-//----------------------------------------------------------------------
-// Write sorted output file
-//----------------------------------------------------------------------
-// File handling
-
-#if 0  // commented out by NW
-	// CB
-	for(k = 0; k < (int)_mesh->mat_names_vector.size(); k++)
-	{
-		//file_name +="_sorted";
-		outfile = _mesh->mat_names_vector[k] + "_sorted";
-		ofstream mmp_property_file_out(outfile.data());
-		if(!mmp_property_file_out.good())
-		{
-			cout <<
-			"Warning in CMediumProperties::WriteDistributedELEProperties: no MMP property data file to write to"
-			     << endl;
-			return;
-		}
-		mmp_property_file_out << "#MEDIUM_PROPERTIES_DISTRIBUTED" << endl;
-		mmp_property_file_out << "$MSH_TYPE" << endl << "  " << mmp_property_mesh << endl;
-		//mmp_property_file_out << "$MSH_TYPE" << endl << "  " << mmp_property_mesh << endl;
-		//mmp_property_file_out << "$MMP_TYPE" << endl << "  " << "PERMEABILITY" << endl;
-		mmp_property_file_out << "$MMP_TYPE" << endl << "  " <<
-		_mesh->mat_names_vector[k] << endl;
-		mmp_property_file_out << "$DIS_TYPE" << endl << "  " << "ELEMENT" << endl;
-		mmp_property_file_out << "$DATA" << endl;
-		for(i = 0; i < (long)_mesh->ele_vector.size(); i++)
-		{
-			m_ele_geo = _mesh->ele_vector[i];
-			mmp_property_file_out << i << "  " << m_ele_geo->mat_vector(k) << endl;
-		}
-		mmp_property_file_out << "#STOP" << endl;
-		mmp_property_file_out.close();
-		//----------------------------------------------------------------------
-	}
-#endif
-
-	return ele_mat_id;
 }
 
 /**************************************************************************
@@ -5931,7 +6376,7 @@ void CMediumProperties::WriteTecplotDistributedProperties()
 
 /**************************************************************************
    MSHLib-Method: GetNearestHetVal2
-   Task:
+   Task: Index of the data point nearest to the element center
    Programing:
    0?/2004 SB Implementation
    09/2005 MB EleClass
@@ -5939,131 +6384,70 @@ void CMediumProperties::WriteTecplotDistributedProperties()
 **************************************************************************/
 long GetNearestHetVal2(long EleIndex,
                        CFEMesh* m_msh,
-                       vector<double> xvals,
-                       vector<double> yvals,
-                       vector<double> zvals,
-                       vector<double> mmpvals)
+                       const HeterogeneousField& field)
 {
-	(void)mmpvals;
-	long i, nextele, no_values;
-	double ex, ey, ez, dist, dist1;  // WW , dist2;
-	double x, y, z;
-	MeshLib::CElem* m_ele = NULL;
-	no_values = (long)xvals.size();
-
-	x = 0.0;
-	y = 0.0;
-	z = 0.0;
-	dist = 10000000.0;  // Startwert
-	// WW dist2 = 0.01;                                  // Abstand zwischen
-	// eingelesenen Knoten und Geometrieknoten-RF;
-	// Achtung, doppelbelegung möglich bei kleinen Gitterabständen
-	nextele = -1;
-
-	// Get element data
-	m_ele = m_msh->ele_vector[EleIndex];
-	double const* center(m_ele->GetGravityCenter());
-	x = center[0];
-	y = center[1];
-	z = center[2];
-
-	// Calculate distances
-	for (i = 0; i < no_values; i++)
-	{
-		ex = xvals[i];
-		ey = yvals[i];
-		ez = zvals[i];
-		dist1 = (ex - x) * (ex - x) + (ey - y) * (ey - y) + (ez - z) * (ez - z);
-		if (dist1 < dist)
-		{
-			dist = dist1;
-			nextele = i;
-		}
-	}
-
-	return nextele;
+	return field.getNearest(m_msh->ele_vector[EleIndex]->GetGravityCenter());
 }
 
 /**************************************************************************
    MSHLib-Method: GetAverageHetVal2
-   Task:
+   Task: Mean of the z values of the data points in the xy projection of the
+         element (first three nodes), nearest value if there are none
    Programing:
    06/2005 MB Implementation
    01/2006 SB Adapted to new structure
 **************************************************************************/
 double GetAverageHetVal2(long EleIndex,
                          CFEMesh* m_msh,
-                         vector<double> xvals,
-                         vector<double> yvals,
-                         vector<double> zvals,
-                         vector<double> mmpvals)
+                         const HeterogeneousField& field)
 {
-	long i, j, ihet;
-	double average;
 	double xp[3], yp[3];
-	double value;
-	double NumberOfValues;
-	// WW double InvNumberOfValues;
-	CGLPoint* m_point = NULL;
-	MeshLib::CElem* m_ele = NULL;
-	long no_values = (long)xvals.size();
-
-	j = 0;  // only for 1 value
-
-	//-----------------------------------------------------------------------
-	// Get element data
-	m_ele = m_msh->ele_vector[EleIndex];
-	for (j = 0; j < 3; j++)
+	MeshLib::CElem* m_ele = m_msh->ele_vector[EleIndex];
+	for (int j = 0; j < 3; j++)
 	{
 		double const* const pnt(m_ele->GetNode(j)->getData());
 		xp[j] = pnt[0];
 		yp[j] = pnt[1];
-		// zp[j] = 0.0;
 	}
 
 	//-----------------------------------------------------------------------
-	// Find data points in the element
-	NumberOfValues = 0;
-	// WW InvNumberOfValues = 0;
-	m_point = new CGLPoint;
-
-	average = -1;
-	value = 0;
-
-	for (i = 0; i < no_values; i++)
-		if (mmpvals[i] != -999999.0)  // Data point not within an element yet
+	// Find data points in the element. The box is a bit larger than the
+	// triangle, IsInTriangleXYProjection accepts points within a tolerance.
+	const double x_min = *std::min_element(xp, xp + 3);
+	const double x_max = *std::max_element(xp, xp + 3);
+	const double y_min = *std::min_element(yp, yp + 3);
+	const double y_max = *std::max_element(yp, yp + 3);
+	const double margin = 1.e-3 * std::max(x_max - x_min, y_max - y_min);
+	std::vector<long> ids;
+	field.getPointsInXYBox(x_min - margin, x_max + margin, y_min - margin,
+	                       y_max + margin, ids);
+
+	const std::vector<double>& zvals = field.getZ();
+	const std::vector<double>& mmpvals = field.getValues();
+	double value = 0;
+	double NumberOfValues = 0;
+	for (size_t k = 0; k < ids.size(); k++)
+	{
+		const long i = ids[k];
+		if (mmpvals[i] == -999999.0) continue;  // no data
+		CGLPoint point(field.getX()[i], field.getY()[i], 0.0);
+		if (point.IsInTriangleXYProjection(xp, yp))
 		{
-			m_point->x = xvals[i];
-			m_point->y = yvals[i];
-			m_point->z = 0.0;
-
-			//....................................................................
-			// Calculate the product of values in element
-			// CC 10/05
-			if (m_point->IsInTriangleXYProjection(xp, yp))
-			{
-				value = value + zvals[i];
-				NumberOfValues++;
-				mmpvals[i] = -999999.0;  // used as marker
-			}
+			value = value + zvals[i];
+			NumberOfValues++;
 		}
-	// end for
+	}
 	//........................................................................
-	if (NumberOfValues ==
-	    0)  // if no data points in element --> get neares value
+	if (NumberOfValues > 0)  // Calculate arithmetic mean
+		return value / NumberOfValues;
+	// if no data points in element --> get nearest value
+	const long ihet = GetNearestHetVal2(EleIndex, m_msh, field);
+	if (ihet < 0)
 	{
-		ihet = GetNearestHetVal2(EleIndex, m_msh, xvals, yvals, zvals, mmpvals);
-		if (ihet < 0)
-			DisplayMsgLn(" Error getting nearest het_value location");
-		else
-			average = mmpvals[ihet];
+		DisplayMsgLn(" Error getting nearest het_value location");
+		return -1;
 	}
-	//........................................................................
-	else  // if data points in element --> Calculate arithmetic mean
-
-		average = value / NumberOfValues;
-	delete m_point;
-	return average;
+	return mmpvals[ihet];
 }
 
 /**************************************************************************
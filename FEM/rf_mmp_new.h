@@ -29,6 +29,7 @@
 #include "makros.h"  // JT
 
 // PCSLib
+#include "MaterialParameterCache.h"
 #include "fem_ele.h"
 #include "rf_pcs.h"
 
@@ -36,6 +37,11 @@ namespace FiniteElement
 {
 class CFiniteElementStd;
 }
+namespace MathLib
+{
+class MonotoneCubicInterpolation;
+}
+class HeterogeneousField;
 using FiniteElement::CFiniteElementStd;
 class CMediumProperties
 {
@@ -100,6 +106,10 @@ public:
 	void Write(std::fstream*);
 	void WriteTecplot(std::string);
 	double* PermeabilityTensor(long index);
+	// Dependency of element values on the state, see MaterialParameterCache
+	MaterialParameterCache::Dependency PermeabilityDependency() const;
+	MaterialParameterCache::Dependency PorosityDependency() const;
+	MaterialParameterCache::Dependency HeatConductivityDependency() const;
 	// CMCD 9/2004 GeoSys 4
 	double Porosity(FiniteElement::CElement* assem = NULL);
 	// CMCD 9/2004 GeoSys 4
@@ -180,6 +190,17 @@ public:
 	// WW
 	double PermeabilitySaturationFunction(const double wetting_saturation,
 	                                      int phase);
+	// Batch versions, e.g. for all Gauss points of an element
+	void CapillaryPressureFunction(std::size_t n,
+	                               const double* wetting_saturation,
+	                               double* capillary_pressure);
+	void SaturationCapillaryPressureFunction(std::size_t n,
+	                                         const double* capillary_pressure,
+	                                         double* wetting_saturation);
+	void PermeabilitySaturationFunction(std::size_t n,
+	                                    const double* wetting_saturation,
+	                                    int phase, double* kr);
+	void CreateCurveSurrogates();
 	double GetEffectiveSaturationForPerm(const double wetting_saturation,
 	                                     int phase);  // JT
 	// MX 1/2005
@@ -205,11 +226,19 @@ private:
 public:
 	CRFProcess* m_pcs;  // OK
 	std::vector<std::string> pcs_name_vector;
+	const std::vector<std::string>& getPorosityPCSNames() const
+	{
+		return porosity_pcs_name_vector;
+	}
 
 private:
 	std::vector<std::string> porosity_pcs_name_vector;
 	CFEMesh* _mesh;  // OK
 
+	int SetDistributedELEPropertiesBinary(const std::string& file_name,
+	                                      size_t mmp_id);
+	void SetDistributedVolumeFractions(const std::string& mmp_property_name);
+
 	/**
 	 * attribute describes the type of the geometric entity the
 	 * material property is assigned to
@@ -288,6 +317,12 @@ public:
 	double permeability_porosity_model_values[10];
 	double storativity;
 	double capillary_pressure_values[5];  // JT2012
+	// Spline surrogates of the capillary pressure and relative permeability
+	// functions ($CURVE_SURROGATE), NULL: exact function
+	double curve_surrogate_tolerance;
+	MathLib::MonotoneCubicInterpolation* capillary_pressure_surrogate;
+	MathLib::MonotoneCubicInterpolation* saturation_surrogate;
+	MathLib::MonotoneCubicInterpolation* rel_perm_surrogate[MAX_FLUID_PHASES];
 	double heat_capacity;                 // thermal properties
 	int mass_dispersion_model;
 	double mass_dispersion_longitudinal;
@@ -358,16 +393,10 @@ extern void MMP2PCSRelation(CRFProcess*);
 extern void GetHeterogeneousFields();  // SB
 extern long GetNearestHetVal2(long EleIndex,
                               CFEMesh* m_msh,
-                              std::vector<double> xvals,
-                              std::vector<double> yvals,
-                              std::vector<double> zvals,
-                              std::vector<double> mmpvals);
+                              const HeterogeneousField& field);
 double GetAverageHetVal2(long EleIndex,
                          CFEMesh* m_msh,
-                         std::vector<double> xvals,
-                         std::vector<double> yvals,
-                         std::vector<double> zvals,
-                         std::vector<double> mmpvals);
+                         const HeterogeneousField& field);
 extern bool MMPExist(std::ifstream* mmp_file);  // OK
 extern bool MMPExist();                         // OK
 
@@ -25,6 +25,7 @@
 #include "mathlib.h"
 
 #include "rf_pcs.h"
+#include "SolutionPredictor.h"
 #include "tools.h"
 
 using namespace std;
@@ -53,6 +54,8 @@ CNumerics::CNumerics(string const& name)
 	ls_precond = 1;
 	ls_storage_method = 2;
 	ls_extra_arg = "";
+	ls_rcm_ordering = false;
+	ls_check_residual = false;
 #ifdef USE_PETSC
 	petsc_split_fields = false;
 	petsc_use_snes = false;
@@ -68,6 +71,14 @@ CNumerics::CNumerics(string const& name)
 		nls_error_tolerance[i] = -1.0;  // JT2012: should not default this.
 	                                    // Should always be entered by user!
 	nls_jacobian_level = 0;             // full
+	nls_jacobian_reuse = 0;
+	nls_forcing_ew = false;
+	nls_forcing_max = 0.9;
+	nls_forcing_gamma = 0.9;
+	nls_forcing_alpha = 2.0;
+	nls_line_search = 0;
+	nls_line_search_c = 1e-4;
+	nls_initial_guess = SolutionPredictor::PREVIOUS;
 	//
 	// CPL - Coupled processes
 	cpl_error_specified = false;
@@ -93,6 +104,7 @@ CNumerics::CNumerics(string const& name)
 	fct_method = -1;
 	fct_prelimiter_type = 0;
 	fct_const_alpha = -1.0;
+	gp_velocity_from_assembly = false;
 	//
 	_pcs_cpl_error_method = FiniteElement::LMAX;
 	_pcs_nls_error_method = FiniteElement::LMAX;
@@ -387,6 +399,65 @@ ios::pos_type CNumerics::Read(ifstream* num_file)
 			continue;
 		}
 		//....................................................................
+		// Newton strategies, see CRFProcessTH::Execute()
+		if (line_string.find("$NEWTON_JACOBIAN_REUSE") != string::npos)
+		{
+			line.str(GetLineFromFile1(num_file));
+			line >> nls_jacobian_reuse;
+			ScreenMessage("-> $NEWTON_JACOBIAN_REUSE = %d\n",
+			              nls_jacobian_reuse);
+			line.clear();
+			continue;
+		}
+		if (line_string.find("$NEWTON_FORCING") != string::npos)
+		{
+			line.str(GetLineFromFile1(num_file));
+			line >> nls_forcing_max;
+			if (!(line >> nls_forcing_gamma >> nls_forcing_alpha))
+			{
+				nls_forcing_gamma = 0.9;
+				nls_forcing_alpha = 2.0;
+			}
+			nls_forcing_ew = true;
+			ScreenMessage(
+			    "-> Eisenstat-Walker forcing: eta_max=%g, gamma=%g, "
+			    "alpha=%g\n",
+			    nls_forcing_max, nls_forcing_gamma, nls_forcing_alpha);
+			line.clear();
+			continue;
+		}
+		if (line_string.find("$NEWTON_LINE_SEARCH") != string::npos)
+		{
+			line.str(GetLineFromFile1(num_file));
+			line >> nls_line_search;
+			if (!(line >> nls_line_search_c))
+				nls_line_search_c = 1e-4;
+			ScreenMessage("-> $NEWTON_LINE_SEARCH = %d, c=%g\n",
+			              nls_line_search, nls_line_search_c);
+			line.clear();
+			continue;
+		}
+		if (line_string.find("$INITIAL_GUESS") != string::npos)
+		{
+			std::string str_buf;
+			line.str(GetLineFromFile1(num_file));
+			line >> str_buf;
+			if (str_buf == "PREVIOUS")
+				nls_initial_guess = SolutionPredictor::PREVIOUS;
+			else if (str_buf == "LINEAR")
+				nls_initial_guess = SolutionPredictor::LINEAR;
+			else if (str_buf == "QUADRATIC")
+				nls_initial_guess = SolutionPredictor::QUADRATIC;
+			else
+			{
+				nls_initial_guess = SolutionPredictor::PREVIOUS;
+				str_buf = "PREVIOUS (unknown: " + str_buf + ")";
+			}
+			ScreenMessage("-> $INITIAL_GUESS = %s\n", str_buf.c_str());
+			line.clear();
+			continue;
+		}
+		//....................................................................
 		// subkeyword found
 		if (line_string.find("$LINEAR_SOLVER") != string::npos)
 		{
@@ -437,6 +508,26 @@ ios::pos_type CNumerics::Read(ifstream* num_file)
 		}
 		//....................................................................
 		// subkeyword found
+		if (line_string.find("$EQUATION_ORDERING") != string::npos)
+		{
+			std::string ordering;
+			line.str(GetLineFromFile1(num_file));
+			line >> ordering;
+			ls_rcm_ordering = (ordering == "RCM");
+			if (!ls_rcm_ordering && ordering != "NONE")
+				ScreenMessage("-> Unknown $EQUATION_ORDERING %s, nodes are "
+				              "not renumbered\n",
+				              ordering.c_str());
+			line.clear();
+			continue;
+		}
+		if (line_string.find("$CHECK_LINEAR_RESIDUAL") != string::npos)
+		{
+			ls_check_residual = true;
+			continue;
+		}
+		//....................................................................
+		// subkeyword found
 		if (line_string.find("$TIME_THETA") != string::npos)
 		{
 			line.str(GetLineFromFile1(num_file));
@@ -612,6 +703,17 @@ ios::pos_type CNumerics::Read(ifstream* num_file)
 			ScreenMessage("-> FEM_FCT method is selected.");
 			continue;
 		}
+		// subkeyword found
+		if (line_string.find("$GP_VELOCITY_FROM_ASSEMBLY") != string::npos)
+		{
+			line.str(GetLineFromFile1(num_file));
+			line >> gp_velocity_from_assembly;
+			line.clear();
+			if (gp_velocity_from_assembly)
+				ScreenMessage(
+				    "-> Gauss point velocities are taken from the assembly.\n");
+			continue;
+		}
 #ifdef USE_PETSC
 		if (line_string.find("$PETSC_SPLIT_FIELDS") != string::npos)
 		{
@@ -705,6 +807,12 @@ void CNumerics::Write(fstream* num_file)
 	*num_file << " " << ls_precond;
 	*num_file << " " << ls_storage_method;
 	*num_file << endl;
+	if (ls_rcm_ordering)
+	{
+		*num_file << " $EQUATION_ORDERING" << endl;
+		*num_file << "  RCM" << endl;
+	}
+	if (ls_check_residual) *num_file << " $CHECK_LINEAR_RESIDUAL" << endl;
 	//--------------------------------------------------------------------
 	*num_file << " $ELE_GAUSS_POINTS" << endl;
 	*num_file << "  " << ele_gauss_points;
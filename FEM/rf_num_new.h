@@ -68,8 +68,12 @@ public:
 	double ls_error_tolerance;
 	double ls_theta;
 	int ls_precond;
-	int ls_storage_method;
+	int ls_storage_method;  // 2: CRS, 3: block CRS for DOF > 1
 	std::string ls_extra_arg;
+	// Reverse Cuthill-McKee numbering of the equations ($EQUATION_ORDERING)
+	bool ls_rcm_ordering;
+	// Report the true residual of each linear solve ($CHECK_LINEAR_RESIDUAL)
+	bool ls_check_residual;
 #ifdef USE_PETSC
 	bool petsc_split_fields;
 	bool petsc_use_snes;
@@ -85,6 +89,16 @@ public:
 	double nls_error_tolerance[DOF_NUMBER_MAX];
 	double nls_plasticity_local_tolerance;
 	int nls_jacobian_level;
+	// Newton strategies of the monolithic TH process
+	int nls_jacobian_reuse;     // iterations a Jacobian is reused
+	bool nls_forcing_ew;        // Eisenstat-Walker linear tolerance
+	double nls_forcing_max;
+	double nls_forcing_gamma;
+	double nls_forcing_alpha;
+	int nls_line_search;        // max. number of step halvings
+	double nls_line_search_c;   // sufficient decrease parameter
+	// Initial guess of a time step, see SolutionPredictor::Order
+	int nls_initial_guess;
 
 	// CPL
 	std::string cpl_variable;
@@ -115,6 +129,10 @@ public:
 	int fct_method;
 	unsigned int fct_prelimiter_type;
 	double fct_const_alpha;
+
+	// Take Gauss point velocities from the residual assembly of the
+	// converged iteration instead of a separate velocity pass
+	bool gp_velocity_from_assembly;
 };
 
 extern std::vector<CNumerics*> num_vector;
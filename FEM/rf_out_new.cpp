@@ -450,6 +450,16 @@ void OUTDelete()
 	out_vector.clear();
 }
 
+/**************************************************************************
+   FEMLib-Method:
+   Task: Write the buffered time series of all outputs
+**************************************************************************/
+void OUTFlush()
+{
+	for (size_t i = 0; i < out_vector.size(); i++)
+		out_vector[i]->flushTimeSeries();
+}
+
 /**************************************************************************
    FEMLib-Method:
    Task:
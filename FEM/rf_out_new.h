@@ -35,6 +35,7 @@ bool OUTRead(const std::string& file_base_name,
 extern void OUTWrite(std::string);
 extern void OUTData(double, const int step, bool force_output);
 extern void OUTDelete();
+extern void OUTFlush();
 extern COutput* OUTGet(const std::string&);
 extern void OUTCheck(void);                      // new SB
 extern COutput* OUTGetRWPT(const std::string&);  // JT
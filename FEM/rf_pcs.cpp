@@ -53,6 +53,9 @@
 #include "FEMEnums.h"
 #include "fem_ele_std.h"
 #include "ElementValue.h"
+#include "MaterialParameterCache.h"
+#include "ProcessSnapshot.h"
+#include "SolutionPredictor.h"
 #include "files0.h"
 #include "msh_tools.h"
 #include "Output.h"
@@ -292,6 +295,10 @@ CRFProcess::CRFProcess(void)
 	e_n = 1.0;
 	e_pre = 1.0;
 	e_pre2 = 1.0;
+
+	material_cache = NULL;
+	step_snapshot = NULL;
+	solution_predictor = NULL;
 }
 
 void CRFProcess::setProblemObjectPointer(Problem* problem)
@@ -319,6 +326,9 @@ CRFProcess::~CRFProcess(void)
 	// Finite element
 	if (fem) delete fem;  // WW
 	fem = NULL;
+	delete material_cache;
+	delete step_snapshot;
+	delete solution_predictor;
 	//----------------------------------------------------------------------
 	// ELE: Element matrices
 	ElementMatrix* eleMatrix = NULL;
@@ -344,6 +354,9 @@ CRFProcess::~CRFProcess(void)
 			gp_ele = NULL;
 		}
 		ele_gp_value.clear();
+		for (size_t j = 0; j < ele_gp_value_pool.size(); j++)
+			delete ele_gp_value_pool[j];
+		ele_gp_value_pool.clear();
 	}
 	//----------------------------------------------------------------------
 	// OUT: Matrix output
@@ -434,9 +447,12 @@ CRFProcess::~CRFProcess(void)
 **************************************************************************/
 void CRFProcess::AllocateMemGPoint()
 {
+	GaussPointValuePool* pool =
+	    new GaussPointValuePool(this, m_msh->ele_vector);
+	ele_gp_value_pool.push_back(pool);
 	const size_t mesh_ele_vector_size(m_msh->ele_vector.size());
 	for (size_t i = 0; i < mesh_ele_vector_size; i++)
-		ele_gp_value.push_back(new ElementValue(this, m_msh->ele_vector[i]));
+		ele_gp_value.push_back(new ElementValue(this, *pool, i));
 }
 
 /**************************************************************************
@@ -590,10 +606,11 @@ void CRFProcess::Create()
 		long gl_size = m_msh->getNumNodesGlobal();
 		this->FCT_K = new SparseMatrixDOK(gl_size, gl_size);
 		this->FCT_d = new SparseMatrixDOK(gl_size, gl_size);
+		this->FCT_AFlux = new SparseMatrixDOK(gl_size, gl_size);
 #else
 		long gl_size = m_msh->GetNodesNumber(false);
+		// FCT_AFlux is created on the pattern of eqs_new below
 #endif
-		this->FCT_AFlux = new SparseMatrixDOK(gl_size, gl_size);
 		this->Gl_ML = new Math_Group::Vector(gl_size);
 		this->Gl_Vec = new Math_Group::Vector(gl_size);
 		this->Gl_Vec1 = new Math_Group::Vector(gl_size);
@@ -627,6 +644,18 @@ void CRFProcess::Create()
 			eqs_new = EQS_Vector[eqs_num * k];
 		}
 	}  // WW 02.2013. Pardiso
+	if (m_num->fct_method > 0)  // FEM-FCT fluxes on the global pattern
+	{
+		if (eqs_new->getA()->Dof() != 1 || eqs_new->getSparseTable().symmetry)
+		{
+			ScreenMessage(
+			    "Error in CRFProcess::Create() - FEM-FCT requires a single "
+			    "DOF equation system with unsymmetric storage\n");
+			exit(1);
+		}
+		FCT_AFlux = new CSparseMatrix(eqs_new->getSparseTable(), 1);
+		FCT_AFlux->GetTransposeIndex(FCT_transpose);
+	}
 #endif  // If NEW_EQS
 	// Set solver properties: EQS<->SOL
 	// Internen Speicher allokieren
@@ -1057,16 +1086,16 @@ std::string CRFProcess::GetSolutionFileName(bool write)
 
 /**************************************************************************
    FEMLib-Method:
-   Task: Write the solution
+   Task: Write the solution. Returns true if the file was written.
    Programing:
    04/2006 WW
    last modified:
 **************************************************************************/
-void CRFProcess::WriteSolution()
+bool CRFProcess::WriteSolution()
 {
-	if (reload == 2 || reload <= 0) return;
+	if (reload == 2 || reload <= 0) return false;
 	// kg44 write out only between nwrite_restart timesteps
-	if ((aktueller_zeitschritt % nwrite_restart) > 0) return;
+	if ((aktueller_zeitschritt % nwrite_restart) > 0) return false;
 
 	std::string m_file_name = GetSolutionFileName(true);
 	std::ofstream os(m_file_name.c_str(), ios::trunc | ios::out);
@@ -1096,6 +1125,7 @@ void CRFProcess::WriteSolution()
 	os.close();
 	ScreenMessage("Write solutions for timestep %d into file %s\n",
 	              aktueller_zeitschritt, m_file_name.c_str());
+	return true;
 }
 
 /**************************************************************************
@@ -3331,29 +3361,7 @@ void CRFProcess::CheckMarkedElement()
 			elem->MarkingAll(true);
 	}
 
-	for (auto node : m_msh->nod_vector)
-		node->getConnectedElementIDs().clear();
-
-	for (size_t l = 0; l < m_msh->ele_vector.size(); l++)
-	{
-		CElem* elem = m_msh->ele_vector[l];
-		if (!elem->GetMark()) continue;
-		for (size_t i = 0; i < elem->GetNodesNumber(m_msh->getOrder()); i++)
-		{
-			bool done = false;
-			auto node = elem->GetNode(i);
-			for (size_t j = 0; j < node->getConnectedElementIDs().size(); j++)
-			{
-				if (l == node->getConnectedElementIDs()[j])
-				{
-					done = true;
-					break;
-				}
-			}
-			if (!done)
-				node->getConnectedElementIDs().push_back(l);
-		}
-	}
+	m_msh->ConnectedElements2Node(m_msh->getOrder());
 }
 
 /*************************************************************************
@@ -3399,7 +3407,7 @@ double CRFProcess::Execute()
 	{
 		//_new 02/2010. WW
 		eqs_new->SetDOF(pcs_number_of_primary_nvals);
-		eqs_new->ConfigNumerics(m_num->ls_precond, m_num->ls_method, m_num->ls_max_iterations, m_num->ls_error_tolerance, m_num->ls_storage_method, m_num->ls_extra_arg);
+		eqs_new->ConfigNumerics(m_num->ls_precond, m_num->ls_method, m_num->ls_max_iterations, m_num->ls_error_tolerance, m_num->ls_storage_method, m_num->ls_extra_arg, m_num->ls_check_residual);
 	}
 	eqs_new->Initialize();
 #endif
@@ -3425,7 +3433,8 @@ double CRFProcess::Execute()
 		if (!configured_in_nonlinearloop)
 #endif
 			CheckMarkedElement();
-	m_msh->SwitchOnQuadraticNodes(false);
+	// Only written if changed: independent processes may run concurrently
+	if (m_msh->getOrder()) m_msh->SwitchOnQuadraticNodes(false);
 
 	// If not Newton-Raphson method. 20.07.2011. WW
 	if (!FiniteElement::isNewtonKind(m_num->nls_method))
@@ -3456,6 +3465,8 @@ double CRFProcess::Execute()
 	if (myrank == 0)
 #endif
 		cout << "Assembling equation system..." << endl;
+// The material objects are shared by concurrently running processes
+#pragma omp critical(pcs_assembly)
 	GlobalAssembly();
 #ifndef WIN32
 	ScreenMessage("\tcurrent mem: %d MB\n", mem_watch.getVirtMemUsage() / (1024 * 1024));
@@ -3574,6 +3585,7 @@ double CRFProcess::Execute()
 		cpu_time = -clock();
 #endif
 		femFCTmode = true;
+#pragma omp critical(pcs_assembly)
 		GlobalAssembly();
 		femFCTmode = false;
 #if defined(USE_MPI) || defined(USE_PETSC)
@@ -3815,9 +3827,11 @@ void CRFProcess::CopyU_n()
    04/2010 NW Implementation
    last modified:
    05/2013 NW Support PETSc parallelization
+   Sequential: fluxes on the CRS pattern of A, row wise OpenMP loops
  **************************************************************************/
 void CRFProcess::AddFCT_CorrectionVector()
 {
+#ifdef USE_PETSC
 	int idx0 = 0;
 	int idx1 = idx0 + 1;
 	const double theta = this->m_num->ls_theta;
@@ -3827,26 +3841,11 @@ void CRFProcess::AddFCT_CorrectionVector()
 	SparseMatrixDOK::mat_t::const_iterator ii;
 	SparseMatrixDOK::col_t::const_iterator jj;
 	Math_Group::Vector* ML = this->Gl_ML;
-#if defined(NEW_EQS)
-	CSparseMatrix* A = NULL;  // WW
-	A = this->eqs_new->getA();
-#endif
 
-#ifdef USE_PETSC
 	// gather K
 	FCT_MPI::gatherK(FCT_MPI::ct, *FCT_K);
 	// compute D
 	FCT_MPI::computeD(m_msh, *FCT_K, *FCT_d);
-#endif
-
-	// List of Dirichlet nodes
-	std::set<long> list_bc_nodes;
-	for (size_t i = 0; i < bc_node_value.size(); i++)
-	{
-		CBoundaryConditionNode* bc_node = bc_node_value[i];
-		long nod_id = bc_node->geo_node_number;
-		list_bc_nodes.insert(nod_id);
-	}
 
 	//----------------------------------------------------------------------
 	// Construct global matrices: antidiffusive flux(f_ij), positivity matrix(L)
@@ -3887,40 +3886,20 @@ void CRFProcess::AddFCT_CorrectionVector()
 	// constructed.
 	for (size_t i = 0; i < node_size; i++)
 	{
-#ifdef USE_PETSC
 		const size_t i_global = FCT_GLOB_ADDRESS(i);
-#endif
 		col = &fct_f[i];
 		for (jj = col->begin(); jj != col->end(); jj++)
 		{
 			const size_t j = (*jj).first;
-#ifdef USE_PETSC
 			const size_t j_global = FCT_GLOB_ADDRESS(j);
-#endif
 			if (i > j || i == j)
 				continue;  // do below only for upper triangle due to symmetric
 
-// Get artificial diffusion operator D
-#ifdef USE_PETSC
+			// Get artificial diffusion operator D
 			double d1 = (*FCT_d)(i_global, j_global);
-#else
-#if defined(NEW_EQS)
-			double K_ij = (*A)(i, j);
-			double K_ji = (*A)(j, i);
-#else
-			double K_ij = MXGet(i, j);
-			double K_ji = MXGet(j, i);
-#endif
-			if (K_ij == 0.0 && K_ji == 0.0) continue;
-			double d1 = GetFCTADiff(K_ij, K_ji);
-#endif
 			if (d1 == 0.0) continue;
 			double d0 =
 			    d1;  // TODO should use AuxMatrix at the previous time step
-			// if (list_bc_nodes.find(i)!=list_bc_nodes.end() ||
-			// list_bc_nodes.find(j)!=list_bc_nodes.end()) {
-			//  d1 = d0 = 0.0;
-			//}
 
 			// Complete antidiffusive flux: f_ij += -theta*d_ij^H*DeltaU_ij^H -
 			// (1-theta)*d_ij^n*DeltaU_ij^n
@@ -3942,13 +3921,8 @@ void CRFProcess::AddFCT_CorrectionVector()
 			else if (this->m_num->fct_prelimiter_type == 2)
 				v = SuperBee(v, -d1 * diff_uH);
 			(*FCT_AFlux)(i, j) = v;
-#ifdef USE_PETSC
 			(*FCT_AFlux)(j, i) = -v;
-#else
-			(*FCT_AFlux)(j, i) = v;
-#endif
 
-#ifdef USE_PETSC
 			// A += theta * D
 			if (i < (size_t)m_msh->getNumNodesLocal())
 			{
@@ -3960,15 +3934,6 @@ void CRFProcess::AddFCT_CorrectionVector()
 				eqs_new->addMatrixEntry(j_global, i_global, d1 * theta);
 				eqs_new->addMatrixEntry(j_global, j_global, -d1 * theta);
 			}
-#else
-// L = K + D
-#if defined(NEW_EQS)
-			(*A)(i, i) += -d1;
-			(*A)(i, j) += d1;
-			(*A)(j, i) += d1;
-			(*A)(j, j) += -d1;
-#endif
-#endif
 		}
 	}
 
@@ -3979,10 +3944,6 @@ void CRFProcess::AddFCT_CorrectionVector()
 	Math_Group::Vector* V = this->Gl_Vec;
 	(*V1) = 0.0;
 	(*V) = 0.0;
-#ifdef NEW_EQS
-	double* eqs_rhs;
-	eqs_rhs = eqs_new->getRHS();
-#endif
 	// b = [-(1-theta) * L] u^n
 	if (1.0 - theta > .0)
 	{
@@ -3992,67 +3953,25 @@ void CRFProcess::AddFCT_CorrectionVector()
 		// L*u^n
 		for (size_t i = 0; i < node_size; i++)
 		{
-#ifdef USE_PETSC
 			const size_t i_global = FCT_GLOB_ADDRESS(i);
-#endif
 			for (size_t j = 0; j < node_size; j++)
 			{
-#ifdef USE_PETSC
 				const size_t j_global = FCT_GLOB_ADDRESS(j);
 				// b+=-(1-theta)*D*u^n
 				(*V)(i) += (*FCT_d)(i_global, j_global) * (*V1)(j);
-#else
-				(*V)(i) += (*A)(i, j) * (*V1)(j);
-#endif
 			}
 		}
 		for (size_t i = 0; i < node_size; i++)
 		{
-#if defined(USE_PETSC)
 			if (i < (size_t)m_msh->getNumNodesLocal())
 			{
 				const size_t i_global = FCT_GLOB_ADDRESS(i);
 				eqs_new->add_bVectorEntry(i_global, -(1.0 - theta) * (*V)(i),
 				                          ADD_VALUES);
 			}
-#else
-			eqs_rhs[i] -= (1.0 - theta) * (*V)(i);
-//(*RHS)(i+LocalShift) +=  NodalVal[i];
-#endif
 		}
 	}
 
-#ifndef USE_PETSC
-	//----------------------------------------------------------------------
-	// Assemble A matrix: 1/dt*ML + theta * L
-	//----------------------------------------------------------------------
-	// A matrix: theta * L
-	if (theta == 0.0)
-	{
-#ifdef NEW_EQS
-		(*A) = 0.0;
-#endif
-	}
-	else if (theta == 1.0)
-	{
-		// keep
-	}
-	else
-	{
-#ifdef NEW_EQS
-		(*A) *= theta;
-#endif
-	}
-	// A matrix: += 1/dt * ML
-	for (size_t i = 0; i < node_size; i++)
-	{
-		double v = 1.0 / dt * (*ML)(i);
-#ifdef NEW_EQS
-		(*A)(i, i) += v;
-#endif
-	}
-#endif
-
 	//----------------------------------------------------------------------
 	// Assemble RHS: b += alpha * f
 	//----------------------------------------------------------------------
@@ -4074,9 +3993,6 @@ void CRFProcess::AddFCT_CorrectionVector()
 			const size_t j = (*jj).first;
 			if (i == j) continue;
 			double f = (*jj).second;  // double f = (*FCT_AFlux)(i,j);
-#ifndef USE_PETSC
-			if (i > j) f *= -1.0;
-#endif
 			double diff_uH =
 			    this->GetNodeValue(j, idx1) - this->GetNodeValue(i, idx1);
 
@@ -4097,9 +4013,7 @@ void CRFProcess::AddFCT_CorrectionVector()
 			(*R_min)(i_global) = min(1.0, ml * Q_min / (dt * P_min));
 	}
 
-#ifdef USE_PETSC
 	FCT_MPI::gatherR(FCT_MPI::ct, *R_plus, *R_min);
-#endif
 
 	// for Dirichlet nodes
 	for (size_t i = 0; i < bc_node_value.size(); i++)
@@ -4123,9 +4037,6 @@ void CRFProcess::AddFCT_CorrectionVector()
 			if (i == j) continue;
 
 			double f = (*jj).second;  // double f = (*FCT_AFlux)(i,j);
-#ifndef USE_PETSC
-			if (i > j) f *= -1;  // symmetric
-#endif
 			double alpha = 1.0;
 			if (f > 0)
 				alpha = min((*R_plus)(i_global), (*R_min)(j_global));
@@ -4138,17 +4049,197 @@ void CRFProcess::AddFCT_CorrectionVector()
 			else
 				val = this->m_num->fct_const_alpha * f;
 
-#ifdef USE_PETSC
 			if (i < (size_t)m_msh->getNumNodesLocal())
 				eqs_new->add_bVectorEntry(i_global, val, ADD_VALUES);
-#else
-			eqs_rhs[i] += val;
-#endif
 
 			// Note: Galerkin FEM is recovered if alpha = 1 as below,
 			// eqs_rhs[i] += 1.0*f;
 		}
 	}
+#elif defined(NEW_EQS)
+	// The fluxes f_ij live on the sparse pattern of A. Only the upper
+	// triangle (i < j) is evaluated, entry (j, i) is reached through
+	// FCT_transpose and its sign is flipped when it is read. Each loop
+	// writes to its own rows or pairs only and runs in parallel.
+	const int idx0 = 0;
+	const int idx1 = idx0 + 1;
+	const double theta = this->m_num->ls_theta;
+	const long node_size = (long)m_msh->GetNodesNumber(false);
+	CSparseMatrix* A = this->eqs_new->getA();
+	double* K = A->Entries();
+	double* f = FCT_AFlux->Entries();
+	const long* tr = &FCT_transpose[0];
+	double* eqs_rhs = eqs_new->getRHS();
+	Math_Group::Vector& ML = *this->Gl_ML;
+	Math_Group::Vector& u0 = *this->Gl_Vec1;
+	Math_Group::Vector& uH = *this->Gl_Vec;
+	// The rows of A are ordered as the equations
+	for (long i = 0; i < node_size; i++)
+	{
+		const long k = m_msh->Eqs2Global_NodeIndex[i];
+		u0(i) = this->GetNodeValue(k, idx0);
+		uH(i) = this->GetNodeValue(k, idx1);
+	}
+
+	//----------------------------------------------------------------------
+	// Construct global matrices: antidiffusive flux(f_ij), positivity matrix(L)
+	// - f_ij =
+	// 1/dt*m_ij*(DeltaU_ij^H-DeltaU_ij^n)-theta*d_ij^H*DeltaU_ij^H-(1-theta)*d_ij^n*DeltaU_ij^n
+	// - L = K + D
+	// - D_ij = min(0, -K_ij, -K_ji)
+	// * K:original coefficient matrix, D:artificial diffusion operator
+	// Implementation memo:
+	// - K is stored in A matrix in the element assembly.
+	// - the first part of the antidiffusive flux is done in the element
+	// assembly.
+	//   -> f_ij = m_ij
+	//----------------------------------------------------------------------
+	// Artificial diffusion d_ij of each pair, kept at both (i,j) and (j,i)
+	std::vector<double> d(FCT_transpose.size(), 0.0);
+	const int prelimiter = this->m_num->fct_prelimiter_type;
+	const double dt_inv = 1.0 / dt;
+#pragma omp parallel for
+	for (long i = 0; i < node_size; i++)
+	{
+		for (long k = A->RowBegin(i); k < A->RowBegin(i + 1); k++)
+		{
+			const long j = A->Column(k);
+			if (j <= i || tr[k] < 0) continue;
+			const long kt = tr[k];
+			const double diff_uH = uH(i) - uH(j);
+			const double diff_u0 = u0(i) - u0(j);
+			// f_ij*=1/dt*(DeltaU_ij^H-DeltaU_ij^n)
+			// MC is already done in local ele assembly
+			const double v0 = dt_inv * (diff_uH - diff_u0);
+			f[k] *= v0;
+			f[kt] *= -v0;
+
+			const double K_ij = K[k];
+			const double K_ji = K[kt];
+			if (K_ij == 0.0 && K_ji == 0.0) continue;
+			const double d1 = GetFCTADiff(K_ij, K_ji);
+			if (d1 == 0.0) continue;
+			const double d0 =
+			    d1;  // TODO should use AuxMatrix at the previous time step
+			d[k] = d[kt] = d1;
+
+			// Complete antidiffusive flux: f_ij += -theta*d_ij^H*DeltaU_ij^H -
+			// (1-theta)*d_ij^n*DeltaU_ij^n
+			double v =
+			    f[k] - (theta * d1 * diff_uH + (1.0 - theta) * d0 * diff_u0);
+
+			// prelimiting f
+			if (prelimiter == 0)
+			{
+				if (v * (-diff_uH) > 0.0) v = 0.0;
+			}
+			else if (prelimiter == 1)
+				v = MinMod(v, -d1 * diff_uH);
+			else if (prelimiter == 2)
+				v = SuperBee(v, -d1 * diff_uH);
+			f[k] = v;
+			f[kt] = v;
+		}
+	}
+
+	// L = K + D
+#pragma omp parallel for
+	for (long i = 0; i < node_size; i++)
+	{
+		double d_ii = 0.0;
+		for (long k = A->RowBegin(i); k < A->RowBegin(i + 1); k++)
+		{
+			K[k] += d[k];
+			d_ii += d[k];
+		}
+		K[A->DiagonalEntry(i)] -= d_ii;
+	}
+
+	//----------------------------------------------------------------------
+	// Assemble RHS: b_i += [- (1-theta) * L_ij] u_j^n
+	//----------------------------------------------------------------------
+	if (1.0 - theta > .0)
+	{
+#pragma omp parallel for
+		for (long i = 0; i < node_size; i++)
+		{
+			double Lu = 0.0;
+			for (long k = A->RowBegin(i); k < A->RowBegin(i + 1); k++)
+				Lu += K[k] * u0(A->Column(k));
+			eqs_rhs[i] -= (1.0 - theta) * Lu;
+		}
+	}
+
+	//----------------------------------------------------------------------
+	// Assemble A matrix: 1/dt*ML + theta * L
+	//----------------------------------------------------------------------
+	// A matrix: theta * L
+	if (theta == 0.0)
+		(*A) = 0.0;
+	else if (theta != 1.0)
+		(*A) *= theta;
+	// A matrix: += 1/dt * ML
+	for (long i = 0; i < node_size; i++)
+		K[A->DiagonalEntry(i)] += dt_inv * ML(i);
+
+	//----------------------------------------------------------------------
+	// Assemble RHS: b += alpha * f
+	//----------------------------------------------------------------------
+	// Calculate R+, R-. u^n is no longer needed.
+	Math_Group::Vector& R_plus = u0;
+	std::vector<double> R_min(node_size);
+#pragma omp parallel for
+	for (long i = 0; i < node_size; i++)
+	{
+		double P_plus = 0.0, P_min = 0.0;
+		double Q_plus = 0.0, Q_min = 0.0;
+		for (long k = A->RowBegin(i); k < A->RowBegin(i + 1); k++)
+		{
+			const long j = A->Column(k);
+			if (j == i) continue;
+			const double f_ij = (i > j) ? -f[k] : f[k];
+			const double diff_uH = uH(j) - uH(i);
+
+			P_plus += max(0.0, f_ij);
+			P_min += min(0.0, f_ij);
+			Q_plus = max(Q_plus, diff_uH);
+			Q_min = min(Q_min, diff_uH);
+		}
+		const double ml = ML(i);
+		R_plus(i) = (P_plus == 0.0) ? 0.0 : min(1.0, ml * Q_plus / (dt * P_plus));
+		R_min[i] = (P_min == 0.0) ? 0.0 : min(1.0, ml * Q_min / (dt * P_min));
+	}
+
+	// for Dirichlet nodes
+	for (size_t i = 0; i < bc_node_value.size(); i++)
+	{
+		const long nod_id = bc_node_value[i]->geo_node_number;
+		const long eqs_id = m_msh->nod_vector[nod_id]->GetEquationIndex();
+		R_plus(eqs_id) = 1.0;
+		R_min[eqs_id] = 1.0;
+	}
+
+	// b_i += alpha_i * f_ij
+	const double const_alpha = this->m_num->fct_const_alpha;
+#pragma omp parallel for
+	for (long i = 0; i < node_size; i++)
+	{
+		double b_i = 0.0;
+		for (long k = A->RowBegin(i); k < A->RowBegin(i + 1); k++)
+		{
+			const long j = A->Column(k);
+			if (j == i) continue;
+			const double f_ij = (i > j) ? -f[k] : f[k];
+			double alpha = const_alpha;
+			if (const_alpha < 0.0)
+				alpha = (f_ij > 0) ? min(R_plus(i), R_min[j])
+				                   : min(R_plus(j), R_min[i]);
+			// Note: Galerkin FEM is recovered if alpha = 1
+			b_i += alpha * f_ij;
+		}
+		eqs_rhs[i] += b_i;
+	}
+#endif
 }
 
 /*************************************************************************
@@ -5367,19 +5458,6 @@ void CRFProcess::IncorporateSourceTerms()
 	if (type == 4 || type / 10 == 4)
 		fac = Scaling;
 
-	//====================================================================
-	// Look for active boundary elements if constrain is given
-	for (CSourceTerm* st : st_vector)
-	{
-		if (!st->has_constrain) continue;
-
-		CSourceTermGroup m_st_group;
-		m_st_group.pcs_type_name = FiniteElement::convertProcessTypeToString(st->getProcessType());
-		m_st_group.pcs_pv_name = FiniteElement::convertPrimaryVariableToString(st->getProcessPrimaryVariable());
-		int idx = GetNodeValueIndex(m_st_group.pcs_pv_name) / 2;
-		m_st_group.Set(this, Shift[idx]);
-	}
-
 	for (size_t is = 0; is < st_vector.size(); is++)
 	{
 		CSourceTerm* m_st = st_vector[is];
@@ -5388,21 +5466,14 @@ void CRFProcess::IncorporateSourceTerms()
 		std::vector<bool> active_elements;
 
 		// constrain
-		if (m_st->has_constrain && m_st->getSTType() == FiniteElement::NEUMANN)
+		if (m_st->has_constrain &&
+		    m_st->getSTType() == FiniteElement::NEUMANN &&
+		    !vec_st_node_value.empty())
 		{
 			std::cout << "-> update constrained ST " << is << "\n";
-			// get distributed values
-			DistributionData distData;
-			setDistributionData(m_st, distData);
-			std::vector<long> nodes_vector(st_node_value[is].size());
-			for (size_t ii = 0; ii < st_node_value[is].size(); ii++)
-			{
-				nodes_vector[ii] = st_node_value[is][ii]->msh_node_number;
-			}
-			std::vector<double> node_value(nodes_vector.size());
-			setDistribution(distData, *m_msh, nodes_vector, node_value);
-
-			// boundary integration
+			// distributed values, integrated over the active boundary
+			// elements with the operator assembled at the set up
+			std::vector<double> node_value(m_st->distributed_node_values);
 			if (m_st->constrain_var_id < 0)
 				m_st->constrain_var_id =
 				    GetNodeValueIndex(m_st->constrain_var_name) + 1;
@@ -5445,14 +5516,12 @@ void CRFProcess::IncorporateSourceTerms()
 					                           m_st->constrain_operator);
 					if (active_elements[in]) count_active++;
 				}
-				if (m_msh->GetMaxElementDim() == 2 &&
-				    m_st->getGeoType() == GEOLIB::POLYLINE)
-					m_st->EdgeIntegration(m_msh, nodes_vector, node_value,
-					                      &active_elements);
-				else if (m_msh->GetMaxElementDim() == 3 &&
-				         m_st->getGeoType() == GEOLIB::SURFACE)
-					m_st->FaceIntegration(m_msh, nodes_vector, node_value,
-					                      &active_elements);
+				if ((m_msh->GetMaxElementDim() == 2 &&
+				     m_st->getGeoType() == GEOLIB::POLYLINE) ||
+				    (m_msh->GetMaxElementDim() == 3 &&
+				     m_st->getGeoType() == GEOLIB::SURFACE))
+					m_st->boundary_operator.integrate(node_value,
+					                                  &active_elements);
 			}
 
 			// update ST values
@@ -5475,7 +5544,6 @@ void CRFProcess::IncorporateSourceTerms()
 			// only Neumann BC
 			if (m_st->getSTType() != FiniteElement::NEUMANN) continue;
 
-			double mass[100] = {};
 			if (m_st->getGeoType() == GEOLIB::POINT)
 			{
 				if (m_st->has_constrain && !active_elements[0]) continue;
@@ -5491,34 +5559,34 @@ void CRFProcess::IncorporateSourceTerms()
 			else if (m_st->getGeoType() == GEOLIB::SURFACE ||
 			         m_st->getGeoType() == GEOLIB::POLYLINE)
 			{
-				for (size_t in = 0; in < m_st->st_boundary_elements.size();
+				// Face mass matrices times the transfer coefficient
+				const BoundaryIntegrationOperator& bnd_operator =
+				    m_st->boundary_operator;
+				for (size_t in = 0; in < bnd_operator.getNumberOfElements();
 				     in++)
 				{
 					if (m_st->has_constrain && !active_elements[in]) continue;
-					MeshLib::CElem* face = m_st->st_boundary_elements[in];
-					const unsigned nen = face->GetNodesNumber(false);
-					fem->setOrder(m_msh->getOrder() + 1);
-					fem->ConfigElement(face, true);
-					for (unsigned k = 0; k < nen; k++)
-						for (unsigned l = 0; l < nen; l++)
-							mass[k * nen + l] = .0;
-					fem->CalcFaceMass(mass);
-					const double h =
-					    m_st->transfer_h_values[face->GetPatchIndex()];
+					const unsigned nen = bnd_operator.getNumberOfMassNodes(in);
+					const long* nodes = bnd_operator.getNodes(in);
+					const double* mass = bnd_operator.getMassMatrix(in);
 					for (unsigned k = 0; k < nen; k++)
 					{
 						const int k_eqs_id =
-						    face->GetNode(k)->GetEquationIndex();
+						    m_msh->nod_vector[vec_st_node_value[nodes[k]]
+						                          ->geo_node_number]
+						        ->GetEquationIndex();
 						for (unsigned l = 0; l < nen; l++)
 						{
 							const int l_eqs_id =
-							    face->GetNode(l)->GetEquationIndex();
+							    m_msh->nod_vector[vec_st_node_value[nodes[l]]
+							                          ->geo_node_number]
+							        ->GetEquationIndex();
 #if defined(USE_PETSC)
 							eqs_new->addMatrixEntry(k_eqs_id, l_eqs_id,
-							                        mass[k * nen + l] * h);
+							                        mass[k * nen + l]);
 #elif defined(NEW_EQS)
 							(*eqs_new->getA())(k_eqs_id, l_eqs_id) +=
-							    mass[k * nen + l] * h;
+							    mass[k * nen + l];
 #endif
 						}
 					}
@@ -5692,7 +5760,8 @@ void CRFProcess::IncorporateSourceTerms()
 			st_eqs_value.push_back(Water_ST_vec[i].water_st_value);
 
 #else
-			eqs_rhs[gem_node_index] += Water_ST_vec[i].water_st_value;
+			eqs_rhs[m_msh->nod_vector[gem_node_index]->GetEquationIndex()] +=
+			    Water_ST_vec[i].water_st_value;
 #endif
 		}
 		// after finished adding to RHS, clear the vector
@@ -6186,8 +6255,8 @@ double CRFProcess::CalcVelocityChanges()
 	//
 	for (size_t i = 0; i < ele_gp_value.size(); i++)
 	{
-		const Matrix& v0 = ele_gp_value[i]->Velocity0;
-		const Matrix& v1 = ele_gp_value[i]->Velocity;
+		const GaussPointMatrix& v0 = ele_gp_value[i]->Velocity0;
+		const GaussPointMatrix& v1 = ele_gp_value[i]->Velocity;
 		for (unsigned gp = 0; gp < v0.Cols(); gp++)
 		{
 			for (unsigned k = 0; k < v0.Rows(); k++)
@@ -6632,6 +6701,36 @@ double CRFProcess::CalcIterationNODError(FiniteElement::ErrorMethod method,
 }
 //#endif // #if !defined(USE_PETSC)  WW
 
+/**************************************************************************
+   FEMLib-Method:
+   Task: Declare how permeability, porosity and heat conductivity depend on
+         the state of this process and create the element cache. The least
+         favourable dependency of all media is taken.
+**************************************************************************/
+void CRFProcess::DeclareMaterialDependencies()
+{
+	MaterialParameterCache::Dependency permeability =
+	    MaterialParameterCache::STATE_INDEPENDENT;
+	MaterialParameterCache::Dependency porosity = permeability;
+	MaterialParameterCache::Dependency heat_conductivity = permeability;
+	for (size_t i = 0; i < mmp_vector.size(); i++)
+	{
+		permeability =
+		    std::max(permeability, mmp_vector[i]->PermeabilityDependency());
+		porosity = std::max(porosity, mmp_vector[i]->PorosityDependency());
+		heat_conductivity = std::max(
+		    heat_conductivity, mmp_vector[i]->HeatConductivityDependency());
+	}
+
+	delete material_cache;
+	material_cache = new MaterialParameterCache(m_msh->ele_vector.size());
+	material_cache->declare(MaterialParameterCache::PERMEABILITY, permeability,
+	                        9);
+	material_cache->declare(MaterialParameterCache::POROSITY, porosity, 1);
+	material_cache->declare(MaterialParameterCache::HEAT_CONDUCTIVITY,
+	                        heat_conductivity, 9);
+}
+
 /**************************************************************************
    FEMLib-Method:
    Task:
@@ -6673,13 +6772,19 @@ double CRFProcess::ExecuteNonLinear(int loop_process_number, bool print_pcs)
 	double* eqs_b = eqs_new->getRHS();
 	configured_in_nonlinearloop = true;
 	eqs_new->SetDOF(pcs_number_of_primary_nvals);
-	eqs_new->ConfigNumerics(m_num->ls_precond, m_num->ls_method, m_num->ls_max_iterations, m_num->ls_error_tolerance, m_num->ls_storage_method, m_num->ls_extra_arg);
+	eqs_new->ConfigNumerics(m_num->ls_precond, m_num->ls_method, m_num->ls_max_iterations, m_num->ls_error_tolerance, m_num->ls_storage_method, m_num->ls_extra_arg, m_num->ls_check_residual);
 #endif
 	//..................................................................
 	// PI time step size control. 29.08.2008. WW
 	if (Tim->GetPITimeStepCrtlType() > 0) CopyU_n();
 	if (hasAnyProcessDeactivatedSubdomains) this->CheckMarkedElement();  // NW
+	// Tim is shared by the components of mass transport, which may run
+	// concurrently (see ProcessScheduler)
+#pragma omp critical(pcs_time_control)
 	Tim->last_dt_accepted = true;  // JT2012
+	// Values of other processes may have changed since the last call
+	if (!material_cache) DeclareMaterialDependencies();
+	material_cache->refresh();
 
 #if defined(USE_PETSC) || \
     defined(USE_MPI)  // || defined(other parallel libs)//01.3013. WW
@@ -6728,6 +6833,7 @@ double CRFProcess::ExecuteNonLinear(int loop_process_number, bool print_pcs)
 		{
 			ScreenMessage("*** Nonlinear solve failed\n");
 			accepted = false;
+#pragma omp critical(pcs_time_control)
 			Tim->last_dt_accepted = false;
 			break;
 		}
@@ -6945,6 +7051,7 @@ double CRFProcess::ExecuteNonLinear(int loop_process_number, bool print_pcs)
 		if (diverged || !accepted || Tim->isDynamicTimeFailureSuggested(this))
 		{
 			accepted = false;
+#pragma omp critical(pcs_time_control)
 			Tim->last_dt_accepted = false;
 			break;
 		}
@@ -6958,11 +7065,14 @@ double CRFProcess::ExecuteNonLinear(int loop_process_number, bool print_pcs)
 		       this time step is still used, someone will need to find another
 		   way to calculate the error it uses.
 		*/
-		Tim->repeat = true;
-		if (converged)
+#pragma omp critical(pcs_time_control)
 		{
-			Tim->repeat = false;
-			Tim->nonlinear_iteration_error = pcs_absolute_error[0];
+			Tim->repeat = true;
+			if (converged)
+			{
+				Tim->repeat = false;
+				Tim->nonlinear_iteration_error = pcs_absolute_error[0];
+			}
 		}
 
 		// BREAK CRITERIA
@@ -7018,6 +7128,7 @@ double CRFProcess::ExecuteNonLinear(int loop_process_number, bool print_pcs)
 	eqs_new->Clean();
 	configured_in_nonlinearloop = false;
 #endif
+	material_cache->refresh();
 	return nl_itr_err;
 }
 
@@ -7254,8 +7365,10 @@ void CRFProcess::CopyTimestepNODValues(bool forward)
 			nidx0++;
 			nidx1--;
 		}
-		for (size_t l = 0; l < m_msh->GetNodesNumber(Quadr); l++)
-			SetNodeValue(l, nidx0, GetNodeValue(l, nidx1));
+		// Time levels are contiguous arrays
+		std::copy(nod_val_vector[nidx1],
+		          nod_val_vector[nidx1] + m_msh->GetNodesNumber(Quadr),
+		          nod_val_vector[nidx0]);
 		// WW
 		//		if (_pcs_type_name.find("RICHARDS") != string::npos || type ==
 		// 1212) { //Multiphase. WW
@@ -7276,8 +7389,9 @@ void CRFProcess::CopyTimestepNODValues(bool forward)
 				nidx1--;
 			}
 			//
-			for (size_t l = 0; l < m_msh->GetNodesNumber(false); l++)
-				SetNodeValue(l, nidx0, GetNodeValue(l, nidx1));
+			std::copy(nod_val_vector[nidx1],
+			          nod_val_vector[nidx1] + m_msh->GetNodesNumber(false),
+			          nod_val_vector[nidx0]);
 		}
 	}
 }
@@ -8468,67 +8582,39 @@ void CRFProcess::CalcELEFluxes(const GEOLIB::Polyline* const ply,
 **************************************************************************/
 void CRFProcess::CalcELEVelocities(void)
 {
-	int eidx[3];
-
 	// If not FLUID_MOMENTUM,
 	//	if (_pcs_type_name.compare("RANDOM_WALK") != 0) {
 	FiniteElement::ProcessType pcs_type(getProcessType());  // BG
 
-	if (this->getProcessType() != FiniteElement::RANDOM_WALK)
+	// Phase 0: liquid velocity, phase 1: gas velocity (MULTI_PHASE_FLOW)
+	const int n_phases = (pcs_type == FiniteElement::MULTI_PHASE_FLOW) ? 2 : 1;
+	for (int phase = 0; phase < n_phases; phase++)
 	{
-		int eidx[3];
-		eidx[0] = GetElementValueIndex("VELOCITY1_X");
-		eidx[1] = GetElementValueIndex("VELOCITY1_Y");
-		eidx[2] = GetElementValueIndex("VELOCITY1_Z");
-		for (size_t i = 0; i < 3; i++)
-			if (eidx[i] < 0)
-				cout << "Fatal error in CRFProcess::CalcELEVelocities - abort"
-				     << endl;
-		// abort();	// PCH commented abort() out for FM.
+		if (phase == 0 && pcs_type == FiniteElement::RANDOM_WALK) continue;
 
-		FiniteElement::ElementValue* gp_ele = NULL;
-		double vx, vy, vz;
-		const size_t mesh_ele_vector_size(m_msh->ele_vector.size());
-		for (size_t i = 0; i < mesh_ele_vector_size; i++)
+		const std::string vel_name(phase == 0 ? "VELOCITY1_" : "VELOCITY2_");
+		int eidx[3];
+		eidx[0] = GetElementValueIndex(vel_name + "X");
+		eidx[1] = GetElementValueIndex(vel_name + "Y");
+		eidx[2] = GetElementValueIndex(vel_name + "Z");
+		if (eidx[0] < 0 || eidx[1] < 0 || eidx[2] < 0)
 		{
-			gp_ele = ele_gp_value[i];
-			vx = gp_ele->Velocity(0, 0);
-			SetElementValue(i, eidx[0], vx);
-			SetElementValue(i, eidx[0] + 1, vx);
-			vy = gp_ele->Velocity(1, 0);
-			SetElementValue(i, eidx[1], vy);
-			SetElementValue(i, eidx[1] + 1, vy);
-			vz = gp_ele->Velocity(2, 0);
-			SetElementValue(i, eidx[2], vz);
-			SetElementValue(i, eidx[2] + 1, vz);
+			cout << "Fatal error in CRFProcess::CalcELEVelocities - abort"
+			     << endl;
+			// abort();	// PCH commented abort() out for FM.
+			continue;
 		}
-	}
-	if (pcs_type == FiniteElement::MULTI_PHASE_FLOW)
-	{
-		eidx[0] = GetElementValueIndex("VELOCITY2_X");
-		eidx[1] = GetElementValueIndex("VELOCITY2_Y");
-		eidx[2] = GetElementValueIndex("VELOCITY2_Z");
-		for (size_t i = 0; i < 3; i++)
-			if (eidx[i] < 0)
-				cout << "Fatal error in CRFProcess::CalcELEVelocities - abort"
-				     << endl;
-		// abort();	// PCH commented abort() out for FM.
 
-		FiniteElement::ElementValue* gp_ele = NULL;
-		double vx, vy, vz;
+		// Velocity of the first Gauss point is written to both time levels
 		const size_t mesh_ele_vector_size(m_msh->ele_vector.size());
 		for (size_t i = 0; i < mesh_ele_vector_size; i++)
 		{
-			gp_ele = ele_gp_value[i];
-			vx = gp_ele->Velocity_g(0, 0);
-			SetElementValue(i, eidx[0], vx);
-			SetElementValue(i, eidx[0] + 1, vx);
-			vy = gp_ele->Velocity_g(1, 0);
-			SetElementValue(i, eidx[1], vy);
-			SetElementValue(i, eidx[1] + 1, vy);
-			vz = gp_ele->Velocity_g(2, 0);
-			SetElementValue(i, eidx[2], vz);
-			SetElementValue(i, eidx[2] + 1, vz);
+			const GaussPointMatrix& gp_vel =
+			    (phase == 0) ? ele_gp_value[i]->Velocity
+			                 : ele_gp_value[i]->Velocity_g;
+			double* const ele_val = ele_val_vector[i];
+			for (int k = 0; k < 3; k++)
+				ele_val[eidx[k]] = ele_val[eidx[k] + 1] = gp_vel(k, 0);
 		}
 	}
 }
@@ -10002,10 +10088,25 @@ void CreateEQS_LinearSolver()
 		}
 	}
 
+	// Optional bandwidth reducing numbering of the equations. The
+	// deformation processes and quadratic elements keep the node order.
+	bool rcm_ordering = false;
+	for (size_t i = 0; i < num_vector.size(); i++)
+		if (num_vector[i]->ls_rcm_ordering) rcm_ordering = true;
+
 	//
 	for (size_t i = 0; i < fem_msh_vector.size(); i++)
 	{
 		a_msh = fem_msh_vector[i];
+		if (rcm_ordering)
+		{
+			if (dof_DM > 0 ||
+			    a_msh->GetNodesNumber(false) != a_msh->GetNodesNumber(true))
+				ScreenMessage("-> Equations of meshes with deformation or "
+				              "quadratic elements are not renumbered\n");
+			else
+				a_msh->RenumberEquations();
+		}
 		SparseTable* sp = nullptr, *spH = nullptr;
 		CreateSparseTable(a_msh, sp, spH);
 		if (sp)
@@ -10349,7 +10450,7 @@ void CRFProcess::EQSSolver(double* x)
 
 	// OK411
 	for (int i = 0; i < (int)m_msh->nod_vector.size(); ++i)
-		x[i] = eqs_new->X(i);
+		x[i] = eqs_new->X(m_msh->nod_vector[i]->GetEquationIndex());
 }
 #endif
 #endif
@@ -10381,8 +10482,9 @@ void CRFProcess::IncorporateSourceTerms_GEMS(void)
 // Adding the rate of concentration change to the right hand side of the
 // equation.
 #ifdef NEW_EQS  // 15.12.2008. WW
-			eqs_new->getRHS()[it] -= m_vec_GEM->m_xDC_Chem_delta[it * nDC + i] /
-			                  Tim->time_step_length;
+			eqs_new->getRHS()[m_msh->nod_vector[it]->GetEquationIndex()] -=
+			    m_vec_GEM->m_xDC_Chem_delta[it * nDC + i] /
+			    Tim->time_step_length;
 #elif defined(USE_PETSC)
 // eqs_new->getRHS()[it] -= m_vec_GEM->m_xDC_Chem_delta[it * nDC + i] /
 // Tim->time_step_length;
@@ -69,6 +69,7 @@ class CFEMesh;
 namespace Math_Group
 {
 class Linear_EQS;
+class CSparseMatrix;
 }
 #endif
 
@@ -77,6 +78,9 @@ class CSourceTerm;
 class CNodeValue;
 class Problem;
 class CPlaneEquation;
+class MaterialParameterCache;
+class ProcessSnapshot;
+class SolutionPredictor;
 
 using namespace FiniteElement;
 using namespace Math_Group;
@@ -129,10 +133,15 @@ protected:
 	Math_Group::Vector* Gl_Vec;
 	Math_Group::Vector* Gl_Vec1;
 	Math_Group::Vector* Gl_ML;
-	Math_Group::SparseMatrixDOK* FCT_AFlux;
 #ifdef USE_PETSC
+	Math_Group::SparseMatrixDOK* FCT_AFlux;
 	Math_Group::SparseMatrixDOK* FCT_K;
 	Math_Group::SparseMatrixDOK* FCT_d;
+#else
+	// Antidiffusive fluxes f_ij, stored on the sparse pattern of eqs_new
+	Math_Group::CSparseMatrix* FCT_AFlux;
+	// Position of entry (j, i) for each entry (i, j) of that pattern
+	std::vector<long> FCT_transpose;
 #endif
 	/**
 	 * Storage type for all element matrices and vectors
@@ -287,7 +296,7 @@ public:
 	//....................................................................
 	// 11-OUT
 	std::string GetSolutionFileName(bool write);
-	void WriteSolution();  // WW
+	bool WriteSolution();  // WW
 	void ReadSolution();   // WW
 	//....................................................................
 	// 12-NUM
@@ -550,6 +559,14 @@ public:
 	void ConfigureCouplingForLocalAssemblier();
 	void CalIntegrationPointValue();
 	bool cal_integration_point_value;         // WW
+	/// Element values of material parameters which do not change during
+	/// the nonlinear iterations of this process
+	MaterialParameterCache* material_cache;
+	void DeclareMaterialDependencies();
+	/// State at the beginning of the time step, restored if it is rejected
+	ProcessSnapshot* step_snapshot;
+	/// Initial guess of the time step from the previous solutions
+	SolutionPredictor* solution_predictor;
 	void CalGPVelocitiesfromFluidMomentum();  // SB 4900
 	bool use_velocities_for_transport;        // SB4900
 
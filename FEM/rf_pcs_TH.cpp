@@ -23,6 +23,7 @@
 #include "PETSC/PETScLinearSolver.h"
 #endif
 
+#include "MaterialParameterCache.h"
 #include "fem_ele_std.h"
 
 void CRFProcessTH::Initialization()
@@ -66,10 +67,13 @@ double CRFProcessTH::Execute(int loop_process_number)
 	ScreenMessage("================================================\n");
 
 	clock_t dm_time = -clock();
+	gp_velocity_from_residual = false;
 
 	m_msh->SwitchOnQuadraticNodes(false);
 	if (hasAnyProcessDeactivatedSubdomains || Deactivated_SubDomain.size() > 0)
 		CheckMarkedElement();
+	if (!material_cache) DeclareMaterialDependencies();
+	material_cache->refresh();
 
 #if defined(USE_PETSC)
 	// set Dirichlet BC to nodal values
@@ -92,11 +96,13 @@ double CRFProcessTH::Execute(int loop_process_number)
 #if defined(NEW_EQS)
 	eqs_new->ConfigNumerics(m_num->ls_precond, m_num->ls_method,
 							m_num->ls_max_iterations, m_num->ls_error_tolerance,
-							m_num->ls_storage_method, m_num->ls_extra_arg);
+							m_num->ls_storage_method, m_num->ls_extra_arg,
+							m_num->ls_check_residual);
 #endif
 
 	// Begin Newton-Raphson steps
 	double Error = 1.0;
+	double Error_prev = -1.0;
 	double NormDx = std::numeric_limits<double>::max();
 #ifdef USE_PETSC
 	static double rp0 = .0, rT0 = 0;
@@ -115,6 +121,15 @@ double CRFProcessTH::Execute(int loop_process_number)
 
 	const double newton_tol = m_num->nls_error_tolerance[0];
 	const int n_max_iterations = m_num->nls_max_iterations;
+#if defined(NEW_EQS)
+	// Newton strategies: Jacobian reuse within a time step, Eisenstat-Walker
+	// linear tolerance and backtracking line search on |r|
+	int jacobian_age = -1;  // iterations since the stored Jacobian was built
+	double eta = m_num->nls_forcing_max;
+	double NormR_prev = -1.0;
+	bool has_residual = false;  // residual of the new iterate from line search
+	bool has_jacobian = false;  // ... assembled together with its Jacobian
+#endif
 
 	iter_nlin = 0;
 	bool converged = false;
@@ -122,14 +137,38 @@ double CRFProcessTH::Execute(int loop_process_number)
 	{
 		iter_nlin++;
 
-		// Refresh solver
-		eqs_new->Initialize();
-
-		// -----------------------------------------------------------------
-		// Evaluate residuals
-		// -----------------------------------------------------------------
-		ScreenMessage("Assembling a residual vector...\n");
-		AssembleResidual();
+#if defined(NEW_EQS)
+		const bool reuseJacobian = (jacobian_age >= 0 &&
+		                            jacobian_age < m_num->nls_jacobian_reuse);
+#else
+		const bool reuseJacobian = false;
+		const bool has_residual = false;
+		const bool has_jacobian = false;
+#endif
+		// The Jacobian is assembled in the same element pass as the residual
+		// unless the residual reduction of the previous iterations predicts
+		// that this iteration converges and only the residual is needed.
+		// After a line search, the accepted trial assembly decides.
+		const bool withJacobian =
+		    has_residual ? has_jacobian
+		                 : !reuseJacobian &&
+		                       !(iter_nlin > 2 && Error_prev > 0.0 &&
+		                         Error * Error / Error_prev < newton_tol);
+
+		if (!has_residual)
+		{
+			// Refresh solver
+			eqs_new->Initialize();
+
+			// -------------------------------------------------------------
+			// Evaluate residuals
+			// -------------------------------------------------------------
+			if (withJacobian)
+				ScreenMessage("Assembling a residual vector and a Jacobian matrix...\n");
+			else
+				ScreenMessage("Assembling a residual vector...\n");
+			AssembleResidual(withJacobian);
+		}
 
 //
 #if defined(NEW_EQS)
@@ -165,6 +204,7 @@ double CRFProcessTH::Execute(int loop_process_number)
 
 		if (nl_r0 == 0.0)
 			nl_r0 = NormR;
+		Error_prev = Error;
 		Error = NormR / nl_r0;
 
 #ifdef USE_PETSC
@@ -224,14 +264,57 @@ double CRFProcessTH::Execute(int loop_process_number)
 		{
 			ScreenMessage("-> Newton-Raphson converged\n");
 			converged = true;
+			gp_velocity_from_residual = m_num->gp_velocity_from_assembly;
 			break;
 		}
 
 		// -----------------------------------------------------------------
 		// Assemble Jacobian and solve linear eqs
 		// -----------------------------------------------------------------
-		ScreenMessage("Assembling a Jacobian matrix...\n");
-		AssembleJacobian();
+#if defined(NEW_EQS)
+		if (reuseJacobian)
+		{
+			ScreenMessage("-> reuse the Jacobian matrix (%d/%d)\n",
+			              jacobian_age + 1, m_num->nls_jacobian_reuse);
+			eqs_new->RestoreMatrix();
+			jacobian_age++;
+		}
+		else
+#endif
+		{
+			if (!withJacobian)
+				ScreenMessage("Assembling a Jacobian matrix...\n");
+			AssembleJacobian(!withJacobian);
+#if defined(NEW_EQS)
+			if (m_num->nls_jacobian_reuse > 0)
+			{
+				eqs_new->StoreMatrix();
+				jacobian_age = 0;
+			}
+#endif
+		}
+
+#if defined(NEW_EQS)
+		if (m_num->nls_forcing_ew)
+		{
+			// eta_k = gamma*(|r_k|/|r_k-1|)^alpha with the safeguard of
+			// Eisenstat and Walker (1996) against too small tolerances
+			if (NormR_prev > 0.0)
+			{
+				const double eta_safe =
+				    m_num->nls_forcing_gamma *
+				    std::pow(eta, m_num->nls_forcing_alpha);
+				eta = m_num->nls_forcing_gamma *
+				      std::pow(NormR / NormR_prev, m_num->nls_forcing_alpha);
+				if (eta_safe > 0.1) eta = std::max(eta, eta_safe);
+				eta = std::min(eta, m_num->nls_forcing_max);
+			}
+			eta = std::max(eta, m_num->ls_error_tolerance);
+			eqs_new->SetTolerance(eta);
+			ScreenMessage("-> linear solver tolerance %.3e\n", eta);
+		}
+		NormR_prev = NormR;
+#endif
 
 		ScreenMessage("-> Calling linear solver...\n");
 		bool compress_eqs = (this->Deactivated_SubDomain.size() > 0 || deactivateMatrixFlow);
@@ -342,6 +425,37 @@ double CRFProcessTH::Execute(int loop_process_number)
 
 		// x^k1 = x^k + dx
 		UpdateIterativeStep(1.0);
+
+#if defined(NEW_EQS)
+		// Backtracking: halve the step until |r(x^k1)| <= (1-c*damp)|r(x^k)|.
+		// The last trial residual is kept for the next iteration. The full
+		// step is assembled together with the Jacobian of the next iteration
+		// unless that one reuses the stored matrix; backtracked trials only
+		// need the residual.
+		has_residual = false;
+		if (m_num->nls_line_search > 0)
+		{
+			const bool trialJacobian =
+			    !(jacobian_age >= 0 &&
+			      jacobian_age < m_num->nls_jacobian_reuse);
+			double damp = 1.0;
+			for (int ls = 0;; ls++)
+			{
+				eqs_new->Initialize();
+				has_jacobian = (ls == 0 && trialJacobian);
+				AssembleResidual(has_jacobian);
+				const double NormR_trial = eqs_new->ComputeNormRHS();
+				if (NormR_trial <= (1.0 - m_num->nls_line_search_c * damp) * NormR ||
+				    ls == m_num->nls_line_search)
+					break;
+				ScreenMessage("-> line search: |r|=%.3e, step length %g\n",
+				              NormR_trial, 0.5 * damp);
+				UpdateIterativeStep(-0.5 * damp);
+				damp *= 0.5;
+			}
+			has_residual = true;
+		}
+#endif
 	}  // Newton-Raphson iteration
 
 	iter_nlin_max = std::max(iter_nlin_max, iter_nlin);
@@ -392,6 +506,7 @@ double CRFProcessTH::Execute(int loop_process_number)
 		Tim->last_dt_accepted = false;
 	}
 
+	material_cache->refresh();
 	return Error;
 }
 
@@ -443,7 +558,8 @@ void CRFProcessTH::UpdateIterativeStep(const double damp)
 				                      pcs_number_of_primary_nvals +
 				                  i];
 #else
-				double dx = eqs_x[j + number_of_nodes * i];
+				double dx = eqs_x[m_msh->nod_vector[j]->GetEquationIndex() +
+				                  number_of_nodes * i];
 #endif
 				double x1 = GetNodeValue(j, p_var_index[i]) + dx * damp * inv_scaling;
 				SetNodeValue(j, p_var_index[i], x1);
@@ -454,7 +570,7 @@ void CRFProcessTH::UpdateIterativeStep(const double damp)
 #endif
 }
 
-void CRFProcessTH::AssembleResidual()
+void CRFProcessTH::AssembleResidual(bool withJacobian)
 {
 	ScreenMessage("-> set Dirichlet BC to nodal values\n");
 	IncorporateBoundaryConditions(false, false, false, true);
@@ -474,7 +590,7 @@ void CRFProcessTH::AssembleResidual()
 
 		elem->SetOrder(false);
 		fem->ConfigElement(elem);
-		fem->Assembly(false, true);
+		fem->Assembly(withJacobian, true);
 	}
 	if (print_progress)
 		ScreenMessage("done\n");
@@ -520,15 +636,15 @@ void CRFProcessTH::AssembleResidual()
 
 }
 
-void CRFProcessTH::AssembleJacobian()
+void CRFProcessTH::AssembleJacobian(bool assembleElements)
 {
 	const size_t dn = m_msh->ele_vector.size() / 10;
-	const bool print_progress = (dn >= 100);
+	const bool print_progress = assembleElements && (dn >= 100);
 	if (print_progress)
 		ScreenMessage("start local assembly for %d elements...\n",
 					  m_msh->ele_vector.size());
 
-	for (long i = 0; i < (long)m_msh->ele_vector.size(); i++)
+	for (long i = 0; assembleElements && i < (long)m_msh->ele_vector.size(); i++)
 	{
 		if (print_progress && (i + 1) % dn == 0) ScreenMessage("* ");
 		MeshLib::CElem* elem = m_msh->ele_vector[i];
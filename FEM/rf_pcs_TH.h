@@ -27,6 +27,12 @@ public:
 
 	void Initialization();
 	virtual double Execute(int loop_process_number);
+	/// True if the Gauss point velocities were stored by the residual
+	/// assembly of the converged Newton iteration
+	bool hasConvergedGaussPointVelocity() const
+	{
+		return gp_velocity_from_residual;
+	}
 #ifdef USE_PETSC
 	virtual void setSolver(petsc_group::PETScLinearSolver* petsc_solver);
 	void copyVecToNodalValues(Vec x);
@@ -34,8 +40,12 @@ public:
 #endif
 
 protected:
-	void AssembleResidual();
-	void AssembleJacobian();
+	/// Assemble the residual vector, optionally together with the element
+	/// contributions to the Jacobian matrix in the same element pass
+	void AssembleResidual(bool withJacobian = false);
+	/// Assemble the Jacobian matrix and apply the Dirichlet BCs to it. The
+	/// element loop is skipped if it was done by AssembleResidual().
+	void AssembleJacobian(bool assembleElements = true);
 #ifdef USE_PETSC
 	double ExecuteNonlinearWithPETsc();
 #endif
@@ -43,6 +53,7 @@ protected:
 private:
 	double error_k0 = 0.0;
 	double nl_r0 = 0;
+	bool gp_velocity_from_residual = false;
 	std::vector<int> vec_pos;
 };
 
@@ -487,7 +487,8 @@ double CRFProcessDeformation::Execute(int loop_process_number)
 
 #ifdef NEW_EQS
 	eqs_new->ConfigNumerics(m_num->ls_precond, m_num->ls_method, m_num->ls_max_iterations,
-							m_num->ls_error_tolerance, m_num->ls_storage_method, m_num->ls_extra_arg);
+							m_num->ls_error_tolerance, m_num->ls_storage_method, m_num->ls_extra_arg,
+							m_num->ls_check_residual);
 #endif
 
 	//-------------------------------------------------------------------
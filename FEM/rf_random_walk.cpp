@@ -22,6 +22,7 @@
 #include "rfmat_cp.h"
 
 // C++ STL
+#include <algorithm>
 #include <cfloat>
 #include <sstream>
 using namespace std;
@@ -62,6 +63,11 @@ RandomWalk::RandomWalk(int srand_seed)
 	FDMIndexSwitch = 0;
 	GridOption = 0;
 	ChanceOfIrreversed = NULL;  // YS: judgement for decay
+	for (int k = 0; k < 3; ++k)
+	{
+		grid_n[k] = 0;
+		grid_min[k] = grid_max[k] = grid_h[k] = 0.0;
+	}
 
 	// To produce a different pseudo-random series each time your program is
 	// run.
@@ -1479,7 +1485,7 @@ int RandomWalk::IndexOfTheElementThatThisParticleBelong(int option, Particle* A)
 		}
 		if (zrw_range > 1.e-12)
 		{
-			if (z > pnt_z_max || x < pnt_z_min) return index;
+			if (z > pnt_z_max || z < pnt_z_min) return index;
 			k = (long int)floor((z - pnt_z_min) / dz);
 		}
 
@@ -3879,7 +3885,7 @@ int RandomWalk::GetTheElementOfTheParticleFromNeighbor(Particle* A)
 	{
 #endif
 
-		MeshLib::CElem* theElement = m_msh->ele_vector[A->elementIndex];
+		const int start_index = A->elementIndex;
 		// Let's check this element first.
 		index = IsTheParticleInThisElement(A);
 		if (index != -1)
@@ -3888,84 +3894,247 @@ int RandomWalk::GetTheElementOfTheParticleFromNeighbor(Particle* A)
 			return index;
 		}
 
-		// First meighbor's search around the main element
-		for (size_t i = 0; i < theElement->GetFacesNumber(); ++i)
+		// Walk through the neighbors towards the particle. If the walk gets
+		// lost, ask the element grid, which only visits the elements whose
+		// bounding boxes overlap the particle position.
+		if (ele_bbox.size() != 6 * m_msh->ele_vector.size())
+			BuildElementLocator();
+		index = LocateParticleByNeighborWalk(A);
+		if (index < 0) index = LocateParticleByElementGrid(A);
+
+		// The search failed
+		if (index < 0)
 		{
-			MeshLib::CElem* thisNeighbor = theElement->GetNeighbor(i);
+			A->elementIndex = start_index;
+			index = -10;
+			printf("Searching the index from the neighbor failed\n");
+			printf("The particle should be outside of the domain.\n");
+		}
 
-			// If element type has more dimension than line.
-			if (thisNeighbor->GetElementType() != MshElemType::LINE)
-			{
-				// If the particle belongs to this element
-				A->elementIndex = thisNeighbor->GetIndex();
-				index = IsTheParticleInThisElement(A);
-				if (index != -1) return index;
+#ifdef ALLOW_PARTICLES_GO_OUTSIDE
+	}
+#endif
+	return index;
+}
 
-				// Second, search the neighbor's neighbor
-				for (size_t j = 0; j < thisNeighbor->GetFacesNumber(); ++j)
-				{
-					MeshLib::CElem* theNeighborsNeighbor =
-					    thisNeighbor->GetNeighbor(j);
+/**************************************************************************
+   Class: RandomWalk
+   Task: Build the data cached for locating particles: bounding boxes and
+         centroids of the elements and a uniform grid whose cells list the
+         elements overlapping them (CSR layout). The neighbor tables built
+         by CFEMesh::ConstructGrid are used for the walk itself.
+**************************************************************************/
+void RandomWalk::BuildElementLocator()
+{
+	m_msh = selectMeshForFluidMomentumProcess();
+	const long n_ele = (long)m_msh->ele_vector.size();
 
-					if (theNeighborsNeighbor->GetElementType() !=
-					    MshElemType::LINE)
-					{
-						// If the particle belongs to this element
-						A->elementIndex = theNeighborsNeighbor->GetIndex();
-						index = IsTheParticleInThisElement(A);
-						if (index != -1) return index;
-
-						// Third, search the neighbor's neighbor's neighbor
-						for (size_t k = 0;
-						     k < theNeighborsNeighbor->GetFacesNumber();
-						     ++k)
-						{
-							MeshLib::CElem* theNeighborsNeighborsNeighbor =
-							    theNeighborsNeighbor->GetNeighbor(k);
+	ele_bbox.assign(6 * n_ele, 0.0);
+	ele_centroid.assign(3 * n_ele, 0.0);
+	for (int k = 0; k < 3; ++k)
+	{
+		grid_min[k] = DBL_MAX;
+		grid_max[k] = -DBL_MAX;
+	}
 
-							if (theNeighborsNeighborsNeighbor
-							        ->GetElementType() != MshElemType::LINE)
-							{
-								// If the particle belongs to this element
-								A->elementIndex =
-								    theNeighborsNeighborsNeighbor->GetIndex();
-								index = IsTheParticleInThisElement(A);
-								if (index != -1) return index;
-							}
-						}
-					}
-				}
+	for (long e = 0; e < n_ele; ++e)
+	{
+		MeshLib::CElem* elem = m_msh->ele_vector[e];
+		double* bbox = &ele_bbox[6 * e];
+		double* centroid = &ele_centroid[3 * e];
+		for (int k = 0; k < 3; ++k)
+		{
+			bbox[k] = DBL_MAX;
+			bbox[k + 3] = -DBL_MAX;
+		}
+		const int nnodes = elem->GetVertexNumber();
+		for (int i = 0; i < nnodes; ++i)
+		{
+			double const* const pnt(
+			    m_msh->nod_vector[elem->GetNodeIndex(i)]->getData());
+			for (int k = 0; k < 3; ++k)
+			{
+				bbox[k] = std::min(bbox[k], pnt[k]);
+				bbox[k + 3] = std::max(bbox[k + 3], pnt[k]);
+				centroid[k] += pnt[k] / nnodes;
 			}
 		}
+		// Enlarge the box a little. Particles in fracture networks are not
+		// exactly on the element plane.
+		double size = 0.0;
+		for (int k = 0; k < 3; ++k)
+			size = std::max(size, bbox[k + 3] - bbox[k]);
+		const double tol = 1.e-3 * size + 1.e-12;
+		for (int k = 0; k < 3; ++k)
+		{
+			bbox[k] -= tol;
+			bbox[k + 3] += tol;
+			grid_min[k] = std::min(grid_min[k], bbox[k]);
+			grid_max[k] = std::max(grid_max[k], bbox[k + 3]);
+		}
+	}
 
-		// If the code pases the following loop, it means I am not lucky in this
-		// neighbor search.
-		int numberOfElements = (int)m_msh->ele_vector.size();
-		for (int i = 0; i < numberOfElements; ++i)
+	// About one element per cell
+	int dim = 0;
+	double volume = 1.0;
+	for (int k = 0; k < 3; ++k)
+		if (grid_max[k] - grid_min[k] > 1.e-12)
 		{
-			MeshLib::CElem* thisElement = m_msh->ele_vector[i];
+			volume *= grid_max[k] - grid_min[k];
+			dim++;
+		}
+	const double h =
+	    (dim > 0) ? pow(volume / std::max(n_ele, 1L), 1.0 / dim) : 1.0;
+	for (int k = 0; k < 3; ++k)
+	{
+		const double range = grid_max[k] - grid_min[k];
+		grid_n[k] = 1;
+		if (range > 1.e-12)
+			grid_n[k] = std::max(1L, std::min(1024L, (long)ceil(range / h)));
+		grid_h[k] = (range > 1.e-12) ? range / grid_n[k] : 1.0;
+	}
 
-			if (thisElement->GetElementType() != MshElemType::LINE)
+	// Count the elements of each cell first and then fill the buckets
+	const long n_cells = grid_n[0] * grid_n[1] * grid_n[2];
+	grid_cell_ptr.assign(n_cells + 1, 0);
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		std::vector<long> fill;
+		if (pass == 1)
+		{
+			for (long c = 0; c < n_cells; ++c)
+				grid_cell_ptr[c + 1] += grid_cell_ptr[c];
+			grid_cell_ele.resize(grid_cell_ptr[n_cells]);
+			fill.assign(grid_cell_ptr.begin(), grid_cell_ptr.end() - 1);
+		}
+		for (long e = 0; e < n_ele; ++e)
+		{
+			const double* bbox = &ele_bbox[6 * e];
+			long lo[3], hi[3];
+			for (int k = 0; k < 3; ++k)
 			{
-				// If the particle belongs to this element
-				A->elementIndex = thisElement->GetIndex();
-				index = IsTheParticleInThisElement(A);
-				if (index != -1) return index;
+				lo[k] = (long)floor((bbox[k] - grid_min[k]) / grid_h[k]);
+				hi[k] = (long)floor((bbox[k + 3] - grid_min[k]) / grid_h[k]);
+				lo[k] = std::max(0L, std::min(grid_n[k] - 1, lo[k]));
+				hi[k] = std::max(0L, std::min(grid_n[k] - 1, hi[k]));
 			}
+			for (long kk = lo[2]; kk <= hi[2]; ++kk)
+				for (long jj = lo[1]; jj <= hi[1]; ++jj)
+					for (long ii = lo[0]; ii <= hi[0]; ++ii)
+					{
+						const long c = (kk * grid_n[1] + jj) * grid_n[0] + ii;
+						if (pass == 0)
+							grid_cell_ptr[c + 1]++;
+						else
+							grid_cell_ele[fill[c]++] = e;
+					}
 		}
+	}
+}
 
-		// The search failed
-		if (index == -1)
+/**************************************************************************
+   Class: RandomWalk
+   Task: Check if the particle is inside the (enlarged) bounding box of the
+         element. Cheap test done before IsTheParticleInThisElement.
+**************************************************************************/
+bool RandomWalk::IsInElementBoundingBox(const Particle* A, long ele_index) const
+{
+	const double* bbox = &ele_bbox[6 * ele_index];
+	return A->x >= bbox[0] && A->x <= bbox[3] && A->y >= bbox[1] &&
+	       A->y <= bbox[4] && A->z >= bbox[2] && A->z <= bbox[5];
+}
+
+/**************************************************************************
+   Class: RandomWalk
+   Task: Starting from A->elementIndex, step into the neighbor whose
+         centroid is closest to the particle until the element containing
+         the particle is found. Returns -1 if the walk gets lost.
+**************************************************************************/
+int RandomWalk::LocateParticleByNeighborWalk(Particle* A)
+{
+	const int max_steps = 64;
+	std::vector<long> visited;
+	visited.reserve(max_steps);
+
+	MeshLib::CElem* theElement = m_msh->ele_vector[A->elementIndex];
+	const int ele_dim = theElement->GetDimension();
+	for (int step = 0; step < max_steps; ++step)
+	{
+		visited.push_back(theElement->GetIndex());
+
+		MeshLib::CElem* next = NULL;
+		double next_dist2 = DBL_MAX;
+		for (size_t i = 0; i < theElement->GetFacesNumber(); ++i)
 		{
-			index = -10;
-			printf("Searching the index from the neighbor failed\n");
-			printf("The particle should be outside of the domain.\n");
+			MeshLib::CElem* thisNeighbor = theElement->GetNeighbor(i);
+			// Skip surface faces and lower dimensional elements
+			if (!thisNeighbor || thisNeighbor->GetDimension() != ele_dim)
+				continue;
+			const long nb = thisNeighbor->GetIndex();
+			if (nb < 0 || nb >= (long)m_msh->ele_vector.size() ||
+			    m_msh->ele_vector[nb] != thisNeighbor)
+				continue;
+			if (std::find(visited.begin(), visited.end(), nb) != visited.end())
+				continue;
+
+			if (IsInElementBoundingBox(A, nb))
+			{
+				A->elementIndex = nb;
+				const int index = IsTheParticleInThisElement(A);
+				if (index != -1) return index;
+			}
+
+			const double* c = &ele_centroid[3 * nb];
+			const double dist2 = (A->x - c[0]) * (A->x - c[0]) +
+			                     (A->y - c[1]) * (A->y - c[1]) +
+			                     (A->z - c[2]) * (A->z - c[2]);
+			if (dist2 < next_dist2)
+			{
+				next_dist2 = dist2;
+				next = thisNeighbor;
+			}
 		}
+		if (!next) break;
+		theElement = next;
+	}
 
-#ifdef ALLOW_PARTICLES_GO_OUTSIDE
+	A->elementIndex = visited.front();
+	return -1;
+}
+
+/**************************************************************************
+   Class: RandomWalk
+   Task: Find the element containing the particle from the element grid.
+         Only the elements of the grid cell of the particle are checked.
+         Returns -1 if the particle is outside of the domain.
+**************************************************************************/
+int RandomWalk::LocateParticleByElementGrid(Particle* A)
+{
+	const double x[3] = {A->x, A->y, A->z};
+	long c = 0;
+	for (int k = 2; k >= 0; --k)
+	{
+		if (x[k] < grid_min[k] || x[k] > grid_max[k]) return -1;
+		const long i = std::min(grid_n[k] - 1,
+		                        (long)floor((x[k] - grid_min[k]) / grid_h[k]));
+		c = c * grid_n[k] + i;
 	}
-#endif
-	return index;
+
+	const int start_index = A->elementIndex;
+	for (long j = grid_cell_ptr[c]; j < grid_cell_ptr[c + 1]; ++j)
+	{
+		const long e = grid_cell_ele[j];
+		if (e == start_index ||
+		    m_msh->ele_vector[e]->GetElementType() == MshElemType::LINE ||
+		    !IsInElementBoundingBox(A, e))
+			continue;
+		A->elementIndex = e;
+		const int index = IsTheParticleInThisElement(A);
+		if (index != -1) return index;
+	}
+
+	A->elementIndex = start_index;
+	return -1;
 }
 
 /**************************************************************************
@@ -243,6 +243,21 @@ private:
 	double yrw_range;
 	double zrw_range;
 
+	// Cached data for locating particles in the mesh
+	std::vector<double> ele_bbox;      // xmin, ymin, zmin, xmax, ymax, zmax
+	std::vector<double> ele_centroid;  // x, y, z
+	std::vector<long> grid_cell_ptr;   // offsets into grid_cell_ele
+	std::vector<long> grid_cell_ele;   // elements overlapping each cell
+	long grid_n[3];
+	double grid_min[3];
+	double grid_max[3];
+	double grid_h[3];
+
+	void BuildElementLocator();
+	bool IsInElementBoundingBox(const Particle* A, long ele_index) const;
+	int LocateParticleByNeighborWalk(Particle* A);
+	int LocateParticleByElementGrid(Particle* A);
+
 	double ComputeVolume(Particle* A, MeshLib::CElem* m_ele);
 	double ComputeVolume(Particle* A, Particle* element, MeshLib::CElem* m_ele);
 	void CopyParticleCoordToArray(Particle* A,
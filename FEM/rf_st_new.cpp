@@ -96,6 +96,7 @@ CSourceTerm::CSourceTerm()
 	is_transfer_bc = false;
 	st_id = -1;
 	has_constrain = false;
+	constrain_var_id = -1;
 }
 
 // KR: Conversion from GUI-ST-object to CSourceTerm
@@ -174,6 +175,64 @@ CSourceTerm::~CSourceTerm()
 		delete this->st_boundary_elements[i];
 }
 
+void CSourceTerm::clearBoundaryOperator()
+{
+	for (size_t i = 0; i < st_boundary_elements.size(); i++)
+		delete st_boundary_elements[i];
+	st_boundary_elements.clear();
+	boundary_operator.clear();
+}
+
+void BoundaryIntegrationOperator::clear()
+{
+	_elements.clear();
+	_nodes.clear();
+	_flux.clear();
+	_mass.clear();
+}
+
+void BoundaryIntegrationOperator::addElement(unsigned n_nodes,
+                                             const long* nodes,
+                                             const double* flux_matrix,
+                                             unsigned n_mass_nodes,
+                                             const double* mass_matrix)
+{
+	Element e;
+	e.n_nodes = n_nodes;
+	e.n_mass_nodes = mass_matrix ? n_mass_nodes : 0;
+	e.nodes = _nodes.size();
+	e.flux = _flux.size();
+	e.mass = _mass.size();
+	_elements.push_back(e);
+	_nodes.insert(_nodes.end(), nodes, nodes + n_nodes);
+	_flux.insert(_flux.end(), flux_matrix, flux_matrix + n_nodes * n_nodes);
+	if (mass_matrix)
+		_mass.insert(_mass.end(), mass_matrix,
+		             mass_matrix + n_mass_nodes * n_mass_nodes);
+}
+
+void BoundaryIntegrationOperator::integrate(
+    std::vector<double>& node_values,
+    const std::vector<bool>* active_elements) const
+{
+	std::vector<double> fluxes(node_values.size(), 0.0);
+	for (std::size_t i = 0; i < _elements.size(); i++)
+	{
+		if (active_elements && !(*active_elements)[i]) continue;
+		const Element& e = _elements[i];
+		const long* nodes = &_nodes[e.nodes];
+		const double* matrix = &_flux[e.flux];
+		for (unsigned k = 0; k < e.n_nodes; k++)
+		{
+			double flux = 0.0;
+			for (unsigned l = 0; l < e.n_nodes; l++)
+				flux += matrix[k * e.n_nodes + l] * node_values[nodes[l]];
+			fluxes[nodes[k]] += flux;
+		}
+	}
+	node_values.swap(fluxes);
+}
+
 const std::string& CSourceTerm::getGeoName() const
 {
 	return geo_name;
@@ -1119,6 +1178,7 @@ void CSourceTermGroup::Set(CRFProcess* m_pcs, const int ShiftInNodeVector,
 		//------------------------------------------------------------------
 		node_value.resize(nodes_vector.size());
 		setDistribution(distData, *m_msh, nodes_vector, node_value);
+		if (st->has_constrain) st->distributed_node_values = node_value;
 		//------------------------------------------------------------------
 		// Calculate integrated values
 		//------------------------------------------------------------------
@@ -1395,8 +1455,7 @@ void CSourceTermGroup::Set(CRFProcess* m_pcs, const int ShiftInNodeVector,
 
 void CSourceTerm::EdgeIntegration(CFEMesh* msh,
                                   const std::vector<long>& nodes_on_ply,
-                                  std::vector<double>& node_value_vector,
-                                  std::vector<bool>* active_elements)
+                                  std::vector<double>& node_value_vector)
 {
 	long i, j, k, l;
 	long this_number_of_nodes;
@@ -1432,6 +1491,8 @@ void CSourceTerm::EdgeIntegration(CFEMesh* msh,
 	this_number_of_nodes = (long)nodes_on_ply.size();
 	std::vector<long> G2L(nSize);
 	std::vector<double> NVal(this_number_of_nodes);
+	const bool keep_operator = keepBoundaryOperator();
+	if (keep_operator) clearBoundaryOperator();
 
 	// Unmakr edges.
 	for (i = 0; i < (long)msh->edge_vector.size(); i++)
@@ -1488,7 +1549,6 @@ void CSourceTerm::EdgeIntegration(CFEMesh* msh,
 	{
 		edge = msh->edge_vector[i];
 		if (!edge->GetMark()) continue;
-		if (active_elements && !(*active_elements)[i]) continue;
 		edge->GetNodes(e_nodes);
 		if (msh->getOrder())
 		{
@@ -1510,26 +1570,49 @@ void CSourceTerm::EdgeIntegration(CFEMesh* msh,
 		edge_ele->setNodes(edge_nodes);
 		edge_ele->SetOrder(msh->getOrder());
 		edge_ele->ComputeVolume();
-		if (!active_elements) st_boundary_elements.push_back(edge_ele);
 
 		fem->setOrder(msh->getOrder() + 1);
 		fem->ConfigElement(edge_ele, true);
-		double nodesFVal[3] = {};
-		nodesFVal[0] = node_value_vector[G2L[e_nodes[0]->GetIndex()]];
-		nodesFVal[1] = node_value_vector[G2L[e_nodes[1]->GetIndex()]];
-		if (msh->getOrder())
-			nodesFVal[2] = node_value_vector[G2L[e_nodes[2]->GetIndex()]];
-		fem->FaceIntegration(nodesFVal);
-		if (this->is_transfer_bc)
+		long edge_nodes_local[3];
+		for (k = 0; k < (signed)nen; k++)
+			edge_nodes_local[k] = G2L[e_nodes[k]->GetIndex()];
+		// Integration matrix: column l holds the nodal fluxes of a unit
+		// value at node l
+		const double h = this->is_transfer_bc
+		                     ? this->transfer_h_values[edge_ele->GetPatchIndex()]
+		                     : 1.0;
+		double flux_matrix[9];
+		for (l = 0; l < (signed)nen; l++)
 		{
+			double nodesFVal[3] = {};
+			nodesFVal[l] = 1.0;
+			fem->FaceIntegration(nodesFVal);
 			for (k = 0; k < (signed)nen; k++)
-				nodesFVal[k] *=
-				    this->transfer_h_values[edge_ele->GetPatchIndex()];
+				flux_matrix[k * nen + l] = nodesFVal[k] * h;
 		}
 		for (k = 0; k < (signed)nen; k++)
+			for (l = 0; l < (signed)nen; l++)
+				NVal[edge_nodes_local[k]] +=
+				    flux_matrix[k * nen + l] *
+				    node_value_vector[edge_nodes_local[l]];
+
+		if (keep_operator)
 		{
-			NVal[G2L[edge->GetNode(k)->GetIndex()]] += nodesFVal[k];
+			double mass[9] = {};
+			if (this->is_transfer_bc)
+			{
+				fem->CalcFaceMass(mass);
+				for (k = 0; k < 9; k++)
+					mass[k] *= h;
+			}
+			boundary_operator.addElement(
+			    nen, edge_nodes_local, flux_matrix,
+			    edge_ele->GetNodesNumber(false),
+			    this->is_transfer_bc ? mass : NULL);
+			st_boundary_elements.push_back(edge_ele);
 		}
+		else
+			delete edge_ele;
 
 #if 0
       if (msh->getOrder())                        // Quad
@@ -1646,8 +1729,7 @@ void CSourceTerm::EdgeIntegration(CFEMesh* msh,
 
 void CSourceTerm::FaceIntegration(CFEMesh* msh,
                                   std::vector<long> const& nodes_on_sfc,
-                                  std::vector<double>& node_value_vector,
-                                  std::vector<bool>* active_elements)
+                                  std::vector<double>& node_value_vector)
 {
 	if (!msh)
 	{
@@ -1660,6 +1742,8 @@ void CSourceTerm::FaceIntegration(CFEMesh* msh,
 
 	const long n_sfc_nodes = (long)nodes_on_sfc.size();
 	const long n_msh_nodes = (long)msh->nod_vector.size();
+	const bool keep_operator = keepBoundaryOperator();
+	if (keep_operator) clearBoundaryOperator();
 
 
 	//----------------------------------------------------------------------
@@ -1780,7 +1864,9 @@ void CSourceTerm::FaceIntegration(CFEMesh* msh,
 	// search elements & face integration
 	const long n_vec_possible_elements = vec_possible_elements.size();
 	int face_nodes_local_index[8];
+	long face_nodes_sfc_index[8];
 	double face_node_values[8];
+	double flux_matrix[64];
 //#define ST_OMP
 #ifdef ST_OMP
 #pragma omp parallel for default(none)                                         \
@@ -1796,8 +1882,6 @@ void CSourceTerm::FaceIntegration(CFEMesh* msh,
 			continue;
 		if (elem->GetDimension() < 3)
 			continue;
-		if (active_elements && !(*active_elements)[i])
-			continue;
 
 		elem->SetOrder(msh->getOrder());
 
@@ -1833,7 +1917,8 @@ void CSourceTerm::FaceIntegration(CFEMesh* msh,
 			for (k = 0; k < n_face_nodes; k++)
 			{
 				CNode* face_node = elem->GetNode(face_nodes_local_index[k]);
-				face_node_values[k] = node_value_vector[mshNodeId2sfcNodeId[face_node->GetIndex()]];
+				face_nodes_sfc_index[k] =
+				    mshNodeId2sfcNodeId[face_node->GetIndex()];
 			}
 			double fac = 1.0;
 			// Not a surface face
@@ -1845,25 +1930,53 @@ void CSourceTerm::FaceIntegration(CFEMesh* msh,
 			face->SetOrder(msh->getOrder());
 			face->SetFace(elem, j);
 			face->ComputeVolume();
-			if (active_elements == NULL)
-				st_boundary_elements.push_back(face);
 			fem->setOrder(msh->getOrder() ? 2 : 1);
 			fem->ConfigElement(face, true);
-			fem->FaceIntegration(face_node_values);
 
-			if (this->is_transfer_bc)
+			// Integration matrix: column l holds the nodal fluxes of a
+			// unit value at node l
+			const double h =
+			    this->is_transfer_bc
+			        ? this->transfer_h_values[face->GetPatchIndex()]
+			        : 1.0;
+			for (l = 0; l < n_face_nodes; l++)
 			{
 				for (k = 0; k < n_face_nodes; k++)
-					face_node_values[k] *= this->transfer_h_values[face->GetPatchIndex()];
+					face_node_values[k] = 0.0;
+				face_node_values[l] = 1.0;
+				fem->FaceIntegration(face_node_values);
+				for (k = 0; k < n_face_nodes; k++)
+					flux_matrix[k * n_face_nodes + l] =
+					    fac * h * face_node_values[k];
 			}
 
 			for (k = 0; k < n_face_nodes; k++)
 			{
-				CNode* face_node = elem->GetNode(face_nodes_local_index[k]);
-				long id = mshNodeId2sfcNodeId[face_node->GetIndex()];
+				double flux = 0.0;
+				for (l = 0; l < n_face_nodes; l++)
+					flux += flux_matrix[k * n_face_nodes + l] *
+					        node_value_vector[face_nodes_sfc_index[l]];
 				#pragma omp atomic
-				sfc_node_values[id] += fac * face_node_values[k];
+				sfc_node_values[face_nodes_sfc_index[k]] += flux;
 			}
+
+			if (keep_operator)
+			{
+				double mass[64] = {};
+				if (this->is_transfer_bc)
+				{
+					fem->CalcFaceMass(mass);
+					for (k = 0; k < 64; k++)
+						mass[k] *= h;
+				}
+				boundary_operator.addElement(
+				    n_face_nodes, face_nodes_sfc_index, flux_matrix,
+				    face->GetNodesNumber(false),
+				    this->is_transfer_bc ? mass : NULL);
+				st_boundary_elements.push_back(face);
+			}
+			else
+				delete face;
 		}
 	}
 
@@ -50,6 +50,56 @@ class CElem;
 
 class SourceTerm;
 
+/**
+ * Boundary integration operator of a Neumann source term on a polyline or a
+ * surface. For each boundary element it keeps the positions of the element
+ * nodes in the node list of the source term and the local matrix which maps
+ * the distributed values to the nodal fluxes (transfer coefficient and
+ * weight of inner faces included). For an exchange condition, the face mass
+ * matrix times the transfer coefficient is kept, too.
+ */
+class BoundaryIntegrationOperator
+{
+public:
+	void clear();
+	void addElement(unsigned n_nodes, const long* nodes,
+	                const double* flux_matrix, unsigned n_mass_nodes = 0,
+	                const double* mass_matrix = NULL);
+
+	std::size_t getNumberOfElements() const { return _elements.size(); }
+	const long* getNodes(std::size_t e) const
+	{
+		return &_nodes[_elements[e].nodes];
+	}
+	unsigned getNumberOfMassNodes(std::size_t e) const
+	{
+		return _elements[e].n_mass_nodes;
+	}
+	const double* getMassMatrix(std::size_t e) const
+	{
+		return &_mass[_elements[e].mass];
+	}
+
+	/// Replace the distributed values by the nodal fluxes of the elements,
+	/// of the active elements only if a mask is given.
+	void integrate(std::vector<double>& node_values,
+	               const std::vector<bool>* active_elements = NULL) const;
+
+private:
+	struct Element
+	{
+		unsigned n_nodes;
+		unsigned n_mass_nodes;
+		std::size_t nodes;
+		std::size_t flux;
+		std::size_t mass;
+	};
+	std::vector<Element> _elements;
+	std::vector<long> _nodes;
+	std::vector<double> _flux;
+	std::vector<double> _mass;
+};
+
 typedef struct
 {
 	std::vector<double> value_reference;
@@ -73,12 +123,10 @@ public:
 
 	void EdgeIntegration(MeshLib::CFEMesh* m_msh,
 	                     const std::vector<long>& nodes_on_ply,
-	                     std::vector<double>& node_value_vector,
-	                     std::vector<bool>* active_elements = NULL);
+	                     std::vector<double>& node_value_vector);
 	void FaceIntegration(MeshLib::CFEMesh* m_msh,
 	                     std::vector<long> const& nodes_on_sfc,
-	                     std::vector<double>& node_value_vector,
-	                     std::vector<bool>* active_elements = NULL);
+	                     std::vector<double>& node_value_vector);
 	void DomainIntegration(MeshLib::CFEMesh* m_msh,
 	                       const std::vector<long>& nodes_in_dom,
 	                       std::vector<double>& node_value_vector) const;
@@ -208,6 +256,14 @@ private:  // TF, KR
 	                 const GEOLIB::GEOObjects& geo_obj,
 	                 const std::string& unique_name);
 
+	// Boundary elements and their operator are kept for constrained and
+	// exchange conditions, which are integrated again during the simulation
+	bool keepBoundaryOperator() const
+	{
+		return has_constrain || is_transfer_bc;
+	}
+	void clearBoundaryOperator();
+
 	void CreateHistoryNodeMemory(NODE_HISTORY* nh);
 	void DeleteHistoryNodeMemory();
 
@@ -272,6 +328,9 @@ private:
 
 public:
 	std::vector<MeshLib::CElem*> st_boundary_elements;
+	BoundaryIntegrationOperator boundary_operator;
+	// Distributed values at the nodes before the integration
+	std::vector<double> distributed_node_values;
 	double gradient_ref_depth;
 	double gradient_ref_depth_value;
 	double gradient_ref_depth_gradient;
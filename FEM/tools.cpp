@@ -9,7 +9,9 @@
 
 #include "tools.h"
 
+#include <algorithm>
 #include <cfloat>
+#include <vector>
 
 #include "display.h"
 #include "FileToolsRF.h"
@@ -27,6 +29,9 @@
 #include "rf_mmp_new.h"
 #include "rf_num_new.h"
 #include "rf_tim_new.h"
+#ifdef NEW_EQS
+#include "sparse_table.h"
+#endif
 
 using namespace std;
 
@@ -451,99 +456,120 @@ void convertElementDataToNodalData(
 }
 
 #ifdef NEW_EQS
-Math_Group::SparseTable* createSparseTable(MeshLib::CFEMesh* a_mesh,
-                         bool quadratic,
-                         bool symm)
+namespace
 {
-	Math_Group::SparseTable* st = new Math_Group::SparseTable();
-	st->symmetry = symm;
-
-	//
-	// In sparse table, = number of nodes
-	st->rows = a_mesh->GetNodesNumber(quadratic);
-	st->size_entry_column = 0;
-	st->diag_entry = new long[st->rows];
-
-	long** larraybuffer = nullptr;
-	if (st->symmetry)
+// Off-diagonal columns of row i given by the nodes in [first, last).
+// Nodes without a row are skipped. The columns are only counted if
+// 'columns' is NULL.
+template <typename Iterator>
+long getRowColumns(long i, Iterator first, Iterator last,
+                   const std::vector<long>& node_row, bool symm, long* columns)
+{
+	const long rows = static_cast<long>(node_row.size());
+	long n = 0;
+	for (; first != last; ++first)
 	{
-		larraybuffer = new long* [st->rows];
-		for (long i = 0; i < st->rows; i++)
-		{
-			MeshLib::CNode* node = a_mesh->nod_vector[i];
-			// 'diag_entry' used as a temporary array
-			// to store the number of nodes connected to this node
-			const long lbuff1 = (long)node->getConnectedNodes().size();
-			larraybuffer[i] = new long[lbuff1 + 1];
-			//
-			larraybuffer[i][0] = lbuff1;
-			for (long j = 0; j < lbuff1; j++)
-				larraybuffer[i][j + 1] = node->getConnectedNodes()[j];
-			node->getConnectedNodes().clear();
-			for (long j = 0; j < lbuff1; j++)
-			{
-				long jj = larraybuffer[i][j + 1];
-				if (i <= jj)
-					node->getConnectedNodes().push_back(jj);
-			}
-		}
+		const long node = static_cast<long>(*first);
+		if (node >= rows) continue;
+		const long col = node_row[node];
+		if (col == i || (symm && col < i)) continue;
+		if (columns) columns[n] = col;
+		n++;
 	}
+	return n;
+}
 
-	// num_column_entries saves vector ptr of CRS
-	st->num_column_entries = new long[st->rows + 1];
-
-	std::vector<long> A_index;
-
-	for (long i = 0; i < st->rows; i++)
+/**************************************************************************
+   FEMLib-Method:
+   Task: CRS pattern of a sparse table in two passes over the rows. The
+         entries of each row are counted, the row pointers are the prefix
+         sums of the counts, and each row is then filled and sorted on its
+         own. row_columns(i, columns) gives the off-diagonal columns of
+         row i as getRowColumns.
+**************************************************************************/
+template <typename RowColumns>
+Math_Group::SparseTable* buildSparseTable(long rows, bool symm,
+                                          const RowColumns& row_columns)
+{
+	Math_Group::SparseTable* st = new Math_Group::SparseTable();
+	st->symmetry = symm;
+	st->rows = rows;
+	st->num_column_entries = new long[rows + 1];
+	st->diag_entry = new long[rows];
+
+	long* row_ptr = st->num_column_entries;
+	row_ptr[0] = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 256)
+#endif
+	for (long i = 0; i < rows; i++)
+		row_ptr[i + 1] = row_columns(i, static_cast<long*>(NULL)) + 1;
+	for (long i = 0; i < rows; i++)
+		row_ptr[i + 1] += row_ptr[i];
+
+	st->size_entry_column = row_ptr[rows];
+	st->entry_column = new long[st->size_entry_column];
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 256)
+#endif
+	for (long i = 0; i < rows; i++)
 	{
-		st->num_column_entries[i] = (long)A_index.size();
-
-		MeshLib::CNode const* node = a_mesh->nod_vector[i];
-		std::vector<size_t> vec_node_ids(node->getConnectedNodes());
-		vec_node_ids.push_back(i);
-		std::sort(vec_node_ids.begin(), vec_node_ids.end());
-		for (size_t j = 0; j < vec_node_ids.size(); j++)
-		{
-			long col_index = vec_node_ids[j];
-
-			if ((!quadratic) && (col_index >= st->rows))
-				continue;
-
-			if (i == col_index)
-				st->diag_entry[i] = (long)A_index.size();
-			A_index.push_back(col_index);
-		}
+		long* first = st->entry_column + row_ptr[i];
+		first[0] = i;
+		row_columns(i, first + 1);
+		long* last = st->entry_column + row_ptr[i + 1];
+		std::sort(first, last);
+		st->diag_entry[i] = std::lower_bound(first, last, i) - st->entry_column;
 	}
+	return st;
+}
 
-	st->size_entry_column = (long)A_index.size();
-	st->num_column_entries[st->rows] = st->size_entry_column;
+}
 
-	st->entry_column = new long[st->size_entry_column];
-	for (long i = 0; i < st->size_entry_column; i++)
-		st->entry_column[i] = A_index[i];
+/**************************************************************************
+   FEMLib-Method:
+   Task: Sparse table of the linear or quadratic nodes of a mesh. The
+         linear table of a mesh with quadratic nodes is derived from the
+         quadratic table st_H if it is given.
+**************************************************************************/
+Math_Group::SparseTable* createSparseTable(
+    MeshLib::CFEMesh* a_mesh, bool quadratic, bool symm,
+    const Math_Group::SparseTable* st_H = NULL)
+{
+	const long rows = static_cast<long>(a_mesh->GetNodesNumber(quadratic));
 
-	// For the case of symmetry matrix
-	if (st->symmetry)
+	// The rows are ordered as the equations of the linear nodes, which may
+	// be renumbered (CFEMesh::RenumberEquations)
+	std::vector<long> row_node(rows), node_row(rows);
+	for (long i = 0; i < rows; i++)
 	{
-		for (long i = 0; i < st->rows; i++)
-		{
-			long lbuff0 = larraybuffer[i][0];
-			a_mesh->nod_vector[i]->getConnectedNodes().resize(lbuff0);
-			//
-			for (long j = 0; j < lbuff0; j++)
-				a_mesh->nod_vector[i]->getConnectedNodes()[j] =
-				    larraybuffer[i][j + 1];
-		}
-		for (long i = 0; i < st->rows; i++)
-		{
-			delete[] larraybuffer[i];
-			larraybuffer[i] = nullptr;
-		}
-		delete[] larraybuffer;
-		larraybuffer = nullptr;
+		row_node[i] = quadratic ? i : a_mesh->Eqs2Global_NodeIndex[i];
+		node_row[row_node[i]] = i;
 	}
 
-	return st;
+	// The linear pattern of a mesh with quadratic nodes is the part of the
+	// quadratic one which couples linear nodes
+	if (quadratic) st_H = NULL;
+	if (st_H)
+		return buildSparseTable(
+		    rows, symm, [&](long i, long* columns)
+		    {
+			    const long* first =
+			        st_H->entry_column + st_H->num_column_entries[row_node[i]];
+			    const long* last =
+			        st_H->entry_column +
+			        st_H->num_column_entries[row_node[i] + 1];
+			    return getRowColumns(i, first, last, node_row, symm, columns);
+			});
+
+	return buildSparseTable(
+	    rows, symm, [&](long i, long* columns)
+	    {
+		    MeshLib::IndexRange const connected(
+		        a_mesh->nod_vector[row_node[i]]->getConnectedNodes());
+		    return getRowColumns(i, connected.begin(), connected.end(),
+		                         node_row, symm, columns);
+		});
 }
 
 void CreateSparseTable(MeshLib::CFEMesh* msh, Math_Group::SparseTable* &sparse_graph, Math_Group::SparseTable* &sparse_graph_H)
@@ -556,11 +582,20 @@ void CreateSparseTable(MeshLib::CFEMesh* msh, Math_Group::SparseTable* &sparse_g
 	if (sparse_graph_H)
 	{
 		if ((int)pcs_vector.size() > 1)
-			sparse_graph = createSparseTable(msh, false, false);
+			sparse_graph =
+			    createSparseTable(msh, false, false, sparse_graph_H);
 	}
 	// 3. For process with linear elements
 	else
 		sparse_graph = createSparseTable(msh, false, false);
+	if (sparse_graph_H)
+		ScreenMessage("-> Sparse table of the quadratic nodes: %ld rows, "
+		              "%ld entries\n",
+		              sparse_graph_H->rows, sparse_graph_H->size_entry_column);
+	if (sparse_graph)
+		ScreenMessage("-> Sparse table of the linear nodes: %ld rows, "
+		              "%ld entries\n",
+		              sparse_graph->rows, sparse_graph->size_entry_column);
 
 	//  sparse_graph->Write();
 	//  sparse_graph_H->Write();
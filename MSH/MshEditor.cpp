@@ -26,7 +26,7 @@ void MshEditor::getNodeAreas(const MeshLib::CFEMesh* mesh,
 	{
 		double node_area(0);
 
-		std::vector<size_t> connected_elements(
+		MeshLib::IndexRange const connected_elements(
 		    mesh->nod_vector[n]->getConnectedElementIDs());
 
 		for (size_t i = 0; i < connected_elements.size(); i++)
@@ -84,7 +84,7 @@ MeshLib::CFEMesh* MshEditor::removeMeshNodes(MeshLib::CFEMesh* mesh,
 	for (size_t i = 0; i < delNodes; i++)
 	{
 		MeshLib::CNode* node = new_mesh->nod_vector[nodes[i]];
-		std::vector<size_t> conn_elems = node->getConnectedElementIDs();
+		MeshLib::IndexRange const conn_elems(node->getConnectedElementIDs());
 		for (size_t j = 0; j < conn_elems.size(); j++)
 		{
 			delete new_mesh->ele_vector[conn_elems[j]];
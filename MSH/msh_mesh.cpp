@@ -9,11 +9,13 @@
 
 #include "msh_mesh.h"
 
+#include <algorithm>
 #include <cfloat>
 #include <cmath>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <new>
 #include <set>
 #include <sstream>
 #include <vector>
@@ -24,6 +26,7 @@
 
 #include "display.h"
 #include "memory.h"
+#include "RunTime.h"
 
 #include "mathlib.h"
 #include "MathTools.h"
@@ -63,7 +66,11 @@ CFEMesh::CFEMesh(GEOLIB::GEOObjects* geo_obj, std::string* geo_name)
       NodesNumber_Quadratic(0),
       useQuadratic(false),
       _axisymmetry(false),
-      _mesh_grid(NULL)
+      _mesh_grid(NULL),
+      _node_pool(NULL),
+      _n_pooled_nodes(0),
+      _elem_pool(NULL),
+      _n_pooled_elems(0)
 {
 	coordinate_system = 1;
 
@@ -77,7 +84,12 @@ CFEMesh::CFEMesh(GEOLIB::GEOObjects* geo_obj, std::string* geo_name)
 // Copy-Constructor for CFEMeshes.
 // Programming: 2010/11/10 KR
 CFEMesh::CFEMesh(CFEMesh const& old_mesh)
-	: _search_length(old_mesh._search_length), _mesh_grid(NULL)
+	: _search_length(old_mesh._search_length),
+	  _mesh_grid(NULL),
+	  _node_pool(NULL),
+	  _n_pooled_nodes(0),
+	  _elem_pool(NULL),
+	  _n_pooled_elems(0)
 {
 	std::cout << "Copying mesh object ... ";
 
@@ -128,8 +140,11 @@ CFEMesh::~CFEMesh(void)
 	// delete nodes
 	size_t nNodes(nod_vector.size());
 	for (size_t i = 0; i < nNodes; i++)
-		delete nod_vector[i];
+		if (!isPooled(nod_vector[i])) delete nod_vector[i];
 	nod_vector.clear();
+	for (size_t i = 0; i < _n_pooled_nodes; i++)
+		_node_pool[i].~CNode();
+	::operator delete(_node_pool);
 
 	// Edges
 	size_t nEdges(edge_vector.size());
@@ -146,8 +161,11 @@ CFEMesh::~CFEMesh(void)
 	// Element
 	size_t nElems(ele_vector.size());
 	for (size_t i = 0; i < nElems; i++)
-		delete ele_vector[i];
+		if (!isPooled(ele_vector[i])) delete ele_vector[i];
 	ele_vector.clear();
+	for (size_t i = 0; i < _n_pooled_elems; i++)
+		_elem_pool[i].~CElem();
+	::operator delete(_elem_pool);
 
 	// normal  YD
 	size_t nNormals(face_normal.size());
@@ -331,12 +349,23 @@ bool CFEMesh::Read(std::ifstream* fem_file)
 			size_t no_nodes, idx;
 			*fem_file >> no_nodes >> std::ws;
 			nod_vector.resize(no_nodes);  // NW
+			const bool pooled = (_node_pool == NULL);
+			if (pooled)
+				_node_pool = static_cast<CNode*>(
+				    ::operator new(no_nodes * sizeof(CNode)));
 			std::string s;
 			std::ios::pos_type position = fem_file->tellg();
 			for (size_t i = 0; i < no_nodes; i++)
 			{
 				*fem_file >> idx >> x >> y >> z;
-				CNode* newNode(new CNode(idx, x, y, z));
+				CNode* newNode;
+				if (pooled)
+				{
+					newNode = new (_node_pool + i) CNode(idx, x, y, z);
+					_n_pooled_nodes++;
+				}
+				else
+					newNode = new CNode(idx, x, y, z);
 				// nod_vector.push_back(newNode);
 				nod_vector[i] = newNode;  // NW
 				position = fem_file->tellg();
@@ -353,9 +382,20 @@ bool CFEMesh::Read(std::ifstream* fem_file)
 			size_t no_elements;
 			*fem_file >> no_elements >> std::ws;
 			ele_vector.resize(no_elements);  // NW
+			const bool pooled = (_elem_pool == NULL);
+			if (pooled)
+				_elem_pool = static_cast<CElem*>(
+				    ::operator new(no_elements * sizeof(CElem)));
 			for (size_t i = 0; i < no_elements; i++)
 			{
-				CElem* newElem(new CElem(i));
+				CElem* newElem;
+				if (pooled)
+				{
+					newElem = new (_elem_pool + i) CElem(i);
+					_n_pooled_elems++;
+				}
+				else
+					newElem = new CElem(i);
 				newElem->Read(*fem_file);
 				setElementType(newElem->geo_type);  // CC02/2006
 				if (newElem->GetPatchIndex() > max_mmp_groups)
@@ -382,21 +422,349 @@ bool CFEMesh::Read(std::ifstream* fem_file)
 **************************************************************************/
 void CFEMesh::ConnectedElements2Node(bool quadratic)
 {
-	size_t nNodes(nod_vector.size());
-	for (size_t e = 0; e < nNodes; e++)
-		nod_vector[e]->getConnectedElementIDs().clear();
+	setConnectedElements(quadratic, true);
+}
 
-	size_t nElems(ele_vector.size());
+/**************************************************************************
+   MSHLib-Method:
+   Task: Pack the elements of each node into one array in node order
+         (count, then fill) and let the nodes refer to their part of it.
+         An element is taken once per node.
+**************************************************************************/
+void CFEMesh::setConnectedElements(bool quadratic, bool marked_only)
+{
+	const size_t nNodes(nod_vector.size());
+	const size_t nElems(ele_vector.size());
+
+	std::vector<size_t> offset(nNodes + 1, 0);
+	std::vector<size_t> last(nNodes, nElems);
 	for (size_t e = 0; e < nElems; e++)
+	{
+		CElem const* elem = ele_vector[e];
+		if (marked_only && !elem->GetMark()) continue;
+		const size_t nn = elem->GetNodesNumber(quadratic);
+		for (size_t i = 0; i < nn; i++)
+		{
+			const size_t n = elem->GetNodeIndex(i);
+			if (last[n] == e) continue;
+			last[n] = e;
+			offset[n + 1]++;
+		}
+	}
+	for (size_t i = 0; i < nNodes; i++)
+		offset[i + 1] += offset[i];
+
+	std::vector<size_t> elements(offset[nNodes]);
+	std::vector<size_t> pos(offset.begin(), offset.end() - 1);
+	for (size_t e = 0; e < nElems; e++)
+	{
+		CElem const* elem = ele_vector[e];
+		if (marked_only && !elem->GetMark()) continue;
+		const size_t nn = elem->GetNodesNumber(quadratic);
+		for (size_t i = 0; i < nn; i++)
+		{
+			const size_t n = elem->GetNodeIndex(i);
+			if (pos[n] > offset[n] && elements[pos[n] - 1] == e) continue;
+			elements[pos[n]++] = e;
+		}
+	}
+
+	for (size_t i = 0; i < nNodes; i++)
+		nod_vector[i]->setConnectedElementIDs(elements.data() + offset[i],
+		                                      offset[i + 1] - offset[i]);
+	_node_elements.swap(elements);
+}
+
+/**************************************************************************
+   MSHLib-Method:
+   Task: Copy the coordinates of all nodes into one array, the nodes read
+         them from there afterwards
+**************************************************************************/
+void CFEMesh::packNodeCoordinates()
+{
+	const size_t nNodes(nod_vector.size());
+	std::vector<double> coordinates(3 * nNodes);
+	for (size_t i = 0; i < nNodes; i++)
+		nod_vector[i]->bindCoordinates(coordinates.data() + 3 * i);
+	_node_coordinates.swap(coordinates);
+}
+
+namespace
+{
+/// Sorted global node indices of a local element face, returns their number
+int sortedFaceNodes(CElem* elem, int face, long* nodes)
+{
+	int face_loc[10];
+	const int n = elem->GetElementFaceNodes(face, face_loc);
+	const Math_Group::vec<long>& node_index(elem->GetNodeIndeces());
+	for (int j = 0; j < n; j++)
+		nodes[j] = node_index[face_loc[j]];
+	std::sort(nodes, nodes + n);
+	return n;
+}
+
+/// Bucket the slots 0..key.size()-1 by key (counting sort). Inside a bucket
+/// the slots keep their ascending order.
+void bucketSlots(const std::vector<long>& key, size_t n_keys,
+                 std::vector<long>& ptr, std::vector<long>& slots)
+{
+	ptr.assign(n_keys + 1, 0);
+	for (size_t s = 0; s < key.size(); s++)
+		ptr[key[s] + 1]++;
+	for (size_t i = 0; i < n_keys; i++)
+		ptr[i + 1] += ptr[i];
+	slots.resize(key.size());
+	std::vector<long> fill(ptr.begin(), ptr.end() - 1);
+	for (size_t s = 0; s < key.size(); s++)
+		slots[fill[key[s]]++] = (long)s;
+}
+}
+
+/**************************************************************************
+   MSHLib-Method:
+   Task: Set the face neighbors of all elements.
+         Element faces (slots) are bucketed by their smallest node index and
+         matched by their sorted node tuples inside a bucket, so that every
+         bucket is handled independently. Inside a group of matching faces
+         the former element order is replayed: a face without neighbor gets
+         the first other element of the group, which points back.
+**************************************************************************/
+void CFEMesh::FindNeighbors()
+{
+	const long e_size = (long)ele_vector.size();
+	std::vector<long> slot_ptr(e_size + 1, 0);
+	for (long e = 0; e < e_size; e++)
+		slot_ptr[e + 1] = slot_ptr[e] + (long)ele_vector[e]->GetFacesNumber();
+	const long n_slots = slot_ptr[e_size];
+
+	std::vector<long> slot_elem(n_slots);
+	std::vector<long> min_node(n_slots);
+#pragma omp parallel for
+	for (long e = 0; e < e_size; e++)
+	{
+		long nodes[10];
+		for (long s = slot_ptr[e]; s < slot_ptr[e + 1]; s++)
+		{
+			sortedFaceNodes(ele_vector[e], (int)(s - slot_ptr[e]), nodes);
+			min_node[s] = nodes[0];
+			slot_elem[s] = e;
+		}
+	}
+	std::vector<long> bucket_ptr, bucket;
+	bucketSlots(min_node, nod_vector.size(), bucket_ptr, bucket);
+	std::vector<long>().swap(min_node);
+
+	const long n_buckets = (long)nod_vector.size();
+#pragma omp parallel
+	{
+		std::vector<long> tuples;  // sorted face nodes, 10 per face
+		std::vector<int> n_tuple;
+		std::vector<long> group;   // first face of the group of each face
+#pragma omp for schedule(dynamic, 256)
+		for (long b = 0; b < n_buckets; b++)
+		{
+			const long m = bucket_ptr[b + 1] - bucket_ptr[b];
+			if (m < 2) continue;
+			const long* faces = &bucket[bucket_ptr[b]];
+			tuples.resize(10 * m);
+			n_tuple.resize(m);
+			group.assign(m, -1);
+			for (long k = 0; k < m; k++)
+			{
+				const long e = slot_elem[faces[k]];
+				n_tuple[k] = sortedFaceNodes(
+				    ele_vector[e], (int)(faces[k] - slot_ptr[e]), &tuples[10 * k]);
+			}
+
+			for (long k = 0; k < m; k++)
+			{
+				if (group[k] >= 0) continue;
+				group[k] = k;
+				long n_members = 1;
+				for (long l = k + 1; l < m; l++)
+					if (group[l] < 0 && n_tuple[l] == n_tuple[k] &&
+					    std::equal(&tuples[10 * k], &tuples[10 * k] + n_tuple[k],
+					               &tuples[10 * l]))
+					{
+						group[l] = k;
+						n_members++;
+					}
+				if (n_members < 2) continue;
+
+				for (long l = k; l < m; l++)
+				{
+					if (group[l] != k) continue;
+					const long e = slot_elem[faces[l]];
+					const int face = (int)(faces[l] - slot_ptr[e]);
+					CElem* elem = ele_vector[e];
+					if (elem->GetNeighbor(face)) continue;
+					for (long p = k; p < m; p++)
+					{
+						const long ee = slot_elem[faces[p]];
+						if (group[p] != k || ee == e) continue;
+						CElem* connElem = ele_vector[ee];
+						elem->SetNeighbor(face, connElem);
+						connElem->SetNeighbor((int)(faces[p] - slot_ptr[ee]),
+						                      elem);
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	// YD: 1D line neighbor element set
+#pragma omp parallel for
+	for (long e = 0; e < e_size; e++)
 	{
 		CElem* elem = ele_vector[e];
-		if (!elem->GetMark()) continue;
+		if (elem->geo_type != MshElemType::LINE) continue;
+		const Math_Group::vec<long>& node_index(elem->GetNodeIndeces());
+		const int nFaces = (int)elem->GetFacesNumber();
+		for (int i = 0; i < nFaces; i++)
+		{
+			int faceIndex_loc0[10];
+			const int n0 = elem->GetElementFaceNodes(i, faceIndex_loc0);
+			for (int k = 0; k < n0; k++)
+			{
+				IndexRange const conn_elems(
+				    nod_vector[node_index[faceIndex_loc0[k]]]
+				        ->getConnectedElementIDs());
+				if (conn_elems.size() != 2) continue;
+				for (size_t ei = 0; ei < 2; ei++)
+				{
+					CElem* connElem = ele_vector[conn_elems[ei]];
+					if (connElem->GetIndex() != elem->GetIndex())
+						elem->SetNeighbor(i, connElem);
+				}
+			}
+		}
+	}
+}
+
+/**************************************************************************
+   MSHLib-Method:
+   Task: Create the edges of all elements.
+         Element edges (slots) are bucketed by their smallest node index, an
+         edge is owned by the first slot with the same pair of end nodes.
+         The edges are numbered in the order of their owners, i.e. in the
+         order of the former element by element search.
+**************************************************************************/
+void CFEMesh::ConstructEdges(bool quadratic)
+{
+	const long e_size = (long)ele_vector.size();
+	std::vector<long> slot_ptr(e_size + 1, 0);
+	for (long e = 0; e < e_size; e++)
+		slot_ptr[e + 1] = slot_ptr[e] + (long)ele_vector[e]->GetEdgesNumber();
+	const long n_slots = slot_ptr[e_size];
+
+	// End nodes of each slot, as ordered in the element
+	std::vector<long> first_node(n_slots), second_node(n_slots);
+	std::vector<long> min_node(n_slots);
+#pragma omp parallel for
+	for (long e = 0; e < e_size; e++)
+	{
+		CElem* elem = ele_vector[e];
+		const Math_Group::vec<long>& node_index(elem->GetNodeIndeces());
+		int edgeIndex_loc[3];
+		for (long s = slot_ptr[e]; s < slot_ptr[e + 1]; s++)
+		{
+			elem->GetLocalIndicesOfEdgeNodes((int)(s - slot_ptr[e]),
+			                                 edgeIndex_loc);
+			first_node[s] = node_index[edgeIndex_loc[0]];
+			second_node[s] = node_index[edgeIndex_loc[1]];
+			min_node[s] = std::min(first_node[s], second_node[s]);
+		}
+	}
+	std::vector<long> bucket_ptr, bucket;
+	bucketSlots(min_node, nod_vector.size(), bucket_ptr, bucket);
+	std::vector<long>().swap(min_node);
+
+	std::vector<long> owner(n_slots);
+	const long n_buckets = (long)nod_vector.size();
+#pragma omp parallel for schedule(dynamic, 256)
+	for (long b = 0; b < n_buckets; b++)
+	{
+		const long* edges = &bucket[bucket_ptr[b]];
+		const long m = bucket_ptr[b + 1] - bucket_ptr[b];
+		for (long k = 0; k < m; k++)
+		{
+			const long s = edges[k];
+			const long other = std::max(first_node[s], second_node[s]);
+			owner[s] = s;
+			for (long l = 0; l < k; l++)
+			{
+				const long t = edges[l];
+				if (std::max(first_node[t], second_node[t]) == other)
+				{
+					owner[s] = owner[t];
+					break;
+				}
+			}
+		}
+	}
 
-		size_t nElemNodes(static_cast<size_t>(elem->GetNodesNumber(quadratic)));
-		for (size_t i = 0; i < nElemNodes; i++)
+	// Edge index of the owners
+	std::vector<long> edge_id(n_slots, -1);
+	long n_edges = (long)edge_vector.size();
+	for (long s = 0; s < n_slots; s++)
+		if (owner[s] == s) edge_id[s] = n_edges++;
+	edge_vector.resize(n_edges);
+
+#pragma omp parallel
+	{
+		Math_Group::vec<CNode*> e_edgeNodes0(3);
+		int edgeIndex_loc0[3];
+#pragma omp for
+		for (long e = 0; e < e_size; e++)
 		{
-			MeshLib::CNode* node(nod_vector[elem->GetNodeIndex(i)]);
-			node->getConnectedElementIDs().push_back(e);
+			CElem* elem = ele_vector[e];
+			const Math_Group::vec<long>& node_index(elem->GetNodeIndeces());
+			for (long s = slot_ptr[e]; s < slot_ptr[e + 1]; s++)
+			{
+				if (owner[s] != s) continue;
+				elem->GetLocalIndicesOfEdgeNodes((int)(s - slot_ptr[e]),
+				                                 edgeIndex_loc0);
+				CEdge* edge = new CEdge(edge_id[s]);
+				edge->SetOrder(quadratic);
+				e_edgeNodes0[0] = nod_vector[node_index[edgeIndex_loc0[0]]];
+				e_edgeNodes0[1] = nod_vector[node_index[edgeIndex_loc0[1]]];
+				if (quadratic)
+					e_edgeNodes0[2] = nod_vector[node_index[edgeIndex_loc0[2]]];
+				else
+					e_edgeNodes0[2] = NULL;
+				edge->SetNodes(e_edgeNodes0);
+				edge_vector[edge_id[s]] = edge;
+			}
+		}
+	}
+
+	// Set edges and nodes
+#pragma omp parallel
+	{
+		Math_Group::vec<CNode*> e_nodes0(20);
+		Math_Group::vec<int> Edge_Orientation(15);
+		Math_Group::vec<CEdge*> Edges0(15);
+#pragma omp for
+		for (long e = 0; e < e_size; e++)
+		{
+			CElem* elem = ele_vector[e];
+			const Math_Group::vec<long>& node_index(elem->GetNodeIndeces());
+			const size_t nnodes0(elem->GetNodesNumber(quadratic));
+			for (size_t i = 0; i < nnodes0; i++)
+				e_nodes0[i] = nod_vector[node_index[i]];
+			for (long s = slot_ptr[e]; s < slot_ptr[e + 1]; s++)
+			{
+				const long i = s - slot_ptr[e];
+				Edges0[i] = edge_vector[edge_id[owner[s]]];
+				// check direction of edge
+				Edge_Orientation[i] =
+				    (first_node[s] == first_node[owner[s]]) ? 1 : -1;
+			}
+			elem->SetEdgesOrientation(Edge_Orientation);
+			elem->SetEdges(Edges0);
+			// Resize is true
+			elem->SetNodes(e_nodes0, true);
 		}
 	}
 }
@@ -415,18 +783,8 @@ void CFEMesh::ConstructGrid()
 	ScreenMessage("---------------------------------------------\n");
 	ScreenMessage("Constructing grid ... \n");
 
-	bool done;
-
-	Math_Group::vec<CNode*> e_nodes0(20);
-	Math_Group::vec<int> Edge_Orientation(15);
-	Math_Group::vec<CEdge*> Edges(15);
-	Math_Group::vec<CEdge*> Edges0(15);
-	Math_Group::vec<CElem*> Neighbors(15);
 	Math_Group::vec<CElem*> Neighbors0(15);
 
-	Math_Group::vec<CNode*> e_edgeNodes0(3);
-	Math_Group::vec<CNode*> e_edgeNodes(3);
-
 	const bool quadratic = (NodesNumber_Quadratic != NodesNumber_Linear);
 	if (quadratic)
 		ScreenMessage("-> this mesh is quadratic.\n");
@@ -436,8 +794,7 @@ void CFEMesh::ConstructGrid()
 	NodesNumber_Linear = nod_vector.size();
 #endif
 	this->SwitchOnQuadraticNodes(quadratic);
-
-	Edge_Orientation = 1;
+	packNodeCoordinates();
 
 	// Set neighbors of node
 	// ScreenMessage2("-> Set elements connected to a node\n");
@@ -449,228 +806,23 @@ void CFEMesh::ConstructGrid()
 	// 2011-11-21 TF
 	// initializing attributes of objects - why is this not done in the
 	// constructor?
-	for (size_t e = 0; e < e_size; e++)
+#pragma omp parallel for
+	for (long e = 0; e < (long)e_size; e++)
 	{
 		ele_vector[e]->InitializeMembers();
+		ele_vector[e]->SetOrder(quadratic);
 	}
 
 	ScreenMessage2d("-> find neighbors ... \n");
-	for (size_t e = 0; e < e_size; e++)
-	{
-		//		ScreenMessage2d("[Element: %d]\n", e);
-		CElem* elem(ele_vector[e]);
-		elem->SetOrder(quadratic);
-		const Math_Group::vec<long>& node_index(elem->GetNodeIndeces());
-		elem->GetNeighbors(Neighbors0);
-
-		const size_t nnodes0(
-		    elem->GetNodesNumber(quadratic));  //(elem->nnodes); // Number of
-		// nodes for linear element
-		for (size_t i = 0; i < nnodes0; i++)  // Nodes
-			e_nodes0[i] = nod_vector[node_index[i]];
-
-		const size_t nFaces = static_cast<size_t>(elem->GetFacesNumber());
-		// neighbors
-		for (size_t i = 0; i < nFaces; i++)  // Faces
-		{
-			if (Neighbors0[i]) continue;
-
-			done = false;
-			int faceIndex_loc0[10];
-			const size_t nFaceNodes = static_cast<size_t>(
-			    elem->GetElementFaceNodes(i, faceIndex_loc0));
-			for (size_t k = 0; k < nFaceNodes; k++)  // face nodes
-			{
-				size_t const nConnElems(e_nodes0[faceIndex_loc0[k]]
-				                            ->getConnectedElementIDs()
-				                            .size());
-				for (size_t ei = 0; ei < nConnElems;
-				     ei++)  // elements connected to face node
-				{
-					size_t ee(static_cast<size_t>(
-					    e_nodes0[faceIndex_loc0[k]]
-					        ->getConnectedElementIDs()[ei]));
-					if (ee == e) continue;
-					CElem* connElem(ele_vector[ee]);
-					const Math_Group::vec<long>& node_index_glb(
-					    connElem->GetNodeIndeces());
-					connElem->GetNeighbors(Neighbors);
-					const size_t nFacesConnElem =
-					    static_cast<size_t>(connElem->GetFacesNumber());
-
-					int faceIndex_loc[10];
-					for (size_t ii = 0; ii < nFacesConnElem;
-					     ii++)  // faces of elements connected to face node
-					{
-						size_t nFaceNodesConnElem(static_cast<size_t>(
-						    connElem->GetElementFaceNodes(ii, faceIndex_loc)));
-						if (nFaceNodes != nFaceNodesConnElem) continue;
-						size_t counter(0);
-						for (size_t j = 0; j < nFaceNodes; j++)
-						{
-							for (size_t jj = 0; jj < nFaceNodesConnElem; jj++)
-								if (node_index[faceIndex_loc0[j]] ==
-								    node_index_glb[faceIndex_loc[jj]])
-								{
-									counter++;
-									break;
-								}
-						}
-						if (counter == nFaceNodesConnElem)
-						{
-							Neighbors0[i] = connElem;
-							Neighbors[ii] = elem;
-							connElem->SetNeighbor(ii, elem);
-							done = true;
-							break;
-						}
-					}
-					if (done) break;
-				}
-				if (done) break;
-			}
-		}
-		elem->SetNeighbors(Neighbors0);
-
-		if (elem->geo_type == MshElemType::LINE)  // YD
-		{
-			size_t ii(0);
-			for (size_t i = 0; i < nFaces; i++)
-			{
-				int faceIndex_loc0[10];
-				size_t n0 = elem->GetElementFaceNodes(i, faceIndex_loc0);
-				for (size_t k = 0; k < n0; k++)
-				{
-					size_t e_size_l = e_nodes0[faceIndex_loc0[k]]
-					                      ->getConnectedElementIDs()
-					                      .size();
-					for (size_t ei = 0; ei < e_size_l; ei++)
-					{
-						size_t ee = e_nodes0[faceIndex_loc0[k]]
-						                ->getConnectedElementIDs()[ei];
-						CElem* connElem = ele_vector[ee];
-						if (e_size_l == 2 &&
-						    connElem->GetIndex() != elem->GetIndex())
-						{
-							Neighbors0[i] = connElem;
-							Neighbors[ii] = connElem;
-							// thisElem->SetNeighbor(ii, thisElem0);   //?? Todo
-							// YD
-							ii++;
-						}
-					}
-				}
-			}
-			elem->SetNeighbors(Neighbors0);
-		}
-		// --------------------------------
+	BaseLib::RunTime run_time;
+	run_time.start();
+	FindNeighbors();
+	ScreenMessage("-> neighbors found in %g s\n", run_time.elapsed());
 
-		// Edges
-		const size_t nedges0(elem->GetEdgesNumber());
-		elem->GetEdges(Edges0);
-		const size_t nEdgeNodes = quadratic ? 3 : 2;
-		for (size_t i = 0; i < nedges0; i++)  // edges
-		{
-			int edgeIndex_loc0[3];
-			elem->GetLocalIndicesOfEdgeNodes(i, edgeIndex_loc0);
-			//			{
-			//				std::stringstream ss; for (size_t k = 0; k <
-			//nEdgeNodes;
-			// k++) ss << e_nodes0[edgeIndex_loc0[k]]->GetIndex() << " ";
-			//				ScreenMessage2d("\t edge %d: %s\n", i,
-			// ss.str().c_str());
-			//			}
-			// Check neighbors
-			done = false;
-			for (size_t k = 0; k < nEdgeNodes;
-			     k++)  // beginning and end of edge
-			{
-				CNode* work_node = e_nodes0[edgeIndex_loc0[k]];
-				const size_t nConnElem(
-				    work_node->getConnectedElementIDs().size());
-				for (size_t ei = 0; ei < nConnElem;
-				     ei++)  // elements connected to edge node
-				{
-					size_t ee(work_node->getConnectedElementIDs()[ei]);
-					if (ee == e) continue;
-					//					ScreenMessage2d("\t -> check connecting
-					//element
-					//%d: \n", i);
-					CElem* connElem(ele_vector[ee]);
-					const Math_Group::vec<long>& node_index_glb(
-					    connElem->GetNodeIndeces());
-					const size_t nedges(connElem->GetEdgesNumber());
-					connElem->GetEdges(Edges);
-					// Edges of neighbors
-					int edgeIndex_loc[3];
-					for (size_t ii = 0; ii < nedges;
-					     ii++)  // edges of element connected to edge node
-					{
-						connElem->GetLocalIndicesOfEdgeNodes(ii, edgeIndex_loc);
-						//						{
-						//							std::stringstream ss; for (size_t kk
-						//=
-						// 0; kk < nEdgeNodes; kk++) ss <<
-						// node_index_glb[edgeIndex_loc[kk]] << " ";
-						//							ScreenMessage2d("\t edge %d: %s\n",
-						//ii,
-						// ss.str().c_str());
-						//						}
-
-						if ((node_index[edgeIndex_loc0[0]] ==
-						         node_index_glb[edgeIndex_loc[0]] &&
-						     node_index[edgeIndex_loc0[1]] ==
-						         node_index_glb[edgeIndex_loc[1]]) ||
-						    (node_index[edgeIndex_loc0[0]] ==
-						         node_index_glb[edgeIndex_loc[1]] &&
-						     node_index[edgeIndex_loc0[1]] ==
-						         node_index_glb[edgeIndex_loc[0]]))  // check if
-						                                             // elements
-						                                             // share
-						                                             // edge
-						{
-							if (Edges[ii])
-							{
-								Edges0[i] = Edges[ii];
-								Edges[ii]->GetNodes(e_edgeNodes);
-								if ((size_t)node_index[edgeIndex_loc0[0]] ==
-								        e_edgeNodes[1]->GetIndex() &&
-								    (size_t)node_index[edgeIndex_loc0[1]] ==
-								        e_edgeNodes[0]
-								            ->GetIndex())  // check direction of
-									                       // edge
-									Edge_Orientation[i] = -1;
-								done = true;
-								break;
-							}
-						}
-					}  //  for(ii=0; ii<nedges; ii++)
-					if (done) break;
-				}  // for(ei=0; ei<e_size_l; ei++)
-				if (done) break;
-			}           // for(k=0;k<2;k++)
-			if (!done)  // new edges and new node
-			{
-				Edges0[i] = new CEdge((long)edge_vector.size());
-				Edges0[i]->SetOrder(quadratic);
-				e_edgeNodes0[0] = e_nodes0[edgeIndex_loc0[0]];
-				e_edgeNodes0[1] = e_nodes0[edgeIndex_loc0[1]];
-				if (quadratic)
-					e_edgeNodes0[2] = e_nodes0[edgeIndex_loc0[2]];
-				else
-					e_edgeNodes0[2] = NULL;
-				Edges0[i]->SetNodes(e_edgeNodes0);
-				edge_vector.push_back(Edges0[i]);
-			}  // new edges
-		}      //  for(i=0; i<nedges0; i++)
-		       //
-		       // Set edges and nodes
-		elem->SetOrder(quadratic);
-		elem->SetEdgesOrientation(Edge_Orientation);
-		elem->SetEdges(Edges0);
-		// Resize is true
-		elem->SetNodes(e_nodes0, true);
-	}  // Over elements
+	run_time.start();
+	ConstructEdges(quadratic);
+	ScreenMessage("-> %d edges constructed in %g s\n", edge_vector.size(),
+	              run_time.elapsed());
 
 	// Set faces on surfaces and others
 	_msh_n_lines = 0;  // Should be members of mesh
@@ -841,16 +993,7 @@ void CFEMesh::ConstructGrid()
 	// For sparse matrix
 	ConnectedNodes(false);
 	//
-	e_nodes0.resize(0);
-	//	node_index_glb.resize(0);
-	//	node_index_glb0.resize(0);
-	Edge_Orientation.resize(0);
-	Edges.resize(0);
-	Edges0.resize(0);
-	Neighbors.resize(0);
 	Neighbors0.resize(0);
-	e_edgeNodes0.resize(0);
-	e_edgeNodes.resize(0);
 
 	ScreenMessage2d("-> computeSearchLength ... \n");
 	computeSearchLength();
@@ -890,28 +1033,8 @@ void CFEMesh::GenerateHighOrderNodes()
 
 	// Set neighbors of node. All elements, even in deactivated subdomains, are
 	// taken into account here.
-	for (size_t e = 0; e < nod_vector.size(); e++)
-		nod_vector[e]->getConnectedElementIDs().clear();
+	setConnectedElements(false, false);
 	bool done = false;
-	size_t ele_vector_size(ele_vector.size());
-	for (size_t e = 0; e < ele_vector_size; e++)
-	{
-		CElem* thisElem0 = ele_vector[e];
-		for (size_t i = 0; i < thisElem0->GetNodesNumber(false); i++)
-		{
-			done = false;
-			long ni = thisElem0->GetNodeIndex(i);
-			size_t n_connected_elements(
-			    nod_vector[ni]->getConnectedElementIDs().size());
-			for (size_t j = 0; j < n_connected_elements; j++)
-				if (e == nod_vector[ni]->getConnectedElementIDs()[j])
-				{
-					done = true;
-					break;
-				}
-			if (!done) nod_vector[ni]->getConnectedElementIDs().push_back(e);
-		}
-	}
 	//
 	CNode* aNode = NULL;
 	Math_Group::vec<CNode*> e_nodes0(20);
@@ -1111,22 +1234,9 @@ void CFEMesh::GenerateHighOrderNodes()
 #endif
 		Eqs2Global_NodeIndex.push_back(nod_vector[e]->GetIndex()); //TODO Eqs2Global_NodeIndex_Q
 	}
-	for (size_t e = 0; e < e_size; e++)
-	{
-		thisElem0 = ele_vector[e];
-		for (int i = thisElem0->nnodes; i < thisElem0->nnodesHQ; i++)
-		{
-			done = false;
-			aNode = thisElem0->GetNode(i);
-			for (int k = 0; k < (int)aNode->getConnectedElementIDs().size(); k++)
-				if (e == aNode->getConnectedElementIDs()[k])
-				{
-					done = true;
-					break;
-				}
-			if (!done) aNode->getConnectedElementIDs().push_back(e);
-		}
-	}
+	packNodeCoordinates();
+	// All elements of the linear and the middle nodes
+	setConnectedElements(true, false);
 
 	// For sparse matrix
 	ConnectedNodes(true);
@@ -2403,25 +2513,34 @@ void CFEMesh::SetActiveElements(std::vector<long>&elements_active)
 void CFEMesh::ConnectedNodes(bool quadratic)
 {
 #define noTestConnectedNodes
-	for (CNode* nod : nod_vector)
+	// Neighbours found so far and those of the elements, sorted and unique,
+	// packed node by node
+	const size_t nNodes(nod_vector.size());
+	std::vector<size_t> offset(nNodes + 1, 0);
+	std::vector<size_t> nodes;
+	nodes.reserve(_node_nodes.size());
+	for (size_t i = 0; i < nNodes; i++)
 	{
+		CNode const* nod = nod_vector[i];
+		IndexRange const found(nod->getConnectedNodes());
+		nodes.insert(nodes.end(), found.begin(), found.end());
 		for (size_t ele_id : nod->getConnectedElementIDs())
 		{
-			CElem* ele = ele_vector[ele_id];
+			CElem const* ele = ele_vector[ele_id];
 			for (size_t l = 0; l < ele->GetNodesNumber(quadratic); l++)
 				if ((size_t)ele->GetNodeIndex(l) != nod->GetIndex())
-					nod->getConnectedNodes().push_back(ele->GetNodeIndex(l));
+					nodes.push_back(ele->GetNodeIndex(l));
 		}
+		std::sort(nodes.begin() + offset[i], nodes.end());
+		nodes.erase(std::unique(nodes.begin() + offset[i], nodes.end()),
+		            nodes.end());
+		offset[i + 1] = nodes.size();
 	}
 
-	// Sorting, unique
-	for (size_t i = 0; i < nod_vector.size(); i++)
-	{
-		CNode* nod = nod_vector[i];
-		std::vector<size_t> &vec_nodes(nod->getConnectedNodes());
-		std::sort(vec_nodes.begin(), vec_nodes.end());
-		vec_nodes.erase(std::unique(vec_nodes.begin(), vec_nodes.end()), vec_nodes.end());
-	}
+	for (size_t i = 0; i < nNodes; i++)
+		nod_vector[i]->setConnectedNodes(nodes.data() + offset[i],
+		                                 offset[i + 1] - offset[i]);
+	_node_nodes.swap(nodes);
 //----------------------------------------------------------------------
 #ifdef TestConnectedNodes
 	for (i = 0; i < (long)nod_vector.size(); i++)
@@ -2435,6 +2554,144 @@ void CFEMesh::ConnectedNodes(bool quadratic)
 #endif
 }
 
+#if !defined(USE_PETSC)
+namespace
+{
+/// Bandwidth and profile (sum of the row widths left of the diagonal) of
+/// the linear nodes numbered with eqs
+void getBandwidthAndProfile(const std::vector<MeshLib::CNode*>& nodes,
+                            const std::vector<long>& eqs, long& bandwidth,
+                            long& profile)
+{
+	const size_t n = eqs.size();
+	bandwidth = 0;
+	profile = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		long lowest = eqs[i];
+		IndexRange const connected(nodes[i]->getConnectedNodes());
+		for (size_t j = 0; j < connected.size(); j++)
+			if (connected[j] < n) lowest = std::min(lowest, eqs[connected[j]]);
+		bandwidth = std::max(bandwidth, eqs[i] - lowest);
+		profile += eqs[i] - lowest;
+	}
+}
+}
+
+/**************************************************************************
+   MSHLib-Method:
+   Task: Reverse Cuthill-McKee numbering of the equations of the linear
+         nodes. Each connected part starts from a pseudo-peripheral node
+         (George and Liu); the neighbours of a node are numbered by
+         increasing degree. The new numbering is only taken if it reduces
+         the profile.
+**************************************************************************/
+bool CFEMesh::RenumberEquations()
+{
+	const size_t n = GetNodesNumber(false);
+	std::vector<size_t> degree(n, 0);
+	std::vector<long> eqs_old(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		IndexRange const connected(nod_vector[i]->getConnectedNodes());
+		for (size_t j = 0; j < connected.size(); j++)
+			if (connected[j] < n) degree[i]++;
+		eqs_old[i] = nod_vector[i]->GetEquationIndex();
+	}
+
+	std::vector<size_t> order;
+	order.reserve(n);
+	std::vector<bool> numbered(n, false);
+	std::vector<long> level(n, -1);
+	std::vector<size_t> part, next;
+	for (size_t start = 0; start < n; start++)
+	{
+		if (numbered[start]) continue;
+		// Pseudo-peripheral node: root of the deepest level structure
+		size_t root = start, candidate = start;
+		long depth = -1;
+		while (true)
+		{
+			part.assign(1, candidate);
+			level[candidate] = 0;
+			for (size_t k = 0; k < part.size(); k++)
+			{
+				IndexRange const connected(
+				    nod_vector[part[k]]->getConnectedNodes());
+				for (size_t j = 0; j < connected.size(); j++)
+				{
+					const size_t m = connected[j];
+					if (m >= n || level[m] >= 0) continue;
+					level[m] = level[part[k]] + 1;
+					part.push_back(m);
+				}
+			}
+			const long candidate_depth = level[part.back()];
+			// Node of minimum degree in the last level
+			size_t last = part.back();
+			for (size_t k = part.size(); k > 0 && level[part[k - 1]] ==
+			                                          candidate_depth;
+			     k--)
+				if (degree[part[k - 1]] < degree[last]) last = part[k - 1];
+			for (size_t k = 0; k < part.size(); k++)
+				level[part[k]] = -1;
+			if (candidate_depth <= depth) break;
+			depth = candidate_depth;
+			root = candidate;
+			candidate = last;
+		}
+
+		// Cuthill-McKee: breadth-first, neighbours by increasing degree
+		size_t k = order.size();
+		order.push_back(root);
+		numbered[root] = true;
+		for (; k < order.size(); k++)
+		{
+			next.clear();
+			IndexRange const connected(
+			    nod_vector[order[k]]->getConnectedNodes());
+			for (size_t j = 0; j < connected.size(); j++)
+			{
+				const size_t m = connected[j];
+				if (m >= n || numbered[m]) continue;
+				numbered[m] = true;
+				next.push_back(m);
+			}
+			std::stable_sort(next.begin(), next.end(),
+			                 [&degree](size_t a, size_t b)
+			                 { return degree[a] < degree[b]; });
+			order.insert(order.end(), next.begin(), next.end());
+		}
+	}
+	std::reverse(order.begin(), order.end());
+
+	std::vector<long> eqs_new(n);
+	for (size_t k = 0; k < n; k++)
+		eqs_new[order[k]] = static_cast<long>(k);
+
+	long bandwidth_old, profile_old, bandwidth_new, profile_new;
+	getBandwidthAndProfile(nod_vector, eqs_old, bandwidth_old, profile_old);
+	getBandwidthAndProfile(nod_vector, eqs_new, bandwidth_new, profile_new);
+	ScreenMessage("-> Equation numbering: bandwidth %ld, profile %ld\n",
+	              bandwidth_old, profile_old);
+	ScreenMessage("-> Reverse Cuthill-McKee: bandwidth %ld, profile %ld\n",
+	              bandwidth_new, profile_new);
+	if (profile_new >= profile_old)
+	{
+		ScreenMessage("-> The numbering of the equations is kept\n");
+		return false;
+	}
+
+	Eqs2Global_NodeIndex.assign(n, 0);
+	for (size_t k = 0; k < n; k++)
+	{
+		nod_vector[order[k]]->SetEquationIndex(static_cast<long>(k));
+		Eqs2Global_NodeIndex[k] = static_cast<long>(order[k]);
+	}
+	return true;
+}
+#endif
+
 /**************************************************************************
    FEMLib-Method:
    Task:  Renumbering nodes corresponding to the activiate of elements
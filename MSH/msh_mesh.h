@@ -425,7 +425,15 @@ public:
 	std::vector<long> Eqs2Global_NodeIndex_Q;
 
 	void ConnectedNodes(bool quadratic);
+	/// Elements of the nodes, only marked (active) elements are taken
 	void ConnectedElements2Node(bool quadratic = false);
+#if !defined(USE_PETSC)
+	/// Number the equations of the linear nodes in reverse Cuthill-McKee
+	/// order, which reduces the profile of the equation system. The node
+	/// ids are not changed. Returns false if the ordering is kept.
+	bool RenumberEquations();
+#endif
+
 	void FaceNormal();
 
 	std::vector<std::string> mat_names_vector;
@@ -511,15 +519,46 @@ private:
 public:
 	std::vector<GridsTopo*> grid_neighbors;
 private:
+	/// Face neighbors of all elements, used by ConstructGrid()
+	void FindNeighbors();
+	/// Edges of all elements, used by ConstructGrid()
+	void ConstructEdges(bool quadratic);
 	void CreateLineElementsFromMarkedEdges(
 	    CFEMesh* m_msh_ply,
 	    std::vector<long>& ele_vector_at_ply);
+	/// Copies the coordinates of all nodes into _node_coordinates
+	void packNodeCoordinates();
+	/// Packs the elements of each node into _node_elements
+	void setConnectedElements(bool quadratic, bool marked_only);
 public:
 	void constructMeshGrid();
 
 private:
 	GEOLIB::Grid<MeshLib::CNode>* _mesh_grid;
 
+	// Nodes and elements read by Read() are constructed in place in these
+	// contiguous blocks; nod_vector and ele_vector only point into them.
+	MeshLib::CNode* _node_pool;
+	size_t _n_pooled_nodes;
+	MeshLib::CElem* _elem_pool;
+	size_t _n_pooled_elems;
+
+	// The coordinates (x, y, z per node) and the elements and neighbour
+	// nodes of the nodes, packed in node order. CNode::getData(),
+	// getConnectedElementIDs() and getConnectedNodes() read from here.
+	std::vector<double> _node_coordinates;
+	std::vector<size_t> _node_elements;
+	std::vector<size_t> _node_nodes;
+
+	bool isPooled(MeshLib::CNode const* node) const
+	{
+		return node >= _node_pool && node < _node_pool + _n_pooled_nodes;
+	}
+	bool isPooled(MeshLib::CElem const* elem) const
+	{
+		return elem >= _elem_pool && elem < _elem_pool + _n_pooled_elems;
+	}
+
 #ifdef USE_PETSC
 public:
 	std::size_t getLocalNodeID(std::size_t global_id) const
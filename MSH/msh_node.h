@@ -18,6 +18,30 @@
 
 namespace MeshLib
 {
+/// Read-only view of a contiguous range of indices, e.g. the elements or the
+/// neighbour nodes of a node stored in the packed arrays of the mesh.
+class IndexRange
+{
+public:
+	IndexRange() : _data(NULL), _size(0) {}
+	IndexRange(size_t const* data, size_t size) : _data(data), _size(size) {}
+
+	size_t size() const { return _size; }
+	bool empty() const { return _size == 0; }
+	size_t operator[](size_t i) const
+	{
+		assert(i < _size);
+		return _data[i];
+	}
+	size_t front() const { return (*this)[0]; }
+	size_t back() const { return (*this)[_size - 1]; }
+	size_t const* begin() const { return _data; }
+	size_t const* end() const { return _data + _size; }
+
+private:
+	size_t const* _data;
+	size_t _size;
+};
 
 class CNode : public CCore
 {
@@ -41,6 +65,8 @@ public:
 	CNode(size_t Index, double const* coordinates);
 	CNode(size_t Index, const CNode* parent);  // NW
 	~CNode() {}
+	// The coordinates may live in the array of the mesh
+	CNode(const CNode&) = delete;
 
 	// Operator
 	void operator=(const CNode& n);
@@ -99,6 +125,17 @@ public:
 
 	void SetCoordinates(const double* argCoord);
 
+	/** Moves the coordinates into storage (3 doubles), which has to live
+	 *  as long as the node. Used by CFEMesh to pack all node coordinates.
+	 */
+	void bindCoordinates(double* storage)
+	{
+		storage[0] = coordinate[0];
+		storage[1] = coordinate[1];
+		storage[2] = coordinate[2];
+		coordinate = storage;
+	}
+
 	int GetEquationIndex(bool quadratic = false) const { return !quadratic ? eqs_index : eqs_index_quadratic; }
 
 	void SetEquationIndex(long eqIndex, bool quadratic = false)
@@ -126,32 +163,31 @@ public:
 	// Output
 	void Write(std::ostream& os = std::cout) const;
 
-	std::vector<size_t> const& getConnectedElementIDs() const
-	{
-		return _connected_elements;
-	}
+	/// Elements of this node, set by CFEMesh::ConnectedElements2Node()
+	IndexRange getConnectedElementIDs() const { return _connected_elements; }
+	/// Neighbour nodes of this node, set by CFEMesh::ConnectedNodes()
+	IndexRange getConnectedNodes() const { return _connected_nodes; }
+
+	size_t getNumConnectedNodes() const { return _connected_nodes.size(); }
 
-	std::vector<size_t>& getConnectedElementIDs()
+	void setConnectedElementIDs(size_t const* elements, size_t n)
 	{
-		return _connected_elements;
+		_connected_elements = IndexRange(elements, n);
 	}
-
-	std::vector<size_t> const& getConnectedNodes() const
+	void setConnectedNodes(size_t const* nodes, size_t n)
 	{
-		return _connected_nodes;
+		_connected_nodes = IndexRange(nodes, n);
 	}
 
-	std::vector<size_t>& getConnectedNodes() { return _connected_nodes; }
-
-	size_t getNumConnectedNodes() const { return _connected_nodes.size(); }
-
 private:
-	double coordinate[3];
+	// Points to _coordinate or into the coordinate array of the mesh
+	double* coordinate = _coordinate;
+	double _coordinate[3];
 	long global_index = -1;
 	long eqs_index = -1;
 	long eqs_index_quadratic = -1;
-	std::vector<size_t> _connected_nodes;
-	std::vector<size_t> _connected_elements;
+	IndexRange _connected_nodes;
+	IndexRange _connected_elements;
 };
 
 std::ostream& operator<<(std::ostream& os, MeshLib::CNode const& node);
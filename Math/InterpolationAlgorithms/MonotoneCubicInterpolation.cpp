@@ -0,0 +1,97 @@
+/*
+ * MonotoneCubicInterpolation.cpp
+ *
+ * \copyright
+ * Copyright (c) 2015, OpenGeoSys Community (http://www.opengeosys.org)
+ *            Distributed under a Modified BSD License.
+ *              See accompanying file LICENSE.txt or
+ *              http://www.opengeosys.org/project/license
+ */
+
+#include "MonotoneCubicInterpolation.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace MathLib
+{
+const std::size_t MonotoneCubicInterpolation::_outside_left =
+    std::numeric_limits<std::size_t>::max();
+const std::size_t MonotoneCubicInterpolation::_outside_right =
+    std::numeric_limits<std::size_t>::max() - 1;
+
+MonotoneCubicInterpolation::MonotoneCubicInterpolation(
+    const std::vector<double>& supporting_points,
+    const std::vector<double>& values_at_supp_pnts)
+    : _x(supporting_points), _y(values_at_supp_pnts), _d(_x.size(), 0.)
+{
+	computeSlopes();
+}
+
+void MonotoneCubicInterpolation::computeSlopes()
+{
+	const std::size_t n = _x.size();
+	if (n < 2) return;
+	std::vector<double> h(n - 1), delta(n - 1);
+	for (std::size_t i = 0; i < n - 1; i++)
+	{
+		h[i] = _x[i + 1] - _x[i];
+		delta[i] = (_y[i + 1] - _y[i]) / h[i];
+	}
+	if (n == 2)
+	{
+		_d[0] = _d[1] = delta[0];
+		return;
+	}
+
+	// Interior points: weighted harmonic mean, zero at local extrema
+	for (std::size_t i = 1; i < n - 1; i++)
+	{
+		if (delta[i - 1] * delta[i] <= 0.)
+		{
+			_d[i] = 0.;
+			continue;
+		}
+		const double w1 = 2. * h[i] + h[i - 1];
+		const double w2 = h[i] + 2. * h[i - 1];
+		_d[i] = (w1 + w2) / (w1 / delta[i - 1] + w2 / delta[i]);
+	}
+
+	// End points: shape preserving three-point formula
+	for (int end = 0; end < 2; end++)
+	{
+		const std::size_t i0 = end ? n - 2 : 0;  // adjacent interval
+		const std::size_t i1 = end ? n - 3 : 1;  // next interval
+		const std::size_t k = end ? n - 1 : 0;
+		double d = ((2. * h[i0] + h[i1]) * delta[i0] - h[i0] * delta[i1]) /
+		           (h[i0] + h[i1]);
+		if (d * delta[i0] <= 0.)
+			d = 0.;
+		else if (delta[i0] * delta[i1] <= 0. &&
+		         std::fabs(d) > std::fabs(3. * delta[i0]))
+			d = 3. * delta[i0];
+		_d[k] = d;
+	}
+}
+
+std::size_t MonotoneCubicInterpolation::getInterval(double x) const
+{
+	if (!(x > _x.front())) return _outside_left;
+	if (!(x < _x.back())) return _outside_right;
+	const std::size_t i =
+	    std::upper_bound(_x.begin(), _x.end(), x) - _x.begin();
+	return i - 1;
+}
+
+void MonotoneCubicInterpolation::getValues(std::size_t n, const double* x,
+                                           double* values,
+                                           double* derivatives) const
+{
+	if (derivatives)
+		for (std::size_t k = 0; k < n; k++)
+			values[k] = getValue(x[k], derivatives[k]);
+	else
+		for (std::size_t k = 0; k < n; k++)
+			values[k] = getValue(x[k]);
+}
+}  // end namespace MathLib
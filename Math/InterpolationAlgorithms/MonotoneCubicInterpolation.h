@@ -0,0 +1,183 @@
+/*
+ * MonotoneCubicInterpolation.h
+ *
+ * \copyright
+ * Copyright (c) 2015, OpenGeoSys Community (http://www.opengeosys.org)
+ *            Distributed under a Modified BSD License.
+ *              See accompanying file LICENSE.txt or
+ *              http://www.opengeosys.org/project/license
+ */
+
+#ifndef MONOTONECUBICINTERPOLATION_H_
+#define MONOTONECUBICINTERPOLATION_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace MathLib
+{
+/**
+ * \brief Shape preserving piecewise cubic Hermite interpolation (PCHIP).
+ *
+ * The slopes at the supporting points are computed as in Fritsch & Carlson
+ * (weighted harmonic mean of the neighbouring secants), so the interpolant is
+ * monotone on every interval where the data are monotone and has no
+ * overshoots. It is C1, the derivative is evaluated analytically. Outside of
+ * the supporting points the end values are returned (derivative zero).
+ */
+class MonotoneCubicInterpolation
+{
+public:
+	MonotoneCubicInterpolation(const std::vector<double>& supporting_points,
+	                           const std::vector<double>& values_at_supp_pnts);
+
+	/**
+	 * Sample f on [a, b] and bisect every interval where the interpolant
+	 * deviates from f by more than
+	 * rel_tol * max(|f|, 1e-6 * max|f|) at 1/4, 1/2 or 3/4 of the interval.
+	 * @param max_points upper limit of supporting points
+	 * @param max_rel_error if given, the largest relative deviation found
+	 * at the check points of the final interpolant
+	 * @return NULL if the tolerance is not reached with max_points points
+	 */
+	template <typename F>
+	static MonotoneCubicInterpolation* createAdaptive(
+	    F& f, double a, double b, double rel_tol, std::size_t max_points,
+	    double* max_rel_error = NULL);
+
+	double getValue(double x) const
+	{
+		const std::size_t i = getInterval(x);
+		if (i == _outside_left) return _y.front();
+		if (i == _outside_right) return _y.back();
+		return evaluate(i, x, NULL);
+	}
+
+	/// Value and derivative at x
+	double getValue(double x, double& derivative) const
+	{
+		const std::size_t i = getInterval(x);
+		derivative = 0.;
+		if (i == _outside_left) return _y.front();
+		if (i == _outside_right) return _y.back();
+		return evaluate(i, x, &derivative);
+	}
+
+	/// Values (and derivatives if not NULL) at n points
+	void getValues(std::size_t n, const double* x, double* values,
+	               double* derivatives = NULL) const;
+
+	double getSupportMin() const { return _x.front(); }
+	double getSupportMax() const { return _x.back(); }
+	std::size_t getNumberOfSupportingPoints() const { return _x.size(); }
+
+private:
+	void computeSlopes();
+
+	/// Index i of the interval [x_i, x_i+1] containing x
+	std::size_t getInterval(double x) const;
+
+	double evaluate(std::size_t i, double x, double* derivative) const
+	{
+		const double h = _x[i + 1] - _x[i];
+		const double t = (x - _x[i]) / h;
+		const double dy = _y[i + 1] - _y[i];
+		const double d0 = _d[i] * h, d1 = _d[i + 1] * h;
+		// Hermite form y0 + t*(d0 + t*(c2 + t*c3))
+		const double c2 = 3. * dy - 2. * d0 - d1;
+		const double c3 = d0 + d1 - 2. * dy;
+		if (derivative)
+			*derivative = (d0 + t * (2. * c2 + 3. * t * c3)) / h;
+		return _y[i] + t * (d0 + t * (c2 + t * c3));
+	}
+
+	static const std::size_t _outside_left;
+	static const std::size_t _outside_right;
+
+	std::vector<double> _x;
+	std::vector<double> _y;
+	std::vector<double> _d;
+};
+
+template <typename F>
+MonotoneCubicInterpolation* MonotoneCubicInterpolation::createAdaptive(
+    F& f, double a, double b, double rel_tol, std::size_t max_points,
+    double* max_rel_error)
+{
+	const std::size_t n_start = 17;
+	std::vector<double> x(n_start), y(n_start);
+	for (std::size_t i = 0; i < n_start; i++)
+	{
+		x[i] = (i == n_start - 1) ? b : a + (b - a) * i / (n_start - 1);
+		y[i] = f(x[i]);
+		if (!std::isfinite(y[i])) return NULL;
+	}
+
+	const double check_points[3] = {0.25, 0.5, 0.75};
+	while (true)
+	{
+		MonotoneCubicInterpolation* interpolation =
+		    new MonotoneCubicInterpolation(x, y);
+		double f_max = 0.;
+		for (std::size_t i = 0; i < y.size(); i++)
+			f_max = std::max(f_max, std::fabs(y[i]));
+		const double f_floor =
+		    std::max(1.e-6 * f_max, std::numeric_limits<double>::min());
+
+		std::vector<double> new_x, new_y;
+		double err_max = 0.;
+		for (std::size_t i = 0; i + 1 < x.size(); i++)
+		{
+			bool refine = false;
+			for (int k = 0; k < 3; k++)
+			{
+				const double xk = x[i] + check_points[k] * (x[i + 1] - x[i]);
+				const double fk = f(xk);
+				if (!std::isfinite(fk))
+				{
+					delete interpolation;
+					return NULL;
+				}
+				const double err =
+				    std::fabs(interpolation->evaluate(i, xk, NULL) - fk) /
+				    std::max(std::fabs(fk), f_floor);
+				if (!(err <= rel_tol)) refine = true;
+				err_max = std::max(err_max, err);
+			}
+			new_x.push_back(x[i]);
+			new_y.push_back(y[i]);
+			// Stop bisection at the resolution of double
+			const double xm = 0.5 * (x[i] + x[i + 1]);
+			if (refine && xm > x[i] && xm < x[i + 1])
+			{
+				new_x.push_back(xm);
+				new_y.push_back(f(xm));
+				if (!std::isfinite(new_y.back()))
+				{
+					delete interpolation;
+					return NULL;
+				}
+			}
+		}
+		new_x.push_back(x.back());
+		new_y.push_back(y.back());
+
+		if (new_x.size() == x.size())
+		{
+			if (max_rel_error) *max_rel_error = err_max;
+			if (err_max <= rel_tol) return interpolation;
+			delete interpolation;
+			return NULL;
+		}
+		delete interpolation;
+		if (new_x.size() > max_points) return NULL;
+		x.swap(new_x);
+		y.swap(new_y);
+	}
+}
+}  // end namespace MathLib
+
+#endif /* MONOTONECUBICINTERPOLATION_H_ */
@@ -10,10 +10,18 @@
  *              http://www.opengeosys.org/project/license
  */
 
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include <sstream>
 #include <vector>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "StringTools.h"
 #include "LinearFunctionData.h"
 
@@ -21,8 +29,160 @@
 using namespace std;
 
 #if 1
-ExprtTkFunction::ExprtTkFunction(const std::string& str_expression)
-    : _exp_str(str_expression)
+namespace
+{
+/// Affine form c[0]+c[1]*x+c[2]*y+c[3]*z
+struct Affine
+{
+	double c[4];
+	bool isConstant() const { return c[1] == 0. && c[2] == 0. && c[3] == 0.; }
+};
+
+/**
+   Recursive descent parser for expressions built from numbers, x, y, z,
+   +, -, * and / with constant factors and divisors, and parentheses. Any
+   other construct (functions, constants, powers, implicit multiplication)
+   makes the expression non-affine.
+ */
+class AffineParser
+{
+public:
+	explicit AffineParser(const std::string& str) : _str(str), _pos(0) {}
+
+	bool parse(Affine& f)
+	{
+		if (!expression(f)) return false;
+		skipSpaces();
+		return _pos == _str.size();
+	}
+
+private:
+	void skipSpaces()
+	{
+		while (_pos < _str.size() && std::isspace(_str[_pos]))
+			_pos++;
+	}
+
+	bool accept(char c)
+	{
+		skipSpaces();
+		if (_pos < _str.size() && _str[_pos] == c)
+		{
+			_pos++;
+			return true;
+		}
+		return false;
+	}
+
+	bool expression(Affine& f)
+	{
+		if (!term(f)) return false;
+		while (true)
+		{
+			double sign;
+			if (accept('+'))
+				sign = 1.;
+			else if (accept('-'))
+				sign = -1.;
+			else
+				return true;
+			Affine g;
+			if (!term(g)) return false;
+			for (int i = 0; i < 4; i++)
+				f.c[i] += sign * g.c[i];
+		}
+	}
+
+	bool term(Affine& f)
+	{
+		if (!factor(f)) return false;
+		while (true)
+		{
+			const bool is_mult = accept('*');
+			if (!is_mult && !accept('/')) return true;
+			Affine g;
+			if (!factor(g)) return false;
+			if (is_mult)
+			{
+				if (g.isConstant())
+					scale(f, g.c[0]);
+				else if (f.isConstant())
+				{
+					const double a = f.c[0];
+					f = g;
+					scale(f, a);
+				}
+				else
+					return false;
+			}
+			else
+			{
+				if (!g.isConstant() || g.c[0] == 0.) return false;
+				for (int i = 0; i < 4; i++)
+					f.c[i] /= g.c[0];
+			}
+		}
+	}
+
+	bool factor(Affine& f)
+	{
+		f.c[0] = f.c[1] = f.c[2] = f.c[3] = 0.;
+		if (accept('+')) return factor(f);
+		if (accept('-'))
+		{
+			if (!factor(f)) return false;
+			scale(f, -1.);
+			return true;
+		}
+		if (accept('('))
+			return expression(f) && accept(')');
+
+		skipSpaces();
+		if (_pos == _str.size()) return false;
+		const char c = static_cast<char>(std::tolower(_str[_pos]));
+		if (c == 'x' || c == 'y' || c == 'z')
+		{
+			_pos++;
+			f.c[1 + c - 'x'] = 1.;
+		}
+		else if (std::isdigit(_str[_pos]) || c == '.')
+		{
+			const std::size_t begin = _pos;
+			while (_pos < _str.size() &&
+			       (std::isdigit(_str[_pos]) || _str[_pos] == '.'))
+				_pos++;
+			if (_pos < _str.size() && std::tolower(_str[_pos]) == 'e')
+			{
+				_pos++;
+				if (_pos < _str.size() && (_str[_pos] == '+' || _str[_pos] == '-'))
+					_pos++;
+				while (_pos < _str.size() && std::isdigit(_str[_pos]))
+					_pos++;
+			}
+			const std::string number(_str.substr(begin, _pos - begin));
+			char* end;
+			f.c[0] = std::strtod(number.c_str(), &end);
+			if (*end != '\0') return false;
+		}
+		else
+			return false;
+		// e.g. 2x or xy
+		return _pos == _str.size() || !std::isalnum(_str[_pos]);
+	}
+
+	static void scale(Affine& f, double a)
+	{
+		for (int i = 0; i < 4; i++)
+			f.c[i] *= a;
+	}
+
+	const std::string& _str;
+	std::size_t _pos;
+};
+}
+
+ExprtTkFunction::Evaluator::Evaluator(const std::string& str_expression)
+    : _x(0.), _y(0.), _z(0.)
 {
 	symbol_table.add_constants();
 	symbol_table.add_variable("x", _x);
@@ -32,10 +192,10 @@ ExprtTkFunction::ExprtTkFunction(const std::string& str_expression)
 	expression.register_symbol_table(symbol_table);
 	parser_t parser;
 
-	if (!parser.compile(_exp_str, expression))
+	if (!parser.compile(str_expression, expression))
 	{
 		ScreenMessage("Error: %s\tExpression: %s\n", parser.error().c_str(),
-		              _exp_str.c_str());
+		              str_expression.c_str());
 		std::exit(0);
 		//           for (std::size_t i = 0; i < parser.error_count(); ++i)
 		//           {
@@ -51,12 +211,90 @@ ExprtTkFunction::ExprtTkFunction(const std::string& str_expression)
 	}
 }
 
+ExprtTkFunction::ExprtTkFunction(const std::string& str_expression)
+    : _exp_str(str_expression),
+      _evaluator(new Evaluator(str_expression)),
+      _is_affine(false)
+{
+	_is_affine = parseAffine();
+}
+
+ExprtTkFunction::~ExprtTkFunction()
+{
+	delete _evaluator;
+}
+
+/*!
+   \brief Detect expressions of the form a0+b0*x+c0*y+d0*z
+
+   The coefficients are checked against ExprTk at a few points, so that a
+   parser mismatch falls back to ExprTk instead of giving wrong values.
+ */
+bool ExprtTkFunction::parseAffine()
+{
+	Affine f;
+	if (!AffineParser(_exp_str).parse(f)) return false;
+	for (int i = 0; i < 4; i++)
+		_coef[i] = f.c[i];
+
+	const double probes[][3] = {
+	    {0., 0., 0.}, {1., 0., 0.}, {0., 1., 0.}, {0., 0., 1.},
+	    {-123.4, 56.7, 8.9e3}};
+	for (std::size_t i = 0; i < sizeof(probes) / sizeof(probes[0]); i++)
+	{
+		const double* p = probes[i];
+		const double v_ref = (*_evaluator)(p[0], p[1], p[2]);
+		const double v = _coef[0] + _coef[1] * p[0] + _coef[2] * p[1] +
+		                 _coef[3] * p[2];
+		double scale = std::fabs(_coef[0]);
+		for (int k = 0; k < 3; k++)
+			scale += std::fabs(_coef[k + 1] * p[k]);
+		if (!(std::fabs(v - v_ref) <= 1.e-12 * scale)) return false;
+	}
+	return true;
+}
+
 double ExprtTkFunction::getValue(double x, double y, double z) const
 {
-	_x = x;
-	_y = y;
-	_z = z;
-	return expression.value();
+	if (_is_affine)
+		return _coef[0] + _coef[1] * x + _coef[2] * y + _coef[3] * z;
+	return (*_evaluator)(x, y, z);
+}
+
+void ExprtTkFunction::getValues(std::size_t n, const double* const* points,
+                                double* values) const
+{
+	const long n_points = static_cast<long>(n);
+	if (_is_affine)
+	{
+		const double a0 = _coef[0], b0 = _coef[1], c0 = _coef[2],
+		             d0 = _coef[3];
+#pragma omp parallel for schedule(static, 1024)
+		for (long i = 0; i < n_points; i++)
+		{
+			const double* p = points[i];
+			values[i] = a0 + b0 * p[0] + c0 * p[1] + d0 * p[2];
+		}
+		return;
+	}
+
+#pragma omp parallel
+	{
+		// Every thread compiles its own instance of the expression
+#ifdef _OPENMP
+		Evaluator* f = (omp_get_num_threads() > 1) ? new Evaluator(_exp_str)
+		                                           : _evaluator;
+#else
+		Evaluator* f = _evaluator;
+#endif
+#pragma omp for schedule(static, 1024)
+		for (long i = 0; i < n_points; i++)
+		{
+			const double* p = points[i];
+			values[i] = (*f)(p[0], p[1], p[2]);
+		}
+		if (f != _evaluator) delete f;
+	}
 }
 
 LinearFunctionData::LinearFunctionData(ifstream& ins, int num_var)
@@ -118,6 +356,26 @@ double LinearFunctionData::getValue(double x, double y, double z) const
 	return _subdom_f[0]->getValue(x, y, z);
 }
 
+void LinearFunctionData::getValues(size_t dom_i, std::size_t n,
+                                   const double* const* points,
+                                   double* values) const
+{
+	for (size_t i = 0; i < _subdom_index.size(); i++)
+		if (dom_i == _subdom_index[i])
+		{
+			_subdom_f[i]->getValues(n, points, values);
+			return;
+		}
+
+	std::fill(values, values + n, 0.);
+}
+
+void LinearFunctionData::getValues(std::size_t n, const double* const* points,
+                                   double* values) const
+{
+	_subdom_f[0]->getValues(n, points, values);
+}
+
 #else
 LinearFunctionData::LinearFunctionData(ifstream& ins, int num_var)
     : _ndata(0), _subdom_index(NULL), _a0(NULL), _b0(NULL), _c0(NULL), _d0(NULL)
@@ -27,17 +27,48 @@ class ExprtTkFunction
 	typedef exprtk::parser<double> parser_t;
 	typedef exprtk::parser_error::type error_t;
 
+	/// A compiled expression together with its variables. One instance must
+	/// not be evaluated by several threads at the same time.
+	struct Evaluator
+	{
+		explicit Evaluator(const std::string& str_expression);
+		double operator()(double x, double y, double z)
+		{
+			_x = x;
+			_y = y;
+			_z = z;
+			return expression.value();
+		}
+
+		double _x, _y, _z;
+		symbol_table_t symbol_table;
+		expression_t expression;
+	};
+
 public:
 	explicit ExprtTkFunction(const std::string& str_expression);
+	~ExprtTkFunction();
 
 	double getValue(double x, double y, double z) const;
+	/// Evaluate the function at n points, points[i] points to x, y, z.
+	/// Thread safe, parallelised with OpenMP.
+	void getValues(std::size_t n, const double* const* points,
+	               double* values) const;
 	std::string getExpression() const { return _exp_str; }
+	/// True if the expression is a0+b*x+c*y+d*z, then getValue() and
+	/// getValues() do not use ExprTk.
+	bool isAffine() const { return _is_affine; }
 
 private:
+	ExprtTkFunction(const ExprtTkFunction&);
+	ExprtTkFunction& operator=(const ExprtTkFunction&);
+	bool parseAffine();
+
 	std::string _exp_str;
-	mutable double _x, _y, _z;
-	symbol_table_t symbol_table;
-	expression_t expression;
+	Evaluator* _evaluator;
+	bool _is_affine;
+	// f = a0+b0*x+c0*y+d0*z for affine expressions
+	double _coef[4];
 };
 
 class LinearFunctionData
@@ -48,6 +79,11 @@ public:
 
 	double getValue(size_t dom_i, double x, double y, double z) const;
 	double getValue(double x, double y, double z) const;
+	/// Batch version of getValue(), points[i] points to x, y, z
+	void getValues(size_t dom_i, std::size_t n, const double* const* points,
+	               double* values) const;
+	void getValues(std::size_t n, const double* const* points,
+	               double* values) const;
 	size_t* getSubDomIndex() const { return (size_t*)&_subdom_index[0]; }
 
 	std::string getExpression(size_t dom_i) const
@@ -70,19 +70,24 @@ namespace Math_Group
 **************************************************************************/
 Linear_EQS::Linear_EQS(const SparseTable& sparse_table,
 					   const long dof, bool /*messg*/)
+    : A_stored(NULL), sp_table(sparse_table), check_residual(false), r(NULL),
+      num_threads(0)
 {
-	long i;
 	A = new CSparseMatrix(sparse_table, dof);
 	size_A = A->Dim();
 
 	x = new double[size_A];
 	b = new double[size_A];
-	//
-	for (i = 0; i < size_A; i++)
-	{
-		x[i] = 0.;
-		b[i] = 0.;
-	}
+	// First touch with the row partition of the vector kernels
+	const long n_rows = A->Size();
+	const int n_dof = A->Dof();
+#pragma omp parallel for schedule(static)
+	for (long i = 0; i < n_rows; i++)
+		for (int k = 0; k < n_dof; k++)
+		{
+			x[k * n_rows + i] = 0.;
+			b[k * n_rows + i] = 0.;
+		}
 }
 
 /**************************************************************************
@@ -93,8 +98,10 @@ Linear_EQS::Linear_EQS(const SparseTable& sparse_table,
 Linear_EQS::~Linear_EQS()
 {
 	if (A) delete A;
+	delete A_stored;
 	if (x) delete[] x;
 	if (b) delete[] b;
+	delete[] r;
 	//
 	A = NULL;
 	x = NULL;
@@ -106,14 +113,23 @@ Linear_EQS::~Linear_EQS()
    Programing:
    10/2007 WW/
 **************************************************************************/
-void Linear_EQS::ConfigNumerics(int ls_precond, int ls_method, int ls_max_iterations, double ls_error_tolerance, int ls_storage_method, std::string const& ls_extra_arg)
+void Linear_EQS::ConfigNumerics(int ls_precond, int ls_method, int ls_max_iterations, double ls_error_tolerance, int ls_storage_method, std::string const& ls_extra_arg, bool ls_check_residual)
 {
+	check_residual = ls_check_residual;
 	precond_type = ls_precond;
 	solver_type = ls_method;
 	max_iter = ls_max_iterations;
 	tol = ls_error_tolerance;
 	storage_type = ls_storage_method;
 	extra_arg = ls_extra_arg;
+	// Storage 3: DOF x DOF blocks for multi-DOF systems
+	const CSparseMatrix::StorageType block_storage =
+	    (storage_type == 3) ? CSparseMatrix::BSR : CSparseMatrix::DOF_PLANES;
+	if (A->GetStorageType() != block_storage &&
+	    A->SetStorageType(block_storage) == CSparseMatrix::BSR)
+		ScreenMessage("-> Block CRS storage of the equation system, %d x %d "
+		              "blocks\n",
+		              A->Dof(), A->Dof());
 }
 
 /**************************************************************************
@@ -127,6 +143,23 @@ void Linear_EQS::Initialize()
 	for (long i = 0; i < size_A; i++)
 		b[i] = 0.;
 }
+/**************************************************************************
+   Task: Linear equation::Keep a copy of the matrix
+**************************************************************************/
+void Linear_EQS::StoreMatrix()
+{
+	if (!A_stored) A_stored = new CSparseMatrix(sp_table, A->Dof());
+	(*A_stored) = (*A);
+}
+
+/**************************************************************************
+   Task: Linear equation::Copy the stored matrix back
+**************************************************************************/
+void Linear_EQS::RestoreMatrix()
+{
+	if (A_stored) (*A) = (*A_stored);
+}
+
 /**************************************************************************
    Task: Linear equation::Alocate memory for solver
    Programing:
@@ -598,19 +631,34 @@ int Linear_EQS::solveWithLIS(bool compress)
 	    "------------------------------------------------------------------\n");
 	ScreenMessage2("*** LIS solver computation\n");
 
-	// Prepare CRS data
 	LIS_INT nrows = A->Size() * A->Dof();
 	LIS_INT nonzero = A->nnz();
-	// ScreenMessage2("-> copying CRS data with dim=%ld and nnz=%ld\n", nrows,
-	// nonzero);
-	LIS_REAL* value = new LIS_REAL[nonzero];
-	A->GetCRSValue(value);
+	// The blocks of BSR storage are handed over without a copy. Removing
+	// the empty rows needs the scalar CRS values.
+	const bool is_bsr = A->GetStorageType() == CSparseMatrix::BSR && !compress;
+	LIS_REAL* value = NULL;
 	LIS_INT* ptr = A->ptr;
 	LIS_INT* col_idx = A->col_idx;
+	// Row of x and b for each row of the LIS system, if they differ
+	std::vector<LIS_INT> vec_nz_rows;
+	if (is_bsr)
+	{
+		// Node-wise ordering of the unknowns
+		const LIS_INT n_nodes = A->Size();
+		const LIS_INT dof = A->Dof();
+		vec_nz_rows.resize(nrows);
+		for (LIS_INT i = 0; i < nrows; i++)
+			vec_nz_rows[i] = (i % dof) * n_nodes + i / dof;
+	}
+	else
+	{
+		// Prepare CRS data
+		value = new LIS_REAL[nonzero];
+		A->GetCRSValue(value);
+	}
 
 	bool is_compressed = false;
-	std::vector<LIS_INT> vec_nz_rows;
-	if (compress)
+	if (compress && !is_bsr)
 	{
 		// check non-zero rows, non-zero entries
 		ScreenMessage2("-> Check non-zero entries\n");
@@ -642,13 +690,21 @@ int Linear_EQS::solveWithLIS(bool compress)
 	// Creating a matrix.
 	int ierr = lis_matrix_create(0, &AA);
 	CHKERR(ierr);
+	if (is_bsr)
+	{
+		ierr = lis_matrix_set_type(AA, LIS_MATRIX_BSR);
+		CHKERR(ierr);
+	}
+	else
+	{
 #ifndef OGS_USE_LONG
-	ierr = lis_matrix_set_type(AA, LIS_MATRIX_CRS);
-	CHKERR(ierr);
+		ierr = lis_matrix_set_type(AA, LIS_MATRIX_CRS);
+		CHKERR(ierr);
 #else
-	ierr = lis_matrix_set_type(AA, LIS_MATRIX_CSR);
-	CHKERR(ierr);
+		ierr = lis_matrix_set_type(AA, LIS_MATRIX_CSR);
+		CHKERR(ierr);
 #endif
+	}
 	ierr = lis_matrix_set_size(AA, 0, nrows);
 	CHKERR(ierr);
 
@@ -666,15 +722,25 @@ int Linear_EQS::solveWithLIS(bool compress)
 	        tol,
 	        max_iter);
 
+	if (is_bsr)
+	{
+		ierr = lis_matrix_set_bsr(A->Dof(), A->Dof(), A->NumberOfBlocks(),
+		                          A->block_ptr, A->block_col_idx,
+		                          A->Entries(), AA);
+		CHKERR(ierr);
+	}
+	else
+	{
 #ifndef OGS_USE_LONG
-	ierr = lis_matrix_set_crs(nonzero, ptr, col_idx, value, AA);
-	CHKERR(ierr);
+		ierr = lis_matrix_set_crs(nonzero, ptr, col_idx, value, AA);
+		CHKERR(ierr);
 //		ierr = lis_matrix_set_crs(nonzero,A->ptr,A->col_idx, value,AA);
 #else
-	ierr = lis_matrix_set_csr(nonzero, ptr, col_idx, value, AA);
-	CHKERR(ierr);
+		ierr = lis_matrix_set_csr(nonzero, ptr, col_idx, value, AA);
+		CHKERR(ierr);
 //		ierr = lis_matrix_set_csr(nonzero,A->ptr,A->col_idx, value,AA);
 #endif
+	}
 	ierr = lis_matrix_assemble(AA);
 	CHKERR(ierr);
 
@@ -684,7 +750,7 @@ int Linear_EQS::solveWithLIS(bool compress)
 	ierr = lis_vector_duplicate(AA, &xx);
 	CHKERR(ierr);
 
-	if (!is_compressed)
+	if (!is_compressed && !is_bsr)
 	{
 #pragma omp parallel for
 		for (int i = 0; i < nrows; ++i)
@@ -733,7 +799,7 @@ int Linear_EQS::solveWithLIS(bool compress)
 	//	lis_vector_print(bb);
 
 	// Update the solution (answer) into the x vector
-	if (!is_compressed)
+	if (!is_compressed && !is_bsr)
 	{
 #pragma omp parallel for
 		for (int i = 0; i < nrows; ++i)
@@ -749,7 +815,13 @@ int Linear_EQS::solveWithLIS(bool compress)
 	}
 
 	// Clear memory
-	if (is_compressed)
+	if (is_bsr)
+	{
+		// The arrays belong to the matrix A
+		lis_matrix_unset(AA);
+		lis_matrix_destroy(AA);
+	}
+	else if (is_compressed)
 	{
 #if 0
 		lis_matrix_destroy(AA);
@@ -991,6 +1063,8 @@ int Linear_EQS::Solver(bool compress)
 	int iter = 0;
 #ifdef _OPENMP
 	// omp_set_num_threads (1);
+	const int default_threads = omp_get_max_threads();
+	if (num_threads > 0) omp_set_num_threads(num_threads);
 	ScreenMessage2("-> Use OpenMP with %d threads\n", omp_get_max_threads());
 #endif
 #ifdef OGS_USE_LONG
@@ -1014,6 +1088,18 @@ int Linear_EQS::Solver(bool compress)
 	}
 #endif
 
+	// Residual of the returned solution, independent of the (possibly
+	// preconditioned) residual reported by the solver
+	if (check_residual && iter >= 0)
+	{
+		const double norm_b = ComputeNormRHS();
+		const double norm_r = ComputeResidualNorm();
+		ScreenMessage2("-> |b-Ax|/|b|: %e\n",
+		               (norm_b > 0.) ? norm_r / norm_b : norm_r);
+	}
+#ifdef _OPENMP
+	omp_set_num_threads(default_threads);
+#endif
 	return iter;
 }
 
@@ -1038,12 +1124,37 @@ void Linear_EQS::SetKnownX_i(const long i, const double x_i)
  ********************************************************************/
 double Linear_EQS::dot(const double* xx, const double* yy)
 {
-	long i;
 	double val = 0.;
-	for (i = 0; i < size_A; i++)
+#pragma omp parallel for schedule(static) reduction(+ : val)
+	for (long i = 0; i < size_A; i++)
 		val += xx[i] * yy[i];
 	return val;
 }
+/*\!
+ ********************************************************************
+   yy += a * xx
+ ********************************************************************/
+void Linear_EQS::axpy(const double a, const double* xx, double* yy)
+{
+#pragma omp parallel for schedule(static)
+	for (long i = 0; i < size_A; i++)
+		yy[i] += a * xx[i];
+}
+/*\!
+ ********************************************************************
+   Norm of the residual b - A x of the current solution, evaluated
+   without the external solver
+ ********************************************************************/
+double Linear_EQS::ComputeResidualNorm()
+{
+	if (!r) r = new double[size_A];
+#pragma omp parallel for schedule(static)
+	for (long i = 0; i < size_A; i++)
+		r[i] = 0.;
+	A->multi(x, r);
+	axpy(-1.0, b, r);
+	return Norm(r);
+}
 /*\!
  ********************************************************************
    Dot production of two vectors
@@ -42,11 +42,19 @@ public:
 	           bool messg = true);
 	~Linear_EQS();
 
-	void ConfigNumerics(int ls_precond, int ls_method, int ls_max_iterations, double ls_error_tolerance, int storage_type, std::string const& extra_arg);
+	void ConfigNumerics(int ls_precond, int ls_method, int ls_max_iterations, double ls_error_tolerance, int storage_type, std::string const& extra_arg, bool ls_check_residual = false);
 	int Solver(bool compress = false);
 	//
 	void Initialize();
 	void Clean();
+	// Keep a copy of the current matrix, e.g. a Jacobian reused over
+	// several Newton iterations, and copy it back after Initialize()
+	void StoreMatrix();
+	void RestoreMatrix();
+	void SetTolerance(double ls_tol) { tol = ls_tol; }
+	// Threads used by Solver(), 0 for the current OpenMP default
+	void SetNumThreads(int n) { num_threads = n; }
+	double GetTolerance() const { return tol; }
 
 	void SetDOF(const int dof_n)
 	{
@@ -60,9 +68,11 @@ public:
 	double* getRHS() { return b; }
 	const CSparseMatrix* getA() const { return A; }
 	CSparseMatrix* getA() { return A; }
+	const SparseTable& getSparseTable() const { return sp_table; }
 	double RHS(const long i) const { return b[i]; }
 	double NormX();
 	double ComputeNormRHS() { return Norm(b); }
+	double ComputeResidualNorm();
 	// Write
 	void Write(std::ostream& os = std::cout);
 	void WriteRHS(std::ostream& os = std::cout);
@@ -71,6 +81,8 @@ public:
 
 private:
 	CSparseMatrix* A;
+	CSparseMatrix* A_stored;
+	const SparseTable& sp_table;
 	double* b;
 	double* x;
 //
@@ -94,9 +106,14 @@ private:
 	long size_A;
 	int storage_type;
 	std::string extra_arg;
+	// Report |b-Ax|/|b| after each solve, r is the work vector
+	bool check_residual;
+	double* r;
+	int num_threads;
 
 	// Operators
 	double dot(const double* xx, const double* yy);
+	void axpy(const double a, const double* xx, double* yy);
 	inline double Norm(const double* xx) { return sqrt(dot(xx, xx)); }
 #ifdef MKL
 	void solveWithPARDISO(bool compress);
@@ -30,7 +30,7 @@ namespace Math_Group
    02/2008 PCH Compressed Row Storage
  ********************************************************************/
 CSparseMatrix::CSparseMatrix(const SparseTable& sparse_table, const int dof)
-    : DOF(dof)
+    : block_ptr(NULL), block_col_idx(NULL), storage_type(DOF_PLANES), DOF(dof)
 {
 	symmetry = sparse_table.symmetry;
 	size_entry_column = sparse_table.size_entry_column;
@@ -43,6 +43,8 @@ CSparseMatrix::CSparseMatrix(const SparseTable& sparse_table, const int dof)
 	// Values of all sparse entries
 	entry = new double[dof * dof * size_entry_column + 1];
 	entry[dof * dof * size_entry_column] = 0.;
+	// First touch by the threads which work on the rows in multi()
+	(*this) = 0.;
 	zero_e = 0.;
 
 	IndexType counter_ptr = 0, counter_col_idx = 0;
@@ -77,25 +79,83 @@ CSparseMatrix::CSparseMatrix(const SparseTable& sparse_table, const int dof)
 		}
 	}
 	ptr[i + rows * (ii - 1)] = counter_ptr;
-	// entry index: actual memory layout is not CRS
+	setEntryIndex();
+}
+
+/*\!
+ ********************************************************************
+   Position of each CRS value in the entry array, whose memory layout
+   is not CRS
+ ********************************************************************/
+void CSparseMatrix::setEntryIndex()
+{
 	long cnt = 0;
 	for (int ii = 0; ii < DOF; ii++)
 	{
-		for (i = 0; i < rows; i++)
+		for (long i = 0; i < rows; i++)
 		{
 			const long ptr0 = num_column_entries[i];
 			const long ptr1 = num_column_entries[i + 1];
 			for (int jj = 0; jj < DOF; jj++)
 			{
-				const long offset_dof = (ii * DOF + jj) * size_entry_column;
 				for (long k = ptr0; k < ptr1; k++)
-				{
-					entry_index[cnt++] = offset_dof + k;
-				}
+					entry_index[cnt++] = EntryPosition(ii, jj, k);
 			}
 		}
 	}
+}
+
+/*\!
+ ********************************************************************
+   Change the layout of the entries between the DOF planes and the
+   blocks of BSR. The entries are permuted row-wise in parallel, which
+   also places the pages of the new array next to the threads using
+   them.
+ ********************************************************************/
+CSparseMatrix::StorageType CSparseMatrix::SetStorageType(StorageType type)
+{
+	if (type == BSR && (DOF < 2 || symmetry)) type = DOF_PLANES;
+	if (type == storage_type) return storage_type;
+
+	const long size = DOF * DOF * size_entry_column;
+	double* new_entry = new double[size + 1];
+	new_entry[size] = 0.;
+	const StorageType old_type = storage_type;
+#pragma omp parallel for schedule(static)
+	for (long i = 0; i < rows; i++)
+	{
+		for (long k = num_column_entries[i]; k < num_column_entries[i + 1];
+		     k++)
+			for (int ii = 0; ii < DOF; ii++)
+				for (int jj = 0; jj < DOF; jj++)
+				{
+					const long k_planes = (ii * DOF + jj) * size_entry_column + k;
+					const long k_blocks = (k * DOF + jj) * DOF + ii;
+					if (old_type == BSR)
+						new_entry[k_planes] = entry[k_blocks];
+					else
+						new_entry[k_blocks] = entry[k_planes];
+				}
+	}
+	delete[] entry;
+	entry = new_entry;
+	storage_type = type;
+	setEntryIndex();
 
+	delete[] block_ptr;
+	delete[] block_col_idx;
+	block_ptr = NULL;
+	block_col_idx = NULL;
+	if (storage_type == BSR)
+	{
+		block_ptr = new IndexType[rows + 1];
+		block_col_idx = new IndexType[size_entry_column];
+		for (long i = 0; i <= rows; i++)
+			block_ptr[i] = num_column_entries[i];
+		for (long k = 0; k < size_entry_column; k++)
+			block_col_idx[k] = entry_column[k];
+	}
+	return storage_type;
 }
 /*\!
  ********************************************************************
@@ -114,6 +174,10 @@ CSparseMatrix::~CSparseMatrix()
 	col_idx = NULL;
 	delete[] entry_index;
 	entry_index = NULL;
+	delete[] block_ptr;
+	block_ptr = NULL;
+	delete[] block_col_idx;
+	block_col_idx = NULL;
 }
 /*\!
  ********************************************************************
@@ -157,10 +221,41 @@ double& CSparseMatrix::operator()(const long i, const long j) const
 					 num_column_entries[ir + 1]);
 	if (k == -1) return zero_e;
 
-	k = (ii * DOF + jj) * size_entry_column + k;
+	return entry[EntryPosition(ii, jj, k)];
+}
+/*\!
+ ********************************************************************
+   Position of (i, j) in the entry array of a single DOF matrix
+ ********************************************************************/
+long CSparseMatrix::EntryIndex(const long i, const long j) const
+{
+	return binarySearch(entry_column, j, num_column_entries[i],
+	                    num_column_entries[i + 1]);
+}
 
-	return entry[k];  //
+/*\!
+ ********************************************************************
+   Index of the transposed entry for each entry of a single DOF matrix
+   with unsymmetric storage. Used to walk the pairs (i, j), (j, i)
+   of the global pattern without searching.
+ ********************************************************************/
+void CSparseMatrix::GetTransposeIndex(std::vector<long>& transpose) const
+{
+	transpose.assign(size_entry_column, -1);
+	for (long i = 0; i < rows; i++)
+	{
+		for (long k = num_column_entries[i]; k < num_column_entries[i + 1];
+		     k++)
+		{
+			if (transpose[k] >= 0) continue;
+			const long j = entry_column[k];
+			const long kt = EntryIndex(j, i);
+			transpose[k] = kt;
+			if (kt >= 0) transpose[kt] = k;
+		}
+	}
 }
+
 /*\!
  ********************************************************************
    Desstructor of sparse matrix
@@ -169,9 +264,25 @@ double& CSparseMatrix::operator()(const long i, const long j) const
  ********************************************************************/
 void CSparseMatrix::operator=(const double a)
 {
-	long size = DOF * DOF * size_entry_column;
-	for (long i = 0; i < size; i++)
-		entry[i] = a;
+	const int n_planes = DOF * DOF;
+#pragma omp parallel for schedule(static)
+	for (long i = 0; i < rows; i++)
+	{
+		const long k0 = num_column_entries[i];
+		const long k1 = num_column_entries[i + 1];
+		if (storage_type == BSR)
+		{
+			for (long k = k0 * n_planes; k < k1 * n_planes; k++)
+				entry[k] = a;
+			continue;
+		}
+		for (int p = 0; p < n_planes; p++)
+		{
+			double* plane = entry + p * size_entry_column;
+			for (long k = k0; k < k1; k++)
+				plane[k] = a;
+		}
+	}
 }
 /*\!
  ********************************************************************
@@ -214,6 +325,7 @@ void CSparseMatrix::operator=(const CSparseMatrix& m)
 		abort();
 	}
 #endif
+	SetStorageType(m.storage_type);
 	for (long i = 0; i < size; i++)
 		entry[i] = m.entry[i];
 }
@@ -273,7 +385,8 @@ void CSparseMatrix::Write(std::ostream& os)
 	os.width(14);
 	os.precision(8);
 	//
-	os << "Storage type: CRS\n";
+	os << "Storage type: " << ((storage_type == BSR) ? "BSR" : "CRS")
+	   << "\n";
 	for (ii = 0; ii < DOF; ii++)
 	{
 		for (i = 0; i < rows; i++)
@@ -282,7 +395,6 @@ void CSparseMatrix::Write(std::ostream& os)
 			const long ptr1 = num_column_entries[i + 1];
 			for (jj = 0; jj < DOF; jj++)
 			{
-				const long offset_dof = (ii * DOF + jj) * size_entry_column;
 				for (k = ptr0; k < ptr1; k++)
 				{
 					// TEST
@@ -290,7 +402,8 @@ void CSparseMatrix::Write(std::ostream& os)
 					// //DBL_EPSILON)
 					os << std::setw(10) << ii * rows + i << " "
 					   << std::setw(10) << jj * rows + entry_column[k]
-					   << " " << std::setw(15) << entry[offset_dof + k]
+					   << " " << std::setw(15)
+					   << entry[EntryPosition(ii, jj, k)]
 					   << "\n";
 				}
 			}
@@ -338,8 +451,7 @@ void CSparseMatrix::Write_BIN(std::ostream& os)
 					     k++)
 					{
 						A_index[counter] = jj * rows + entry_column[k];
-						A_value[counter] =
-						    entry[(ii * DOF + jj) * size_entry_column + k];
+						A_value[counter] = entry[EntryPosition(ii, jj, k)];
 						counter++;
 					}
 			}
@@ -380,17 +492,16 @@ void CSparseMatrix::Diagonize(const long idiag, const double b_given, double* b)
 	const long row_end = num_column_entries[id + 1];
 	/// Diagonal entry and the row where the diagonal entry exists
 	j = diag_entry[id];
-	vdiag = entry[(ii * DOF + ii) * size_entry_column + j];
+	vdiag = entry[EntryPosition(ii, ii, j)];
 	/// Row where the diagonal entry exists
 	for (jj = 0; jj < DOF; jj++)
 	{
-		const long ij = (ii * DOF + jj) * size_entry_column;
 		for (k = num_column_entries[id]; k < row_end; k++)
 		{
 			j0 = entry_column[k];
 			if (id == j0 && jj == ii)  // Diagonal entry
 				continue;
-			entry[ij + k] = 0.;
+			entry[EntryPosition(ii, jj, k)] = 0.;
 		}
 	}
 #ifdef colDEBUG
@@ -407,7 +518,7 @@ void CSparseMatrix::Diagonize(const long idiag, const double b_given, double* b)
 		for (jj = 0; jj < DOF; jj++)
 		{
 			if (i == j0 && ii == jj) continue;
-			k = (jj * DOF + ii) * size_entry_column + j;
+			k = EntryPosition(jj, ii, j);
 			b[jj * rows + i] -= entry[k] * b_given;
 			entry[k] = 0.;
 			// Room for symmetry case
@@ -417,6 +528,90 @@ void CSparseMatrix::Diagonize(const long idiag, const double b_given, double* b)
 	b[idiag] = vdiag * b_given;
 }
 
+/*\!
+ ********************************************************************
+   Matrix-vector product, row-wise in parallel. With symmetric storage
+   only the upper triangle is stored, and the product is computed
+   serially.
+ ********************************************************************/
+void CSparseMatrix::multi(const double* vec, double* vec_result,
+                          double fac) const
+{
+	if (symmetry)
+	{
+		for (long i = 0; i < rows; i++)
+		{
+			for (int ii = 0; ii < DOF; ii++)
+			{
+				const long gi = ii * rows + i;
+				for (int jj = 0; jj < DOF; jj++)
+				{
+					const double* plane =
+					    entry + (ii * DOF + jj) * size_entry_column;
+					for (long k = num_column_entries[i];
+					     k < num_column_entries[i + 1]; k++)
+					{
+						const long gj = jj * rows + entry_column[k];
+						// Lower part of a diagonal block is not used
+						if (gi > gj) continue;
+						vec_result[gi] += fac * plane[k] * vec[gj];
+						if (gi < gj)
+							vec_result[gj] += fac * plane[k] * vec[gi];
+					}
+				}
+			}
+		}
+		return;
+	}
+
+	if (storage_type == BSR)
+	{
+#pragma omp parallel
+		{
+			std::vector<double> sum(DOF);
+#pragma omp for schedule(static)
+			for (long i = 0; i < rows; i++)
+			{
+				std::fill(sum.begin(), sum.end(), 0.);
+				for (long k = num_column_entries[i];
+				     k < num_column_entries[i + 1]; k++)
+				{
+					const double* block = entry + k * DOF * DOF;
+					for (int jj = 0; jj < DOF; jj++)
+					{
+						const double v = vec[jj * rows + entry_column[k]];
+						for (int ii = 0; ii < DOF; ii++)
+							sum[ii] += block[jj * DOF + ii] * v;
+					}
+				}
+				for (int ii = 0; ii < DOF; ii++)
+					vec_result[ii * rows + i] += fac * sum[ii];
+			}
+		}
+		return;
+	}
+
+#pragma omp parallel for schedule(static)
+	for (long i = 0; i < rows; i++)
+	{
+		const long k0 = num_column_entries[i];
+		const long k1 = num_column_entries[i + 1];
+		for (int ii = 0; ii < DOF; ii++)
+		{
+			double sum = 0.;
+			for (int jj = 0; jj < DOF; jj++)
+			{
+				const double* plane =
+				    entry + (ii * DOF + jj) * size_entry_column;
+				const double* vec_jj = vec + jj * rows;
+				for (long k = k0; k < k1; k++)
+					sum += plane[k] * vec_jj[entry_column[k]];
+			}
+			vec_result[ii * rows + i] += fac * sum;
+		}
+	}
+}
+
 /********************************************************************
    Get sparse matrix values in compressed row storage
    Programm:
@@ -11,6 +11,7 @@
 #define sparse_matrix_INC
 
 #include <iostream>
+#include <vector>
 #include "sparse_table.h"
 
 namespace Math_Group
@@ -24,6 +25,15 @@ public:
 #else
 	typedef long long int IndexType;
 #endif
+	/// Layout of the entries of a matrix with DOF > 1
+	enum StorageType
+	{
+		/// DOF x DOF matrices of the sparse table, one after another
+		DOF_PLANES = 0,
+		/// Block CRS: the DOF x DOF block of each entry of the sparse
+		/// table is contiguous, column by column
+		BSR
+	};
 
 	CSparseMatrix(const SparseTable& sparse_table, const int dof);
 	~CSparseMatrix();
@@ -39,6 +49,9 @@ public:
 	double& operator()(const long i, const long j = 0) const;
 
 	void Diagonize(const long idiag, const double b_given, double* b);
+	/// vec_result += fac * A * vec. The vectors are ordered as the
+	/// equation system, i.e. DOF blocks of Size() entries.
+	void multi(const double* vec, double* vec_result, double fac = 1.0) const;
 
 	long Dim() const { return DOF * rows; }
 	int Dof() const { return DOF; }
@@ -53,18 +66,54 @@ public:
 		return DOF * DOF * size_entry_column;
 	}
 
+	/// Change the layout of the entries, keeping their values. BSR is
+	/// only used for DOF > 1 and unsymmetric storage. Returns the new type.
+	StorageType SetStorageType(StorageType type);
+	StorageType GetStorageType() const { return storage_type; }
+
+	// Scalar CRS structure of the equation system
 	IndexType* ptr;
 	IndexType* col_idx;
 	IndexType* entry_index;
 
 	int GetCRSValue(double* value);
 
+	// Block CRS structure: one block row per row of the sparse table.
+	// The blocks are the entries Entries() with BSR storage, and belong
+	// to the node-wise ordering of the unknowns (node i, DOF ii at
+	// i * DOF + ii). Allocated with BSR storage only.
+	IndexType* block_ptr;
+	IndexType* block_col_idx;
+	IndexType NumberOfBlocks() const { return size_entry_column; }
+
+	// Direct access to the entries of a single DOF matrix, ordered as the
+	// sparse table: row i occupies [RowBegin(i), RowBegin(i+1)).
+	// With BSR storage, the block of entry k starts at k * DOF * DOF.
+	double* Entries() { return entry; }
+	const double* Entries() const { return entry; }
+	long RowBegin(const long i) const { return num_column_entries[i]; }
+	long Column(const long k) const { return entry_column[k]; }
+	long DiagonalEntry(const long i) const { return diag_entry[i]; }
+	/// Position of entry (i, j) in Entries(), -1 if it is not in the table
+	long EntryIndex(const long i, const long j) const;
+	/// For each entry (i, j) the position of its transpose (j, i)
+	void GetTransposeIndex(std::vector<long>& transpose) const;
+
 	// Print
 	void Write(std::ostream& os = std::cout);
 	void Write_BIN(std::ostream& os);
 private:
+	/// Position of entry k of the sparse table in the block (ii, jj)
+	long EntryPosition(const int ii, const int jj, const long k) const
+	{
+		if (storage_type == BSR) return (k * DOF + jj) * DOF + ii;
+		return (ii * DOF + jj) * size_entry_column + k;
+	}
+	void setEntryIndex();
+
 	// Data
 	double* entry;
+	StorageType storage_type;
 	mutable double zero_e;
 	//
 	bool symmetry;